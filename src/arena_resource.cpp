@@ -0,0 +1,78 @@
+#include "arena_resource.hpp"
+
+#include <algorithm>
+
+#include <cstdint>
+
+namespace suse {
+namespace {
+constexpr std::size_t block_alignment = alignof(std::max_align_t);
+} // namespace
+
+arena_resource::arena_resource(std::size_t initial_block_size, std::pmr::memory_resource *upstream)
+    : initial_block_size_{std::max<std::size_t>(initial_block_size, 1)}, upstream_{upstream} {}
+
+arena_resource::arena_resource(const arena_resource &other) : arena_resource(other.initial_block_size_, other.upstream_) {}
+
+arena_resource &arena_resource::operator=(const arena_resource &) {
+    return *this;
+}
+
+arena_resource::~arena_resource() {
+    release();
+}
+
+void arena_resource::release() {
+    for (const auto &b : blocks_)
+        upstream_->deallocate(b.data, b.size, block_alignment);
+    blocks_.clear();
+    current_block_ = offset_ = 0;
+}
+
+void arena_resource::reset() {
+    if (blocks_.size() > 1) {
+        const auto total = capacity();
+        release();
+        blocks_.push_back({static_cast<std::byte *>(upstream_->allocate(total, block_alignment)), total});
+    }
+
+    current_block_ = offset_ = 0;
+}
+
+std::size_t arena_resource::capacity() const {
+    std::size_t total = 0;
+    for (const auto &b : blocks_)
+        total += b.size;
+    return total;
+}
+
+void *arena_resource::do_allocate(std::size_t bytes, std::size_t alignment) {
+    const auto aligned_offset_in = [&](const block &b) {
+        const auto address = reinterpret_cast<std::uintptr_t>(b.data) + offset_;
+        return offset_ + (alignment - address % alignment) % alignment;
+    };
+
+    for (; current_block_ < blocks_.size(); ++current_block_, offset_ = 0) {
+        const auto aligned_offset = aligned_offset_in(blocks_[current_block_]);
+        if (aligned_offset + bytes <= blocks_[current_block_].size) {
+            offset_ = aligned_offset + bytes;
+            return blocks_[current_block_].data + aligned_offset;
+        }
+    }
+
+    // blocks are aligned to at least max_align_t, so padding is only needed for larger alignments
+    const auto padding = alignment > block_alignment ? alignment : 0;
+    const auto block_size = std::max({bytes + padding, initial_block_size_, blocks_.empty() ? 0 : 2 * blocks_.back().size});
+    blocks_.push_back({static_cast<std::byte *>(upstream_->allocate(block_size, block_alignment)), block_size});
+    current_block_ = blocks_.size() - 1;
+    offset_ = aligned_offset_in(blocks_.back());
+    const auto result = blocks_.back().data + offset_;
+    offset_ += bytes;
+    return result;
+}
+
+void arena_resource::do_deallocate(void *p, std::size_t bytes, std::size_t) {
+    if (current_block_ < blocks_.size() && static_cast<std::byte *>(p) + bytes == blocks_[current_block_].data + offset_)
+        offset_ -= bytes;
+}
+} // namespace suse
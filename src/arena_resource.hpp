@@ -0,0 +1,49 @@
+#ifndef SUSE_ARENA_RESOURCE_HPP
+#define SUSE_ARENA_RESOURCE_HPP
+
+#include <memory_resource>
+#include <vector>
+
+#include <cstddef>
+
+namespace suse {
+// Bump allocator for scratch memory that is released all at once. Deallocation only takes back the most
+// recent allocation, so temporaries freed in reverse order of allocation reuse the same memory. reset()
+// makes all memory available again without returning it upstream. After a reset, the blocks are merged
+// into one, so a workload that repeats between resets allocates from upstream until it has reached its peak
+// once and not at all afterwards.
+//
+// Copies start empty, as scratch memory is not part of the state of its owner.
+class arena_resource : public std::pmr::memory_resource {
+  public:
+    explicit arena_resource(std::size_t initial_block_size = 4096, std::pmr::memory_resource *upstream = std::pmr::get_default_resource());
+    arena_resource(const arena_resource &other);
+    arena_resource &operator=(const arena_resource &);
+    ~arena_resource() override;
+
+    // Invalidates everything allocated so far
+    void reset();
+
+    // Bytes held from upstream
+    std::size_t capacity() const;
+
+  private:
+    struct block {
+        std::byte *data;
+        std::size_t size;
+    };
+
+    std::size_t initial_block_size_;
+    std::pmr::memory_resource *upstream_;
+    std::vector<block> blocks_;
+    std::size_t current_block_ = 0, offset_ = 0;
+
+    void release();
+
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+};
+} // namespace suse
+
+#endif
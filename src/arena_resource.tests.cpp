@@ -0,0 +1,84 @@
+#include "arena_resource.hpp"
+
+#include <doctest/doctest.h>
+
+#include <memory_resource>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace {
+class counting_resource : public std::pmr::memory_resource {
+  public:
+    std::size_t allocations = 0, deallocations = 0;
+
+  private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+        ++allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+        ++deallocations;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+};
+} // namespace
+
+TEST_SUITE("suse::arena_resource") {
+    TEST_CASE("alignment") {
+        suse::arena_resource arena{64};
+        for (const std::size_t alignment : {1, 2, 4, 8, 16, 64, 256}) {
+            CHECK(arena.allocate(1, 1) != nullptr);
+            const auto address = reinterpret_cast<std::uintptr_t>(arena.allocate(3, alignment));
+            CHECK(address % alignment == 0);
+        }
+    }
+
+    TEST_CASE("reset reuses memory") {
+        counting_resource upstream;
+        {
+            suse::arena_resource arena{128, &upstream};
+            const auto fill = [&] {
+                std::pmr::vector<int> values{&arena};
+                for (int value = 0; value < 1000; ++value)
+                    values.push_back(value);
+                return values.front() + values.back();
+            };
+
+            CHECK(fill() == 999);
+            CHECK(upstream.allocations > 1);
+            CHECK(arena.capacity() >= 1000 * sizeof(int));
+
+            // merges the blocks into one, after which the same allocations fit
+            arena.reset();
+            const auto allocations = upstream.allocations;
+            CHECK(fill() == 999);
+            arena.reset();
+            CHECK(fill() == 999);
+            CHECK(upstream.allocations == allocations);
+
+            const suse::arena_resource copy{arena};
+            CHECK(copy.capacity() == 0);
+        }
+
+        CHECK(upstream.deallocations == upstream.allocations);
+    }
+
+    TEST_CASE("deallocating the most recent allocation") {
+        suse::arena_resource arena;
+        auto *first = arena.allocate(32, 8);
+        auto *second = arena.allocate(32, 8);
+        arena.deallocate(second, 32, 8);
+        CHECK(arena.allocate(32, 8) == second);
+
+        // anything else is only reclaimed by a reset
+        arena.deallocate(first, 32, 8);
+        CHECK(arena.allocate(32, 8) != first);
+        arena.reset();
+        CHECK(arena.allocate(32, 8) == first);
+    }
+}
@@ -0,0 +1,122 @@
+#include "bit_parallel_nfa.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+namespace suse {
+namespace {
+std::size_t symbol_index(char symbol) {
+    return static_cast<unsigned char>(symbol);
+}
+
+void set_bit(bit_parallel_nfa::word_type *set, std::size_t idx) {
+    set[idx / bit_parallel_nfa::bits_per_word] |= bit_parallel_nfa::word_type{1} << (idx % bit_parallel_nfa::bits_per_word);
+}
+} // namespace
+
+bit_parallel_nfa::bit_parallel_nfa(const nfa &automaton) : number_of_states_{automaton.number_of_states()},
+                                                           words_per_set_{std::max<std::size_t>(1, (automaton.number_of_states() + bits_per_word - 1) / bits_per_word)},
+                                                           initial_(words_per_set_, 0),
+                                                           final_(words_per_set_, 0) {
+    std::size_t number_of_classes = 1;
+    for (const auto &state : automaton.states()) {
+        for (const auto &[symbol, _] : state.transitions) {
+            assert(symbol != nfa::epsilon_symbol);
+            if (symbol != nfa::wildcard_symbol && symbol_class_[symbol_index(symbol)] == 0)
+                symbol_class_[symbol_index(symbol)] = number_of_classes++;
+        }
+    }
+
+    const auto stride = number_of_states_ * words_per_set_;
+    successors_.assign(number_of_classes * stride, 0);
+
+    for (std::size_t source_id = 0; source_id < number_of_states_; ++source_id) {
+        const auto &state = automaton.states()[source_id];
+        for (const auto &[symbol, targets] : state.transitions) {
+            for (auto target : targets) {
+                if (symbol == nfa::wildcard_symbol) {
+                    for (std::size_t symbol_class = 0; symbol_class < number_of_classes; ++symbol_class)
+                        set_bit(&successors_[symbol_class * stride + source_id * words_per_set_], target);
+                } else
+                    set_bit(&successors_[symbol_class_[symbol_index(symbol)] * stride + source_id * words_per_set_], target);
+            }
+        }
+
+        if (state.is_final)
+            set_bit(final_.data(), source_id);
+    }
+
+    set_bit(initial_.data(), automaton.initial_state_id());
+}
+
+bool bit_parallel_nfa::check(std::string_view word) const {
+    if (words_per_set_ == 1)
+        return check_single_word(word);
+
+    return check_multi_word(word);
+}
+
+bool bit_parallel_nfa::contains_final(std::span<const word_type> states) const {
+    assert(states.size() == words_per_set_);
+
+    for (std::size_t word_idx = 0; word_idx < words_per_set_; ++word_idx) {
+        if ((states[word_idx] & final_[word_idx]) != 0)
+            return true;
+    }
+
+    return false;
+}
+
+void bit_parallel_nfa::step(std::span<const word_type> current, std::size_t symbol_class, std::span<word_type> next) const {
+    assert(current.size() == words_per_set_ && next.size() == words_per_set_);
+
+    const auto *successors = successors_for(symbol_class);
+    std::fill(next.begin(), next.end(), 0);
+
+    for (std::size_t word_idx = 0; word_idx < words_per_set_; ++word_idx) {
+        for (auto remaining = current[word_idx]; remaining != 0; remaining &= remaining - 1) {
+            const auto source_id = word_idx * bits_per_word + std::countr_zero(remaining);
+            const auto *source_successors = successors + source_id * words_per_set_;
+            for (std::size_t target_word = 0; target_word < words_per_set_; ++target_word)
+                next[target_word] |= source_successors[target_word];
+        }
+    }
+}
+
+const bit_parallel_nfa::word_type *bit_parallel_nfa::successors_for(std::size_t symbol_class) const {
+    return &successors_[symbol_class * number_of_states_ * words_per_set_];
+}
+
+bool bit_parallel_nfa::check_single_word(std::string_view word) const {
+    word_type current = initial_[0];
+
+    for (auto c : word) {
+        const auto *successors = successors_for(symbol_class(c));
+
+        word_type next = 0;
+        for (auto remaining = current; remaining != 0; remaining &= remaining - 1)
+            next |= successors[std::countr_zero(remaining)];
+
+        if (next == 0)
+            return false;
+        current = next;
+    }
+
+    return (current & final_[0]) != 0;
+}
+
+bool bit_parallel_nfa::check_multi_word(std::string_view word) const {
+    std::vector<word_type> current = initial_, next(words_per_set_);
+
+    for (auto c : word) {
+        step(current, symbol_class(c), next);
+
+        if (std::all_of(next.begin(), next.end(), [](auto w) { return w == 0; }))
+            return false;
+        std::swap(current, next);
+    }
+
+    return contains_final(current);
+}
+} // namespace suse
@@ -0,0 +1,55 @@
+#ifndef SUSE_BIT_PARALLEL_NFA_HPP
+#define SUSE_BIT_PARALLEL_NFA_HPP
+
+#include "nfa.hpp"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <cstddef>
+
+namespace suse {
+// Simulates an nfa on sets of states represented as bitsets, one bit per state.
+// For every symbol occurring in the automaton and every state, the set of successor states
+// (including wildcard transitions) is precomputed, so stepping only ORs together the masks
+// of the currently active states. Automatons with up to 64 states fit into a single word.
+class bit_parallel_nfa {
+  public:
+    using word_type = std::uint64_t;
+    static constexpr std::size_t bits_per_word = 64;
+
+    explicit bit_parallel_nfa(const nfa &automaton);
+
+    bool check(std::string_view word) const;
+
+    std::size_t number_of_states() const { return number_of_states_; }
+    std::size_t words_per_set() const { return words_per_set_; }
+
+    std::size_t number_of_symbol_classes() const { return successors_.size() / (number_of_states_ * words_per_set_); }
+    std::size_t symbol_class(char symbol) const { return symbol_class_[static_cast<unsigned char>(symbol)]; }
+
+    std::span<const word_type> initial_states() const { return initial_; }
+    bool contains_final(std::span<const word_type> states) const;
+
+    // Writes the successors of all states in current on any symbol of the given class to next
+    void step(std::span<const word_type> current, std::size_t symbol_class, std::span<word_type> next) const;
+
+  private:
+    std::size_t number_of_states_, words_per_set_;
+
+    // symbols without transitions of their own share class 0, where only wildcard transitions apply
+    std::array<std::size_t, 256> symbol_class_{};
+    std::vector<word_type> successors_; // [symbol class][source state][word]
+    std::vector<word_type> initial_, final_;
+
+    const word_type *successors_for(std::size_t symbol_class) const;
+
+    bool check_single_word(std::string_view word) const;
+    bool check_multi_word(std::string_view word) const;
+};
+} // namespace suse
+
+#endif
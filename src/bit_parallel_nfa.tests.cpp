@@ -0,0 +1,72 @@
+#include "bit_parallel_nfa.hpp"
+#include "execution_state_counter.hpp"
+#include "regex.hpp"
+
+#include <doctest/doctest.h>
+
+#include <string>
+#include <string_view>
+
+namespace {
+bool counter_check(const suse::nfa &automaton, std::string_view input) {
+    auto counter = suse::execution_state_counter<int>(automaton.number_of_states());
+    counter[automaton.initial_state_id()] = 1;
+
+    for (auto c : input)
+        counter = advance(counter, automaton, c);
+
+    for (std::size_t i = 0; i < automaton.number_of_states(); ++i) {
+        if (automaton.states()[i].is_final && counter[i] > 0)
+            return true;
+    }
+
+    return false;
+}
+} // namespace
+
+TEST_SUITE("suse::bit_parallel_nfa") {
+    TEST_CASE("single word") {
+        const auto sample = suse::parse_regex("a(b|c)+.?d*e");
+        const suse::bit_parallel_nfa matcher{sample};
+        REQUIRE(matcher.words_per_set() == 1);
+
+        for (std::string_view input : {"", "a", "abe", "ace", "abcbcxe", "abcbcdde", "abxdd", "abcbcdex", "xabe", "abbbbbbbe"}) {
+            CAPTURE(input);
+            REQUIRE(matcher.check(input) == counter_check(sample, input));
+        }
+    }
+
+    TEST_CASE("multiple words") {
+        std::string query;
+        for (std::size_t i = 0; i < 40; ++i)
+            query += "ab.";
+        query += "(c|d)*e";
+
+        const auto sample = suse::parse_regex(query);
+        const suse::bit_parallel_nfa matcher{sample};
+        REQUIRE(matcher.words_per_set() > 1);
+
+        std::string input;
+        for (std::size_t i = 0; i < 40; ++i)
+            input += "abx";
+
+        CHECK(!matcher.check(input));
+        CHECK(matcher.check(input + "e"));
+        CHECK(matcher.check(input + "cdcde"));
+        CHECK(!matcher.check(input + "cdcdex"));
+        CHECK(!matcher.check("b" + input + "e"));
+
+        for (std::string_view suffix : {"", "e", "ce", "cdce", "cdc", "cxe"}) {
+            CAPTURE(suffix);
+            REQUIRE(matcher.check(input + std::string{suffix}) == counter_check(sample, input + std::string{suffix}));
+        }
+    }
+
+    TEST_CASE("symbols outside the query") {
+        const suse::bit_parallel_nfa matcher{suse::parse_regex("a.c")};
+
+        CHECK(matcher.check("abc"));
+        CHECK(matcher.check("a\xff" "c"));
+        CHECK(!matcher.check("\xff" "bc"));
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef SUSE_COMPILED_QUERY_HPP
+#define SUSE_COMPILED_QUERY_HPP
+
+#include "edgelist.hpp"
+#include "nfa.hpp"
+
+#include <array>
+#include <concepts>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include <cstddef>
+
+namespace suse {
+// Everything about a query that does not change while the stream is processed: the automaton, its
+// transitions, masks of final states and initiating symbols and, optionally, the tables of the suse eviction
+// strategy for one time window size. It is immutable, so any number of selectors, e.g. one per partition
+// key, can share one instance through a std::shared_ptr<const compiled_query>.
+template <typename transitions_type = edgelist>
+class compiled_query {
+  public:
+    explicit compiled_query(nfa automaton) : automaton_{std::move(automaton)},
+                                             transitions_{compute_transitions(automaton_)} {
+        compute_masks();
+    }
+
+    compiled_query(nfa automaton, transitions_type transitions) : automaton_{std::move(automaton)},
+                                                                  transitions_{std::move(transitions)} {
+        compute_masks();
+    }
+
+    // strategy_tables as computed by eviction_strategies::suse::compute_expected_changes
+    template <typename factor_type>
+    compiled_query(nfa automaton, transitions_type transitions, std::size_t time_window_size, std::vector<factor_type> strategy_tables)
+        : compiled_query(std::move(automaton), std::move(transitions)) {
+        strategy_tables_ = std::make_shared<const std::vector<factor_type>>(std::move(strategy_tables));
+        strategy_tables_type_ = &typeid(factor_type);
+        strategy_tables_time_window_size_ = time_window_size;
+    }
+
+    const nfa &automaton() const { return automaton_; }
+    const transitions_type &transitions() const { return transitions_; }
+
+    bool is_final(std::size_t state_id) const { return final_states_[state_id]; }
+    bool is_initiator(char symbol) const { return initiators_[static_cast<unsigned char>(symbol)]; }
+
+    bool has_strategy_tables() const { return strategy_tables_ != nullptr; }
+    std::size_t strategy_tables_time_window_size() const { return strategy_tables_time_window_size_; }
+
+    // Throws std::invalid_argument if there are no tables for factor_type
+    template <typename factor_type>
+    std::span<const factor_type> strategy_tables() const {
+        if (!strategy_tables_ || *strategy_tables_type_ != typeid(factor_type))
+            throw std::invalid_argument("Compiled query has no strategy tables of the requested factor type");
+
+        return *static_cast<const std::vector<factor_type> *>(strategy_tables_.get());
+    }
+
+  private:
+    nfa automaton_;
+    transitions_type transitions_;
+
+    std::vector<bool> final_states_;
+    std::array<bool, 256> initiators_{};
+
+    std::shared_ptr<const void> strategy_tables_;
+    const std::type_info *strategy_tables_type_ = nullptr;
+    std::size_t strategy_tables_time_window_size_ = 0;
+
+    static transitions_type compute_transitions(const nfa &automaton) {
+        if constexpr (std::same_as<transitions_type, edgelist>)
+            return compute_edges_per_character(automaton);
+        else
+            return transitions_type{automaton};
+    }
+
+    void compute_masks() {
+        for (const auto &state : automaton_.states())
+            final_states_.push_back(state.is_final);
+
+        const auto &initial_state = automaton_.states()[automaton_.initial_state_id()];
+        const auto reads_everything = initial_state.transitions.contains(nfa::wildcard_symbol);
+        for (std::size_t symbol = 0; symbol < initiators_.size(); ++symbol)
+            initiators_[symbol] = reads_everything || initial_state.transitions.contains(static_cast<char>(symbol));
+    }
+};
+} // namespace suse
+
+#endif
@@ -0,0 +1,63 @@
+#include "compiled_query.hpp"
+#include "eviction_strategies.hpp"
+#include "probabilities.hpp"
+#include "regex.hpp"
+#include "summary_selector_count.hpp"
+
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+
+TEST_SUITE("suse::compiled_query") {
+    TEST_CASE("final states and initiators") {
+        const suse::compiled_query query{suse::parse_regex("(a|b)c*d")};
+
+        for (std::size_t state_id = 0; state_id < query.automaton().number_of_states(); ++state_id)
+            CHECK(query.is_final(state_id) == query.automaton().states()[state_id].is_final);
+
+        CHECK(query.is_initiator('a'));
+        CHECK(query.is_initiator('b'));
+        CHECK_FALSE(query.is_initiator('c'));
+        CHECK_FALSE(query.is_initiator('d'));
+
+        const suse::compiled_query wildcard{suse::parse_regex(".c")};
+        CHECK(wildcard.is_initiator('x'));
+        CHECK_FALSE(wildcard.has_strategy_tables());
+        CHECK_THROWS_AS(wildcard.strategy_tables<double>(), std::invalid_argument);
+    }
+
+    TEST_CASE("selectors share one compiled query") {
+        const std::string_view input = "aabcdacbadcbacdbcacbdaedabaaebdedaaddccdeaceabdebdeadaaabeadabdadbcadcdabeadeadcbedeaabbcbcbcacbccbabcdeacbdeabdad";
+        constexpr std::size_t time_window_size = 8;
+
+        const auto automaton = suse::parse_regex("a(b|c)*d");
+        const auto probabilities = suse::generate_uniform_probabilities<double>(automaton);
+        auto tables = suse::eviction_strategies::suse<long, double>::compute_expected_changes(automaton, time_window_size, probabilities);
+        const auto query = std::make_shared<const suse::compiled_query<>>(automaton, suse::compute_edges_per_character(automaton), time_window_size, std::move(tables));
+        CHECK(query->strategy_tables<double>().size() == (time_window_size + 1) * automaton.number_of_states() * automaton.number_of_states());
+        CHECK_THROWS_AS(query->strategy_tables<float>(), std::invalid_argument);
+
+        suse::summary_selector_count<long> shared0{query, 6, time_window_size}, shared1{query, 6, time_window_size};
+        suse::summary_selector_count<long> standalone{automaton, 6, time_window_size};
+        CHECK(shared0.query() == shared1.query());
+
+        const suse::eviction_strategies::suse<long, double> shared_strategy0{shared0}, shared_strategy1{shared1};
+        const suse::eviction_strategies::suse standalone_strategy{standalone, probabilities};
+
+        for (std::size_t idx = 0; idx < input.size(); ++idx) {
+            shared0.process_event({input[idx], 0, idx}, shared_strategy0);
+            shared1.process_event({input[idx], 0, idx}, shared_strategy1);
+            standalone.process_event({input[idx], 0, idx}, standalone_strategy);
+        }
+
+        CHECK(shared0 == standalone);
+        CHECK(shared1 == standalone);
+        CHECK(shared0.number_of_detected_complete_matches() == standalone.number_of_detected_complete_matches());
+
+        suse::summary_selector_count<long> other_window{query, 6, time_window_size + 1};
+        CHECK_THROWS_AS((suse::eviction_strategies::suse<long, double>{other_window}), std::invalid_argument);
+    }
+}
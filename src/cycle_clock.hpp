@@ -0,0 +1,45 @@
+#ifndef SUSE_CYCLE_CLOCK_HPP
+#define SUSE_CYCLE_CLOCK_HPP
+
+#include <chrono>
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#endif
+
+namespace suse {
+// Reads the time stamp counter where available, which takes a few nanoseconds instead of the tens a
+// steady_clock::now() may take, and falls back to steady_clock nanoseconds elsewhere. Ticks are converted to
+// time with a cycle_clock_calibration spanning the measurements, which assumes an invariant TSC.
+struct cycle_clock {
+    static std::uint64_t now() noexcept {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+};
+
+class cycle_clock_calibration {
+  public:
+    cycle_clock_calibration() : start_time_{std::chrono::steady_clock::now()}, start_ticks_{cycle_clock::now()} {}
+
+    // Nanoseconds per tick since construction, 1 if no time passed
+    double nanoseconds_per_tick() const {
+        const auto ticks = cycle_clock::now() - start_ticks_;
+        const auto elapsed = std::chrono::duration<double, std::nano>{std::chrono::steady_clock::now() - start_time_};
+        return ticks == 0 ? 1.0 : elapsed.count() / ticks;
+    }
+
+  private:
+    std::chrono::steady_clock::time_point start_time_;
+    std::uint64_t start_ticks_;
+};
+} // namespace suse
+
+#endif
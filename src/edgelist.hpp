@@ -18,6 +18,7 @@ struct edge {
 class edgelist {
   public:
     friend edgelist compute_edges_per_character(const nfa &automaton);
+    friend class query_artifact;
 
     std::span<const edge> edges_for(char symbol) const;
 
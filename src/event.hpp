@@ -10,6 +10,7 @@ struct event {
     char type;
     int value;
     std::size_t timestamp;
+    std::size_t key = 0; // partition key, streams without keys form a single partition
 
     friend constexpr auto operator<=>(const event &, const event &) = default;
 
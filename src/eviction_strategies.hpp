@@ -1,51 +1,146 @@
 #ifndef SUSE_EVICTION_STRATEGIES_HPP
 #define SUSE_EVICTION_STRATEGIES_HPP
 
+#include "compiled_query.hpp"
 #include "event.hpp"
 #include "execution_state_counter.hpp"
+#include "memory_footprint.hpp"
 #include "summary_selector_base.hpp"
 
+#include <algorithm>
+#include <memory>
 #include <optional>
 #include <random>
+#include <span>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 #include <cstddef>
 
+namespace suse {
+// Strategy selected at runtime, e.g. from the command line, by front ends running many selectors
+enum class query_strategy {
+    suse,
+    fifo,
+    random
+};
+
+inline std::optional<query_strategy> parse_query_strategy(std::string_view name) {
+    if (name == "suse")
+        return query_strategy::suse;
+    if (name == "fifo")
+        return query_strategy::fifo;
+    if (name == "random")
+        return query_strategy::random;
+
+    return std::nullopt;
+}
+} // namespace suse
+
 namespace suse::eviction_strategies {
-inline auto fifo = [](const auto &cache, const auto &event) -> std::size_t {
-    return 0;
+struct fifo_strategy {
+    static constexpr bool reads_state_counters = false;
+
+    std::size_t operator()(const auto &selector, const event &) const {
+        return 0;
+    }
+
+    // The oldest count events, so the first entry of a run is repeated for each of its events
+    std::vector<std::size_t> select_batch(const auto &selector, const event &, std::size_t count) const {
+        std::vector<std::size_t> selected;
+        const auto events = selector.cached_events();
+        for (std::size_t idx = 0; idx < events.size() && selected.size() < count; ++idx)
+            selected.insert(selected.end(), std::min(events[idx].multiplicity, count - selected.size()), idx);
+
+        return selected;
+    }
 };
 
-inline auto random = []<typename counter_type>(const summary_selector_base<counter_type> &selector, const event &) -> std::size_t {
-    static std::mt19937 random_gen(std::random_device{}());
-    std::uniform_int_distribution<std::size_t> dist(0, selector.cached_events().size() - 1);
+struct random_strategy {
+    static constexpr bool reads_state_counters = false;
+
+    template <typename counter_type, typename transitions_type>
+    std::size_t operator()(const summary_selector_base<counter_type, transitions_type> &selector, const event &) const {
+        std::uniform_int_distribution<std::size_t> dist(0, selector.cached_events().size() - 1);
+        return dist(generator());
+    }
+
+    // count distinct entries
+    template <typename counter_type, typename transitions_type>
+    std::vector<std::size_t> select_batch(const summary_selector_base<counter_type, transitions_type> &selector, const event &, std::size_t count) const {
+        std::vector<std::size_t> selected;
+        const auto number_of_entries = selector.cached_events().size();
+        for (std::size_t idx = 0; idx < number_of_entries && selected.size() < count; ++idx) {
+            std::uniform_int_distribution<std::size_t> dist(0, number_of_entries - idx - 1);
+            if (dist(generator()) < count - selected.size())
+                selected.push_back(idx);
+        }
 
-    return dist(random_gen);
+        return selected;
+    }
+
+  private:
+    static std::mt19937 &generator() {
+        thread_local std::mt19937 random_gen(std::random_device{}()); // selectors may run on several threads
+        return random_gen;
+    }
 };
 
-template <typename counter_type, typename factor_type>
+inline constexpr fifo_strategy fifo{};
+inline constexpr random_strategy random{};
+
+template <typename counter_type, typename factor_type, typename transitions_type = edgelist>
 class suse {
-    using selector_type = summary_selector_base<counter_type>;
+    using selector_type = summary_selector_base<counter_type, transitions_type>;
     using state_counter_type = execution_state_counter<counter_type>;
 
   public:
     explicit suse(const selector_type &selector, const std::unordered_map<char, factor_type> &probabilities);
 
+    // Uses precomputed tables, e.g. from a query_artifact, without copying them. They must outlive the strategy.
+    suse(const selector_type &selector, std::span<const factor_type> expected_changes);
+
+    // Uses the tables of the selector's compiled query, which the strategy keeps alive.
+    // Throws std::invalid_argument if it has none for factor_type and the selector's time window.
+    explicit suse(const selector_type &selector);
+
     std::optional<std::size_t> select(const selector_type &selector, const event &event) const;
 
+    // Up to count entries with the lowest benefit, all of them lower than that of the new event
+    std::vector<std::size_t> select_batch(const selector_type &selector, const event &event, std::size_t count) const;
+
+    // Factor of each source state's count on each target state's count after 0 to time_window_size further
+    // events, laid out as [distance][target state][source state].
+    static std::vector<factor_type> compute_expected_changes(const nfa &automaton, std::size_t time_window_size, const std::unordered_map<char, factor_type> &probabilities);
+
+    // Memory of the tables the strategy reads. Tables owned elsewhere, e.g. by a query artifact, count their
+    // bytes but no allocation.
+    memory_footprint table_footprint() const {
+        if (!owned_expected_changes_.empty())
+            return footprint_of(owned_expected_changes_);
+        return {0, external_expected_changes_.size_bytes()};
+    }
+
   private:
-    struct state_change {
-        std::vector<execution_state_counter<factor_type>> factors_per_state;
-    };
-    std::vector<state_change> expected_change_at_distance_; // name is bad...
+    std::vector<factor_type> owned_expected_changes_;
+    std::span<const factor_type> external_expected_changes_; // used if nothing is owned
+    std::shared_ptr<const compiled_query<transitions_type>> shared_query_; // owner of external tables, if any
+    std::size_t number_of_states_;
 
-    state_change determine_followup(const state_change &previous, const selector_type &selector, const std::unordered_map<char, factor_type> &probabilities) const;
+    std::span<const factor_type> factors_at(std::size_t distance, std::size_t target_state) const {
+        const auto expected_change_at_distance = owned_expected_changes_.empty() ? external_expected_changes_ : std::span<const factor_type>{owned_expected_changes_}; // name is bad...
+        return expected_change_at_distance.subspan((distance * number_of_states_ + target_state) * number_of_states_, number_of_states_);
+    }
 
-    factor_type apply(const state_counter_type &counts, const execution_state_counter<factor_type> &factors) const;
+    factor_type apply(const state_counter_type &counts, std::span<const factor_type> factors) const;
 
     factor_type current_benefit(const selector_type &selector, const state_counter_type &counts) const;
     factor_type expected_future_benefit(const selector_type &selector, const state_counter_type &counts, std::size_t min_remaining, std::size_t max_remaining) const;
+
+    // Calls visit(idx, benefit) for each cached entry and returns the benefit of adding the new event
+    template <typename visitor_type>
+    factor_type visit_benefits(const selector_type &selector, const event &new_event, visitor_type &&visit) const;
 };
 } // namespace suse::eviction_strategies
 
@@ -4,6 +4,7 @@
 
 #include <doctest/doctest.h>
 
+#include <set>
 #include <unordered_map>
 
 TEST_SUITE("suse::eviction_strategies") {
@@ -21,4 +22,42 @@ TEST_SUITE("suse::eviction_strategies") {
 
         CHECK(selector == correct_selector);
     }
+
+    TEST_CASE("suse selects batches by benefit") {
+        const std::string_view input = "abcabbcacbacbbacabcabcb";
+        const std::unordered_map<char, double> probabilities{{'a', 0.3}, {'b', 0.4}, {'c', 0.3}};
+
+        suse::summary_selector_count<int> selector{"ab*c", input.size(), 6};
+        const suse::eviction_strategies::suse<int, double> strategy{selector, probabilities};
+        for (std::size_t idx = 0; auto c : input)
+            selector.process_event({c, 0, idx++});
+
+        for (auto c : {'a', 'b', 'c'}) {
+            const suse::event next{c, 0, input.size()};
+            const auto selected = strategy.select(selector, next);
+            const auto single = strategy.select_batch(selector, next, 1);
+            CHECK(single.size() == (selected ? 1 : 0));
+            if (selected && !single.empty())
+                CHECK(single.front() == *selected);
+
+            const auto batch = strategy.select_batch(selector, next, 5);
+            CHECK(batch.size() <= 5);
+            CHECK(std::set<std::size_t>(batch.begin(), batch.end()).size() == batch.size());
+        }
+    }
+
+    TEST_CASE("suse table footprint") {
+        const std::unordered_map<char, double> probabilities{{'a', 0.3}, {'b', 0.4}, {'c', 0.3}};
+        suse::summary_selector_count<int> selector{"ab*c", 10, 6};
+        const suse::eviction_strategies::suse<int, double> strategy{selector, probabilities};
+
+        const auto states = selector.automaton().number_of_states();
+        const auto tables = suse::eviction_strategies::suse<int, double>::compute_expected_changes(selector.automaton(), 6, probabilities);
+        CHECK(tables.size() == 7 * states * states);
+        CHECK(strategy.table_footprint().allocations == 1);
+        CHECK(strategy.table_footprint().bytes >= tables.size() * sizeof(double));
+
+        const suse::eviction_strategies::suse<int, double> borrowing{selector, std::span<const double>{tables}};
+        CHECK(borrowing.table_footprint() == suse::memory_footprint{0, tables.size() * sizeof(double)});
+    }
 }
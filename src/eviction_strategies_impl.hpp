@@ -5,51 +5,109 @@
 */
 
 #include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 
 #include <cstddef>
 
 namespace suse::eviction_strategies {
 
-template <typename counter_type, typename factor_type>
-suse<counter_type, factor_type>::suse(const selector_type &selector, const std::unordered_map<char, factor_type> &probabilities) {
-    state_change identity_factors{};
-    for (std::size_t state_id = 0; state_id < selector.automaton().number_of_states(); ++state_id) {
-        execution_state_counter<factor_type> factors{selector.automaton().number_of_states()};
-        factors[state_id] = factor_type{1};
-        identity_factors.factors_per_state.push_back(std::move(factors));
-    }
-    expected_change_at_distance_.push_back(std::move(identity_factors));
-
-    for (std::size_t i = 0; i < selector.time_window_size(); ++i) {
-        auto followup = determine_followup(expected_change_at_distance_.back(), selector, probabilities);
-        expected_change_at_distance_.push_back(std::move(followup));
-    }
+template <typename counter_type, typename factor_type, typename transitions_type>
+suse<counter_type, factor_type, transitions_type>::suse(const selector_type &selector, const std::unordered_map<char, factor_type> &probabilities)
+    : owned_expected_changes_{compute_expected_changes(selector.automaton(), selector.time_window_size(), probabilities)},
+      number_of_states_{selector.automaton().number_of_states()} {}
+
+template <typename counter_type, typename factor_type, typename transitions_type>
+suse<counter_type, factor_type, transitions_type>::suse(const selector_type &selector, std::span<const factor_type> expected_changes)
+    : external_expected_changes_{expected_changes},
+      number_of_states_{selector.automaton().number_of_states()} {
+    if (expected_changes.size() != (selector.time_window_size() + 1) * number_of_states_ * number_of_states_)
+        throw std::invalid_argument("Precomputed tables do not match the automaton and time window of the selector");
 }
 
-template <typename counter_type, typename factor_type>
-auto suse<counter_type, factor_type>::determine_followup(const state_change &previous, const selector_type &selector, const std::unordered_map<char, factor_type> &probabilities) const -> state_change {
-    const auto &automaton = selector.automaton();
+template <typename counter_type, typename factor_type, typename transitions_type>
+suse<counter_type, factor_type, transitions_type>::suse(const selector_type &selector)
+    : suse(selector, selector.query()->template strategy_tables<factor_type>()) {
+    if (selector.query()->strategy_tables_time_window_size() != selector.time_window_size())
+        throw std::invalid_argument("Strategy tables of the compiled query were computed for a different time window");
+
+    shared_query_ = selector.query();
+}
 
-    auto next = previous;
-    for (std::size_t source_id = 0; source_id < automaton.number_of_states(); ++source_id) {
-        for (const auto &[symbol, destination_ids] : automaton.states()[source_id].transitions) {
-            if (auto it = probabilities.find(symbol); it != probabilities.end()) {
-                for (auto destination_id : destination_ids)
-                    next.factors_per_state[destination_id] += it->second * previous.factors_per_state[source_id];
+template <typename counter_type, typename factor_type, typename transitions_type>
+std::vector<factor_type> suse<counter_type, factor_type, transitions_type>::compute_expected_changes(const nfa &automaton, std::size_t time_window_size, const std::unordered_map<char, factor_type> &probabilities) {
+    const auto n = automaton.number_of_states();
+    const auto table_size = n * n;
+
+    std::vector<factor_type> result((time_window_size + 1) * table_size, factor_type{0});
+    for (std::size_t state_id = 0; state_id < n; ++state_id)
+        result[state_id * n + state_id] = factor_type{1};
+
+    for (std::size_t distance = 1; distance <= time_window_size; ++distance) {
+        const auto previous = result.begin() + static_cast<std::ptrdiff_t>((distance - 1) * table_size);
+        const auto next = result.begin() + static_cast<std::ptrdiff_t>(distance * table_size);
+        std::copy(previous, next, next);
+
+        for (std::size_t source_id = 0; source_id < n; ++source_id) {
+            for (const auto &[symbol, destination_ids] : automaton.states()[source_id].transitions) {
+                if (auto it = probabilities.find(symbol); it != probabilities.end()) {
+                    for (auto destination_id : destination_ids) {
+                        for (std::size_t origin = 0; origin < n; ++origin)
+                            next[destination_id * n + origin] += it->second * previous[source_id * n + origin];
+                    }
+                }
             }
         }
     }
 
-    return next;
+    return result;
 }
 
-template <typename counter_type, typename factor_type>
-std::optional<std::size_t> suse<counter_type, factor_type>::select(const selector_type &selector, const event &new_event) const {
-    const auto is_initiator = [&](char symbol) {
-        const auto &automaton = selector.automaton();
-        const auto &initial_state = automaton.states()[automaton.initial_state_id()];
+template <typename counter_type, typename factor_type, typename transitions_type>
+std::optional<std::size_t> suse<counter_type, factor_type, transitions_type>::select(const selector_type &selector, const event &new_event) const {
+    std::optional<factor_type> lowest_benefit = std::nullopt;
+    std::size_t lowest_idx = 0;
+    const auto benefit_if_added = visit_benefits(selector, new_event, [&](std::size_t idx, factor_type benefit) {
+        if (!lowest_benefit || benefit < *lowest_benefit) {
+            lowest_benefit = std::move(benefit);
+            lowest_idx = idx;
+        }
+    });
+
+    if (benefit_if_added > *lowest_benefit)
+        return lowest_idx;
+
+    return std::nullopt;
+}
 
-        return initial_state.transitions.count(nfa::wildcard_symbol) > 0 || initial_state.transitions.count(symbol) > 0;
+template <typename counter_type, typename factor_type, typename transitions_type>
+std::vector<std::size_t> suse<counter_type, factor_type, transitions_type>::select_batch(const selector_type &selector, const event &new_event, std::size_t count) const {
+    std::vector<std::pair<factor_type, std::size_t>> benefits;
+    const auto benefit_if_added = visit_benefits(selector, new_event, [&](std::size_t idx, factor_type benefit) {
+        benefits.emplace_back(std::move(benefit), idx);
+    });
+
+    std::erase_if(benefits, [&](const auto &entry) { return !(benefit_if_added > entry.first); });
+    if (benefits.size() > count) {
+        std::nth_element(benefits.begin(), benefits.begin() + count, benefits.end());
+        benefits.resize(count);
+    }
+
+    std::vector<std::size_t> selected;
+    selected.reserve(benefits.size());
+    for (const auto &[_, idx] : benefits)
+        selected.push_back(idx);
+
+    return selected;
+}
+
+template <typename counter_type, typename factor_type, typename transitions_type>
+template <typename visitor_type>
+factor_type suse<counter_type, factor_type, transitions_type>::visit_benefits(const selector_type &selector, const event &new_event, visitor_type &&visit) const {
+    const auto is_initiator = [&](char symbol) {
+        return selector.query()->is_initiator(symbol);
     };
 
     const auto &events = selector.cached_events();
@@ -57,8 +115,6 @@ std::optional<std::size_t> suse<counter_type, factor_type>::select(const selecto
 
     std::size_t oldest_initiator = 0, newest_initiator = 0;
 
-    std::optional<factor_type> lowest_benefit = std::nullopt;
-    std::size_t lowest_idx = 0;
     for (std::size_t idx = 0; idx < events.size(); ++idx) {
         const auto &event = events[idx];
         if (idx >= window.start_idx && is_initiator(event.cached_event.type)) {
@@ -75,28 +131,21 @@ std::optional<std::size_t> suse<counter_type, factor_type>::select(const selecto
         if (idx >= window.start_idx)
             benefit += expected_future_benefit(selector, window.per_event_counters[idx - window.start_idx], min_time_left, max_time_left);
 
-        if (!lowest_benefit || benefit < *lowest_benefit) {
-            lowest_benefit = std::move(benefit);
-            lowest_idx = idx;
-        }
+        visit(idx, std::move(benefit));
     }
 
-    const auto new_counters = advance(selector.active_counts(), selector.automaton(), new_event.type);
+    const auto new_counters = advance(selector.active_counts(), selector.query()->transitions(), new_event.type);
     auto newest_init_time = is_initiator(new_event.type) ? new_event.timestamp : events[newest_initiator].cached_event.timestamp;
     const auto min_time_used = selector.current_time() - newest_init_time;
     const auto max_time_used = selector.current_time() - events[oldest_initiator].cached_event.timestamp;
     const auto min_time_left = max_time_used > selector.time_window_size() ? 0 : selector.time_window_size() - max_time_used;
     const auto max_time_left = min_time_used > selector.time_window_size() ? 0 : selector.time_window_size() - min_time_used;
 
-    const auto benefit_if_added = current_benefit(selector, new_counters) + expected_future_benefit(selector, new_counters, min_time_left, max_time_left);
-    if (benefit_if_added > *lowest_benefit)
-        return lowest_idx;
-
-    return std::nullopt;
+    return current_benefit(selector, new_counters) + expected_future_benefit(selector, new_counters, min_time_left, max_time_left);
 }
 
-template <typename counter_type, typename factor_type>
-factor_type suse<counter_type, factor_type>::apply(const state_counter_type &counts, const execution_state_counter<factor_type> &factors) const {
+template <typename counter_type, typename factor_type, typename transitions_type>
+factor_type suse<counter_type, factor_type, transitions_type>::apply(const state_counter_type &counts, std::span<const factor_type> factors) const {
     const auto multiply = [](const factor_type &factor, const counter_type &counter) {
         return factor * static_cast<factor_type>(counter);
     };
@@ -104,25 +153,22 @@ factor_type suse<counter_type, factor_type>::apply(const state_counter_type &cou
     return std::inner_product(factors.begin(), factors.end(), counts.begin(), factor_type{0}, std::plus<>{}, multiply);
 }
 
-template <typename counter_type, typename factor_type>
-factor_type suse<counter_type, factor_type>::current_benefit(const selector_type &selector, const state_counter_type &counts) const {
+template <typename counter_type, typename factor_type, typename transitions_type>
+factor_type suse<counter_type, factor_type, transitions_type>::current_benefit(const selector_type &selector, const state_counter_type &counts) const {
     factor_type sum{};
     for (std::size_t idx = 0; idx < counts.size(); ++idx) {
-        if (selector.automaton().states()[idx].is_final)
+        if (selector.query()->is_final(idx))
             sum += static_cast<factor_type>(counts[idx]);
     }
     return sum;
 }
 
-template <typename counter_type, typename factor_type>
-factor_type suse<counter_type, factor_type>::expected_future_benefit(const selector_type &selector, const state_counter_type &counts, std::size_t min_remaining, std::size_t max_remaining) const {
-    const auto &min_factors = expected_change_at_distance_[min_remaining].factors_per_state;
-    const auto &max_factors = expected_change_at_distance_[max_remaining].factors_per_state;
-
+template <typename counter_type, typename factor_type, typename transitions_type>
+factor_type suse<counter_type, factor_type, transitions_type>::expected_future_benefit(const selector_type &selector, const state_counter_type &counts, std::size_t min_remaining, std::size_t max_remaining) const {
     factor_type sum{};
     for (std::size_t idx = 0; idx < counts.size(); ++idx) {
-        if (selector.automaton().states()[idx].is_final)
-            sum += (apply(counts, min_factors[idx]) + apply(counts, max_factors[idx])) / static_cast<factor_type>(2);
+        if (selector.query()->is_final(idx))
+            sum += (apply(counts, factors_at(min_remaining, idx)) + apply(counts, factors_at(max_remaining, idx))) / static_cast<factor_type>(2);
     }
     return sum - current_benefit(selector, counts);
 }
@@ -1,6 +1,10 @@
+#include "bit_parallel_nfa.hpp"
 #include "edgelist.hpp"
+#include "eviction_strategies.hpp"
 #include "execution_state_counter.hpp"
 #include "regex.hpp"
+#include "static_query.hpp"
+#include "summary_selector_count.hpp"
 
 #include <boost/multiprecision/cpp_int.hpp>
 
@@ -8,6 +12,18 @@
 
 #include <nanobench.h>
 
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+namespace {
+// regex_compiler "(a|b)(b|c)(c|d)e?f?gh+|(a|b)(b|c)(c|d)e?f?gj+" --reduce --emit-header ... --header-name sample_query
+inline constexpr suse::static_query<15, 28> sample_query{
+    0,
+    {false, false, false, false, false, false, false, true, true, false, false, false, false, false, false},
+    {{{'a', 0, 1}, {'a', 0, 9}, {'b', 0, 1}, {'b', 0, 9}, {'b', 1, 2}, {'b', 9, 10}, {'c', 1, 2}, {'c', 2, 3}, {'c', 9, 10}, {'c', 10, 11}, {'d', 2, 3}, {'d', 10, 11}, {'e', 3, 4}, {'e', 11, 12}, {'f', 3, 5}, {'f', 4, 5}, {'f', 11, 13}, {'f', 12, 13}, {'g', 3, 6}, {'g', 4, 6}, {'g', 5, 6}, {'g', 11, 14}, {'g', 12, 14}, {'g', 13, 14}, {'h', 6, 7}, {'h', 7, 7}, {'j', 8, 8}, {'j', 14, 8}}}};
+} // namespace
+
 TEST_SUITE("suse::execution_state_counter") {
     TEST_CASE("check vs counter_check") {
         const auto sample = suse::parse_regex("(a|b)(b|c)(c|d)e?f?gh+|(a|b)(b|c)(c|d)e?f?gj+");
@@ -35,13 +51,18 @@ TEST_SUITE("suse::execution_state_counter") {
             ankerl::nanobench::doNotOptimizeAway(sample.check(input));
         });
 
+        const suse::bit_parallel_nfa matcher{sample};
+        b.run("bit_parallel_nfa.check", [&]() {
+            ankerl::nanobench::doNotOptimizeAway(matcher.check(input));
+        });
+
         b.run("advance execution_state_counter check", [&]() {
             ankerl::nanobench::doNotOptimizeAway(counter_check(input));
         });
     }
 
     TEST_CASE("per-state-transitions vs edge-list") {
-        const auto sample = suse::parse_regex("(a|b)(b|c)(c|d)e?f?gh+|(a|b)(b|c)(c|d)e?f?gj+");
+        const auto sample = suse::parse_regex("(a|b)(b|c)(c|d)e?f?gh+|(a|b)(b|c)(c|d)e?f?gj+", {.reduce = true});
 
         const auto counter_check = [&](std::string_view input) {
             auto counter = suse::execution_state_counter<int>(sample.number_of_states());
@@ -75,6 +96,23 @@ TEST_SUITE("suse::execution_state_counter") {
             return false;
         };
 
+        const suse::static_edgelist<sample_query> static_edges{sample};
+
+        const auto counter_check_static = [&](std::string_view input) {
+            auto counter = suse::execution_state_counter<int>(sample.number_of_states());
+            counter[sample.initial_state_id()] = 1;
+
+            for (auto c : input)
+                counter = advance(counter, static_edges, c);
+
+            for (std::size_t i = 0; i < sample.number_of_states(); ++i) {
+                if (sample.states()[i].is_final && counter[i] > 0)
+                    return true;
+            }
+
+            return false;
+        };
+
         auto b = ankerl::nanobench::Bench();
         b.relative(true);
 
@@ -86,5 +124,70 @@ TEST_SUITE("suse::execution_state_counter") {
         b.run("advance edgelist", [&]() {
             ankerl::nanobench::doNotOptimizeAway(counter_check_edgelist(input));
         });
+
+        b.run("advance static_edgelist", [&]() {
+            ankerl::nanobench::doNotOptimizeAway(counter_check_static(input));
+        });
+    }
+
+    TEST_CASE("run-length compressed window") {
+        const auto sample = suse::parse_regex("(a|b)(b|c)(c|d)e?f?gh+|(a|b)(b|c)(c|d)e?f?gj+");
+
+        // bursts of h sharing one timestamp, at most 60 events per time window
+        std::vector<suse::event> events;
+        for (std::size_t timestamp = 0; timestamp < 200 * 30; timestamp += 30) {
+            for (auto c : std::string_view{"abdefg"})
+                events.push_back({c, 0, timestamp});
+            for (std::size_t repetition = 0; repetition < 20; ++repetition)
+                events.push_back({'h', 0, timestamp});
+        }
+
+        const auto count = [&](bool compress) {
+            suse::summary_selector_count<boost::multiprecision::uint128_t> selector{sample, events.size(), 60};
+            selector.enable_run_length_compression(compress);
+            for (const auto &e : events)
+                selector.process_event(e);
+            return selector.number_of_detected_complete_matches();
+        };
+
+        auto b = ankerl::nanobench::Bench();
+        b.relative(true);
+
+        b.run("uncompressed window", [&]() {
+            ankerl::nanobench::doNotOptimizeAway(count(false));
+        });
+
+        b.run("run-length compressed window", [&]() {
+            ankerl::nanobench::doNotOptimizeAway(count(true));
+        });
+    }
+
+    TEST_CASE("replay scratch memory") {
+        const auto sample = suse::parse_regex("(a|b)(b|c)(c|d)e?f?gh+|(a|b)(b|c)(c|d)e?f?gj+");
+
+        // every eviction replays about one time window of events
+        std::vector<suse::event> events;
+        for (std::size_t timestamp = 0; timestamp < 5000; ++timestamp)
+            events.push_back({"abcdefghj"[timestamp % 9], 0, timestamp});
+
+        const auto count = [&](std::pmr::memory_resource *scratch) {
+            suse::summary_selector_count<boost::multiprecision::uint128_t> selector{sample, 100, 50};
+            if (scratch)
+                selector.use_scratch_resource(*scratch);
+            for (const auto &e : events)
+                selector.process_event(e, suse::eviction_strategies::fifo);
+            return selector.number_of_detected_complete_matches();
+        };
+
+        auto b = ankerl::nanobench::Bench();
+        b.relative(true);
+
+        b.run("new_delete_resource", [&]() {
+            ankerl::nanobench::doNotOptimizeAway(count(std::pmr::new_delete_resource()));
+        });
+
+        b.run("arena_resource", [&]() {
+            ankerl::nanobench::doNotOptimizeAway(count(nullptr));
+        });
     }
 }
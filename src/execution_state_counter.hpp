@@ -2,9 +2,11 @@
 #define SUSE_EXECUTION_STATE_COUNTER_HPP
 
 #include "edgelist.hpp"
+#include "memory_footprint.hpp"
 #include "nfa.hpp"
 #include "event.hpp"
 
+#include <memory_resource>
 #include <type_traits>
 #include <unordered_map>
 #include <vector>
@@ -13,10 +15,23 @@
 #include <cstddef>
 
 namespace suse {
+// Allocator-aware, so counters in a std::pmr container share its memory resource. Copies use the default
+// resource unless given one, so copying a counter out of scratch memory is always safe.
 template <typename underlying_counter_type>
 struct execution_state_counter {
   public:
-    explicit execution_state_counter(std::size_t number_of_states) : counters_(number_of_states, 0) {}
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    explicit execution_state_counter(std::size_t number_of_states, const allocator_type &allocator = {}) : counters_(number_of_states, 0, allocator) {}
+    execution_state_counter(const execution_state_counter &) = default;
+    execution_state_counter(execution_state_counter &&) noexcept = default;
+    execution_state_counter(const execution_state_counter &other, const allocator_type &allocator) : counters_(other.counters_, allocator) {}
+    execution_state_counter(execution_state_counter &&other, const allocator_type &allocator) : counters_(std::move(other.counters_), allocator) {}
+
+    execution_state_counter &operator=(const execution_state_counter &) = default;
+    execution_state_counter &operator=(execution_state_counter &&) = default;
+
+    allocator_type get_allocator() const { return counters_.get_allocator(); }
 
     std::size_t size() const { return counters_.size(); }
 
@@ -52,6 +67,10 @@ struct execution_state_counter {
 
     friend auto operator<=>(const execution_state_counter &, const execution_state_counter &) = default;
 
+    friend memory_footprint footprint_of(const execution_state_counter &counter) {
+        return footprint_of(counter.counters_);
+    }
+
     friend std::ostream &operator<<(std::ostream &os, const execution_state_counter &c) {
         for (size_t i = 0; i < c.size(); i++) {
             os << c[i] << std::endl;
@@ -60,20 +79,44 @@ struct execution_state_counter {
     }
 
   private:
-    std::vector<underlying_counter_type> counters_;
+    std::pmr::vector<underlying_counter_type> counters_;
 };
 
+// Results are allocated with the given allocator, e.g. from scratch memory for temporaries
 template <typename underlying_counter_type>
-execution_state_counter<underlying_counter_type> advance(const execution_state_counter<underlying_counter_type> &counter, const nfa &automaton, char symbol);
+execution_state_counter<underlying_counter_type> advance(const execution_state_counter<underlying_counter_type> &counter, const nfa &automaton, char symbol, const typename execution_state_counter<underlying_counter_type>::allocator_type &allocator = {});
 
 template <typename underlying_counter_type>
-execution_state_counter<underlying_counter_type> advance(const execution_state_counter<underlying_counter_type> &counter, const edgelist &per_character_edges, char symbol);
+execution_state_counter<underlying_counter_type> advance(const execution_state_counter<underlying_counter_type> &counter, const edgelist &per_character_edges, char symbol, const typename execution_state_counter<underlying_counter_type>::allocator_type &allocator = {});
+
+// Advances counters by the same symbol k times at once, using the (k-1)-th power of the transfer matrix
+// I + T, where T is the matrix of advance. Computing the power costs O(n^3 log k) for n states, so this pays
+// off when the same run of events is applied to many counters, e.g. all counters of a time window.
+template <typename underlying_counter_type, typename transitions_type = edgelist>
+class repeated_advance {
+  public:
+    repeated_advance(const transitions_type &transitions, std::size_t number_of_states, char symbol, std::size_t repetitions);
+
+    // Change of the counter after all repetitions, i.e. (I + T)^k c - c
+    execution_state_counter<underlying_counter_type> total_change(const execution_state_counter<underlying_counter_type> &counter, const typename execution_state_counter<underlying_counter_type>::allocator_type &allocator = {}) const;
+
+    // Change caused by the last repetition alone, i.e. T (I + T)^(k-1) c
+    execution_state_counter<underlying_counter_type> last_change(const execution_state_counter<underlying_counter_type> &counter, const typename execution_state_counter<underlying_counter_type>::allocator_type &allocator = {}) const;
+
+  private:
+    const transitions_type *transitions_;
+    std::size_t number_of_states_;
+    char symbol_;
+    std::vector<underlying_counter_type> preceding_; // (I + T)^(k-1), row-major
+
+    execution_state_counter<underlying_counter_type> apply_preceding(const execution_state_counter<underlying_counter_type> &counter, const typename execution_state_counter<underlying_counter_type>::allocator_type &allocator) const;
+};
 
 template <typename underlying_counter_type>
-execution_state_counter<underlying_counter_type> advance_sum(const execution_state_counter<underlying_counter_type> &count_counter, const execution_state_counter<underlying_counter_type> &sum_counter, const edgelist &per_character_edges, const event &event);
+execution_state_counter<underlying_counter_type> advance_sum(const execution_state_counter<underlying_counter_type> &count_counter, const execution_state_counter<underlying_counter_type> &sum_counter, const edgelist &per_character_edges, const event &event, const typename execution_state_counter<underlying_counter_type>::allocator_type &allocator = {});
 
 template <typename underlying_counter_type>
-execution_state_counter<underlying_counter_type> advance_prod(const execution_state_counter<underlying_counter_type> &count_counter, const execution_state_counter<underlying_counter_type> &mult_counter, const edgelist &per_character_edges, const event &event);
+execution_state_counter<underlying_counter_type> advance_prod(const execution_state_counter<underlying_counter_type> &count_counter, const execution_state_counter<underlying_counter_type> &mult_counter, const edgelist &per_character_edges, const event &event, const typename execution_state_counter<underlying_counter_type>::allocator_type &allocator = {});
 } // namespace suse
 
 #include "execution_state_counter_impl.hpp"
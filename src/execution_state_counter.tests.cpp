@@ -60,4 +60,32 @@ TEST_SUITE("suse::execution_state_counter") {
         CHECK(sample.check("acde") == counter_check("acde"));
         CHECK(sample.check("ade") == counter_check("ade"));
     }
+
+    TEST_CASE("repeated advance equals advancing repeatedly") {
+        for (const auto query : {"a(b|c)d?e", "ab+c", "a(b*c)*b"}) {
+            CAPTURE(query);
+            const auto automaton = suse::parse_regex(query);
+            const auto edges = suse::compute_edges_per_character(automaton);
+
+            auto counter = suse::execution_state_counter<boost::multiprecision::uint128_t>(automaton.number_of_states());
+            counter[automaton.initial_state_id()] = 1;
+            for (auto c : "abcb")
+                counter += advance(counter, edges, c);
+
+            for (std::size_t repetitions = 1; repetitions < 20; ++repetitions) {
+                CAPTURE(repetitions);
+                const suse::repeated_advance<boost::multiprecision::uint128_t> run{edges, automaton.number_of_states(), 'b', repetitions};
+
+                auto expected = counter;
+                auto last_change = counter;
+                for (std::size_t i = 0; i < repetitions; ++i) {
+                    last_change = advance(expected, edges, 'b');
+                    expected += last_change;
+                }
+
+                CHECK(run.total_change(counter) == expected - counter);
+                CHECK(run.last_change(counter) == last_change);
+            }
+        }
+    }
 }
@@ -45,10 +45,10 @@ execution_state_counter<underlying> &execution_state_counter<underlying>::operat
 }
 
 template <typename underlying>
-execution_state_counter<underlying> advance(const execution_state_counter<underlying> &counter, const nfa &automaton, char symbol) {
+execution_state_counter<underlying> advance(const execution_state_counter<underlying> &counter, const nfa &automaton, char symbol, const typename execution_state_counter<underlying>::allocator_type &allocator) {
     assert(counter.size() == automaton.number_of_states());
 
-    auto followup = execution_state_counter<underlying>{counter.size()};
+    auto followup = execution_state_counter<underlying>{counter.size(), allocator};
 
     for (std::size_t source_id = 0; source_id < automaton.number_of_states(); ++source_id) {
         const auto add_for = [&](auto s) {
@@ -68,8 +68,8 @@ execution_state_counter<underlying> advance(const execution_state_counter<underl
 }
 
 template <typename underlying>
-execution_state_counter<underlying> advance(const execution_state_counter<underlying> &counter, const edgelist &per_character_edges, char symbol) {
-    auto followup = execution_state_counter<underlying>{counter.size()};
+execution_state_counter<underlying> advance(const execution_state_counter<underlying> &counter, const edgelist &per_character_edges, char symbol, const typename execution_state_counter<underlying>::allocator_type &allocator) {
+    auto followup = execution_state_counter<underlying>{counter.size(), allocator};
 
     const auto add_for = [&](auto s) {
         for (const auto &e : per_character_edges.edges_for(s))
@@ -82,14 +82,83 @@ execution_state_counter<underlying> advance(const execution_state_counter<underl
     return followup;
 }
 
+template <typename underlying, typename transitions_type>
+repeated_advance<underlying, transitions_type>::repeated_advance(const transitions_type &transitions, std::size_t number_of_states, char symbol, std::size_t repetitions)
+    : transitions_{&transitions},
+      number_of_states_{number_of_states},
+      symbol_{symbol},
+      preceding_(number_of_states * number_of_states, 0) {
+    assert(repetitions > 0);
+
+    const auto n = number_of_states;
+    const auto multiply = [n](const std::vector<underlying> &lhs, const std::vector<underlying> &rhs) {
+        std::vector<underlying> product(n * n, 0);
+        for (std::size_t row = 0; row < n; ++row) {
+            for (std::size_t k = 0; k < n; ++k) {
+                if (lhs[row * n + k] == 0)
+                    continue;
+                for (std::size_t column = 0; column < n; ++column)
+                    product[row * n + column] += lhs[row * n + k] * rhs[k * n + column];
+            }
+        }
+        return product;
+    };
+
+    // column j of I + T is the unit counter of state j advanced by the symbol
+    std::vector<underlying> step(n * n, 0);
+    for (std::size_t column = 0; column < n; ++column) {
+        execution_state_counter<underlying> unit{n};
+        unit[column] = 1;
+        const auto change = advance(unit, transitions, symbol);
+        for (std::size_t row = 0; row < n; ++row)
+            step[row * n + column] = change[row];
+        step[column * n + column] += 1;
+    }
+
+    for (std::size_t state_id = 0; state_id < n; ++state_id)
+        preceding_[state_id * n + state_id] = 1;
+
+    for (auto exponent = repetitions - 1; exponent > 0; exponent /= 2) {
+        if (exponent % 2 == 1)
+            preceding_ = multiply(preceding_, step);
+        if (exponent > 1)
+            step = multiply(step, step);
+    }
+}
+
+template <typename underlying, typename transitions_type>
+execution_state_counter<underlying> repeated_advance<underlying, transitions_type>::apply_preceding(const execution_state_counter<underlying> &counter, const typename execution_state_counter<underlying>::allocator_type &allocator) const {
+    assert(counter.size() == number_of_states_);
+
+    execution_state_counter<underlying> result{number_of_states_, allocator};
+    for (std::size_t row = 0; row < number_of_states_; ++row) {
+        for (std::size_t column = 0; column < number_of_states_; ++column)
+            result[row] += preceding_[row * number_of_states_ + column] * counter[column];
+    }
+    return result;
+}
+
+template <typename underlying, typename transitions_type>
+execution_state_counter<underlying> repeated_advance<underlying, transitions_type>::total_change(const execution_state_counter<underlying> &counter, const typename execution_state_counter<underlying>::allocator_type &allocator) const {
+    auto before_last = apply_preceding(counter, allocator);
+    before_last += advance(before_last, *transitions_, symbol_, allocator);
+    return before_last -= counter;
+}
+
+template <typename underlying, typename transitions_type>
+execution_state_counter<underlying> repeated_advance<underlying, transitions_type>::last_change(const execution_state_counter<underlying> &counter, const typename execution_state_counter<underlying>::allocator_type &allocator) const {
+    return advance(apply_preceding(counter, allocator), *transitions_, symbol_, allocator);
+}
+
 template <typename underlying>
 execution_state_counter<underlying> advance_sum(
     const execution_state_counter<underlying> &count_counter, 
     const execution_state_counter<underlying> &sum_counter,
     const edgelist &per_character_edges, 
-    const event &event) {
+    const event &event,
+    const typename execution_state_counter<underlying>::allocator_type &allocator) {
 
-    auto followup = execution_state_counter<underlying>{count_counter.size()};
+    auto followup = execution_state_counter<underlying>{count_counter.size(), allocator};
     const auto sum_for = [&](auto s) {
         for (const auto &e : per_character_edges.edges_for(s)) 
             followup[e.to] += sum_counter[e.from] + count_counter[e.from] * event.value;
@@ -106,9 +175,10 @@ execution_state_counter<underlying> advance_prod(
     const execution_state_counter<underlying> &count_counter,
     const execution_state_counter<underlying> &mult_counter,
     const edgelist &per_character_edges,
-    const event &event) {
+    const event &event,
+    const typename execution_state_counter<underlying>::allocator_type &allocator) {
 
-    auto followup = execution_state_counter<underlying>{count_counter.size()};
+    auto followup = execution_state_counter<underlying>{count_counter.size(), allocator};
     std::fill(followup.begin(), followup.end(), 1);
     const auto mult_for = [&](auto s) {
         for (const auto &e : per_character_edges.edges_for(s)) {
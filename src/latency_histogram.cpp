@@ -0,0 +1,82 @@
+#include "latency_histogram.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <stdexcept>
+
+namespace suse {
+latency_histogram::latency_histogram(unsigned precision_bits) : precision_bits_{precision_bits} {
+    if (precision_bits < 1 || precision_bits > 32)
+        throw std::invalid_argument("The precision of a latency histogram must be between 1 and 32 bits");
+}
+
+// Values below 2^precision_bits have a bucket each. Above, every power of two is split into 2^(precision_bits - 1)
+// buckets, indexed by the bits following the leading one.
+std::size_t latency_histogram::bucket_of(std::uint64_t value) const {
+    const auto exact_buckets = std::uint64_t{1} << precision_bits_;
+    if (value < exact_buckets)
+        return value;
+
+    const auto shift = static_cast<unsigned>(std::bit_width(value)) - precision_bits_;
+    const auto half = exact_buckets / 2;
+    return exact_buckets + (shift - 1) * half + ((value >> shift) - half);
+}
+
+std::uint64_t latency_histogram::highest_value_in(std::size_t bucket) const {
+    const auto exact_buckets = std::uint64_t{1} << precision_bits_;
+    if (bucket < exact_buckets)
+        return bucket;
+
+    const auto half = exact_buckets / 2;
+    const auto shift = (bucket - exact_buckets) / half + 1;
+    const auto leading_bits = half + (bucket - exact_buckets) % half;
+    if (shift + precision_bits_ >= 64 && leading_bits == exact_buckets - 1)
+        return UINT64_MAX;
+
+    return ((leading_bits + 1) << shift) - 1;
+}
+
+void latency_histogram::record(std::uint64_t value) {
+    const auto bucket = bucket_of(value);
+    if (bucket >= counts_.size())
+        counts_.resize(bucket + 1, 0);
+
+    ++counts_[bucket];
+    ++count_;
+    total_ += value;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+}
+
+std::uint64_t latency_histogram::value_at_percentile(double percentile) const {
+    if (count_ == 0)
+        return 0;
+
+    const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100 * count_)));
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < counts_.size(); ++bucket) {
+        seen += counts_[bucket];
+        if (seen >= rank)
+            return std::min(highest_value_in(bucket), max_);
+    }
+
+    return max_;
+}
+
+latency_histogram &latency_histogram::operator+=(const latency_histogram &other) {
+    if (other.precision_bits_ != precision_bits_)
+        throw std::invalid_argument("Cannot add latency histograms of different precision");
+
+    if (other.counts_.size() > counts_.size())
+        counts_.resize(other.counts_.size(), 0);
+    for (std::size_t bucket = 0; bucket < other.counts_.size(); ++bucket)
+        counts_[bucket] += other.counts_[bucket];
+
+    count_ += other.count_;
+    total_ += other.total_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    return *this;
+}
+} // namespace suse
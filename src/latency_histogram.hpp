@@ -0,0 +1,44 @@
+#ifndef SUSE_LATENCY_HISTOGRAM_HPP
+#define SUSE_LATENCY_HISTOGRAM_HPP
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace suse {
+// HDR-style histogram of non-negative values such as latencies in clock ticks. Values below
+// 2^precision_bits are counted exactly, larger ones in buckets whose width is at most 2^(1 - precision_bits)
+// of their values, so percentiles are that precise for any magnitude at constant cost per value. Buckets are
+// allocated up to the largest recorded value only.
+class latency_histogram {
+  public:
+    latency_histogram() : latency_histogram(8) {}
+    // Throws std::invalid_argument unless precision_bits is between 1 and 32
+    explicit latency_histogram(unsigned precision_bits);
+
+    void record(std::uint64_t value);
+
+    // Largest value that the bucket of the value at the given percentile, in [0, 100], counts. Zero if empty.
+    std::uint64_t value_at_percentile(double percentile) const;
+
+    std::uint64_t count() const { return count_; }
+    std::uint64_t total() const { return total_; }
+    std::uint64_t min() const { return count_ == 0 ? 0 : min_; }
+    std::uint64_t max() const { return max_; }
+
+    // Throws std::invalid_argument if other has a different precision
+    latency_histogram &operator+=(const latency_histogram &other);
+
+  private:
+    unsigned precision_bits_;
+    std::vector<std::uint64_t> counts_;
+    std::uint64_t count_ = 0, total_ = 0;
+    std::uint64_t min_ = UINT64_MAX, max_ = 0;
+
+    std::size_t bucket_of(std::uint64_t value) const;
+    std::uint64_t highest_value_in(std::size_t bucket) const;
+};
+} // namespace suse
+
+#endif
@@ -0,0 +1,89 @@
+#include "latency_histogram.hpp"
+
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <cstdint>
+
+TEST_SUITE("suse::latency_histogram") {
+    TEST_CASE("empty") {
+        const suse::latency_histogram histogram;
+        REQUIRE(histogram.count() == 0);
+        REQUIRE(histogram.min() == 0);
+        REQUIRE(histogram.max() == 0);
+        REQUIRE(histogram.value_at_percentile(50) == 0);
+    }
+
+    TEST_CASE("small values are exact") {
+        suse::latency_histogram histogram{4};
+        for (std::uint64_t value = 1; value <= 10; ++value)
+            histogram.record(value);
+
+        REQUIRE(histogram.count() == 10);
+        REQUIRE(histogram.total() == 55);
+        REQUIRE(histogram.min() == 1);
+        REQUIRE(histogram.max() == 10);
+        REQUIRE(histogram.value_at_percentile(0) == 1);
+        REQUIRE(histogram.value_at_percentile(50) == 5);
+        REQUIRE(histogram.value_at_percentile(90) == 9);
+        REQUIRE(histogram.value_at_percentile(100) == 10);
+    }
+
+    TEST_CASE("percentiles are within the precision") {
+        std::mt19937_64 generator{42};
+        std::lognormal_distribution<double> distribution{10, 2};
+        std::vector<std::uint64_t> values(10000);
+        std::generate(values.begin(), values.end(), [&] { return static_cast<std::uint64_t>(distribution(generator)); });
+
+        for (unsigned precision_bits : {1, 4, 8}) {
+            CAPTURE(precision_bits);
+            suse::latency_histogram histogram{precision_bits};
+            for (auto value : values)
+                histogram.record(value);
+
+            auto sorted = values;
+            std::sort(sorted.begin(), sorted.end());
+            for (double percentile : {1.0, 50.0, 90.0, 99.0, 99.9, 100.0}) {
+                CAPTURE(percentile);
+                const auto exact = sorted[static_cast<std::size_t>(std::max(1.0, std::ceil(percentile / 100 * sorted.size()))) - 1];
+                const auto approximate = histogram.value_at_percentile(percentile);
+
+                REQUIRE(approximate >= exact);
+                REQUIRE(approximate - exact <= (exact >> (precision_bits - 1)));
+            }
+        }
+    }
+
+    TEST_CASE("extreme values") {
+        suse::latency_histogram histogram;
+        histogram.record(UINT64_MAX);
+        histogram.record(0);
+
+        REQUIRE(histogram.value_at_percentile(50) == 0);
+        REQUIRE(histogram.value_at_percentile(100) == UINT64_MAX);
+    }
+
+    TEST_CASE("adding histograms") {
+        suse::latency_histogram lhs, rhs, both;
+        for (std::uint64_t value = 0; value < 5000; value += 7) {
+            (value % 2 == 0 ? lhs : rhs).record(value * value);
+            both.record(value * value);
+        }
+
+        lhs += rhs;
+        REQUIRE(lhs.count() == both.count());
+        REQUIRE(lhs.total() == both.total());
+        REQUIRE(lhs.min() == both.min());
+        REQUIRE(lhs.max() == both.max());
+        for (double percentile : {10.0, 50.0, 99.0})
+            REQUIRE(lhs.value_at_percentile(percentile) == both.value_at_percentile(percentile));
+
+        CHECK_THROWS_AS(lhs += suse::latency_histogram{4}, std::invalid_argument);
+        CHECK_THROWS_AS((suse::latency_histogram{0}), std::invalid_argument);
+    }
+}
@@ -0,0 +1,102 @@
+#include "lazy_dfa.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+
+namespace suse {
+std::size_t lazy_dfa::state_set_hash::operator()(const std::vector<bit_parallel_nfa::word_type> &states) const {
+    std::size_t hash = states.size();
+    for (auto word : states)
+        hash ^= std::hash<bit_parallel_nfa::word_type>{}(word) + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+
+    return hash;
+}
+
+lazy_dfa::lazy_dfa(const nfa &automaton, std::size_t max_cached_states) : simulation_{automaton},
+                                                                          max_cached_states_{std::max<std::size_t>(max_cached_states, 3)},
+                                                                          number_of_symbol_classes_{simulation_.number_of_symbol_classes()} {
+    reset_cache();
+}
+
+bool lazy_dfa::check(std::string_view word) {
+    if (fell_back_to_nfa_)
+        return simulation_.check(word);
+
+    symbols_since_flush_ += word.size();
+
+    auto current = initial_state_;
+    for (auto c : word) {
+        const auto symbol_class = simulation_.symbol_class(c);
+
+        auto next = transitions_[current * number_of_symbol_classes_ + symbol_class];
+        if (next == unknown_state) {
+            next = compute_transition(current, symbol_class);
+
+            // flushing the cache invalidates all ids, so the rest of this word is easier done on the nfa
+            if (fell_back_to_nfa_)
+                return simulation_.check(word);
+        }
+
+        if (next == dead_state)
+            return false;
+        current = next;
+    }
+
+    return accepting_[current];
+}
+
+void lazy_dfa::reset_cache() {
+    transitions_.clear();
+    accepting_.clear();
+    state_sets_.clear();
+    ids_.clear();
+    symbols_since_flush_ = 0;
+
+    find_or_add(std::vector<bit_parallel_nfa::word_type>(simulation_.words_per_set(), 0));
+    const auto initial = simulation_.initial_states();
+    initial_state_ = find_or_add({initial.begin(), initial.end()});
+}
+
+auto lazy_dfa::find_or_add(const std::vector<bit_parallel_nfa::word_type> &states) -> state_id {
+    if (auto it = ids_.find(states); it != ids_.end())
+        return it->second;
+
+    const auto id = static_cast<state_id>(accepting_.size());
+    ids_.emplace(states, id);
+    accepting_.push_back(simulation_.contains_final(states));
+    state_sets_.insert(state_sets_.end(), states.begin(), states.end());
+    transitions_.resize(transitions_.size() + number_of_symbol_classes_, unknown_state);
+
+    return id;
+}
+
+auto lazy_dfa::compute_transition(state_id from, std::size_t symbol_class) -> state_id {
+    const auto words_per_set = simulation_.words_per_set();
+
+    std::vector<bit_parallel_nfa::word_type> next(words_per_set);
+    simulation_.step(std::span{state_sets_.begin() + from * words_per_set, words_per_set}, symbol_class, next);
+
+    if (ids_.find(next) == ids_.end() && accepting_.size() >= max_cached_states_) {
+        const auto thrashing = symbols_since_flush_ < min_symbols_per_state * max_cached_states_;
+        thrashing_flushes_ = thrashing ? thrashing_flushes_ + 1 : 0;
+        ++number_of_cache_flushes_;
+
+        if (thrashing_flushes_ >= max_thrashing_flushes) {
+            fell_back_to_nfa_ = true;
+            ids_.clear();
+            transitions_ = {};
+            accepting_ = {};
+            state_sets_ = {};
+            return dead_state;
+        }
+
+        reset_cache();
+        return find_or_add(next);
+    }
+
+    const auto to = find_or_add(next);
+    transitions_[from * number_of_symbol_classes_ + symbol_class] = to;
+    return to;
+}
+} // namespace suse
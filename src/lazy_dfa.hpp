@@ -0,0 +1,65 @@
+#ifndef SUSE_LAZY_DFA_HPP
+#define SUSE_LAZY_DFA_HPP
+
+#include "bit_parallel_nfa.hpp"
+#include "nfa.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <cstddef>
+
+namespace suse {
+// Subset construction on demand: every set of nfa states reached while checking words becomes a dfa state
+// and every transition is computed once, so stepping is a single table lookup per symbol afterwards.
+// At most max_cached_states dfa states are kept. Once the cache is full, it is flushed and rebuilt from
+// scratch. If that happens too often without amortizing the construction, the dfa gives up and all further
+// words are checked by simulating the nfa directly.
+class lazy_dfa {
+  public:
+    static constexpr std::size_t default_max_cached_states = 4096;
+
+    explicit lazy_dfa(const nfa &automaton, std::size_t max_cached_states = default_max_cached_states);
+
+    bool check(std::string_view word);
+
+    std::size_t number_of_cached_states() const { return accepting_.size(); }
+    std::size_t number_of_cache_flushes() const { return number_of_cache_flushes_; }
+    bool fell_back_to_nfa() const { return fell_back_to_nfa_; }
+
+  private:
+    using state_id = std::uint32_t;
+    static constexpr state_id unknown_state = std::numeric_limits<state_id>::max();
+    static constexpr state_id dead_state = 0;
+
+    // a flush counts as thrashing if fewer symbols than this were processed per dfa state built since the last flush
+    static constexpr std::size_t min_symbols_per_state = 10;
+    static constexpr std::size_t max_thrashing_flushes = 3;
+
+    struct state_set_hash {
+        std::size_t operator()(const std::vector<bit_parallel_nfa::word_type> &states) const;
+    };
+
+    bit_parallel_nfa simulation_;
+    std::size_t max_cached_states_, number_of_symbol_classes_;
+
+    std::vector<state_id> transitions_; // [dfa state][symbol class]
+    std::vector<bool> accepting_;
+    std::vector<bit_parallel_nfa::word_type> state_sets_; // [dfa state][word]
+    std::unordered_map<std::vector<bit_parallel_nfa::word_type>, state_id, state_set_hash> ids_;
+    state_id initial_state_;
+
+    std::size_t symbols_since_flush_ = 0;
+    std::size_t number_of_cache_flushes_ = 0, thrashing_flushes_ = 0;
+    bool fell_back_to_nfa_ = false;
+
+    void reset_cache();
+    state_id find_or_add(const std::vector<bit_parallel_nfa::word_type> &states);
+    state_id compute_transition(state_id from, std::size_t symbol_class);
+};
+} // namespace suse
+
+#endif
@@ -0,0 +1,47 @@
+#include "lazy_dfa.hpp"
+#include "regex.hpp"
+
+#include <doctest/doctest.h>
+
+#include <random>
+#include <string>
+
+TEST_SUITE("suse::lazy_dfa") {
+    TEST_CASE("matches nfa") {
+        const auto sample = suse::parse_regex("a(b|c)+.?d*e");
+        suse::lazy_dfa dfa{sample};
+
+        for (std::string_view input : {"", "a", "abe", "ace", "abcbcxe", "abcbcdde", "abxdd", "abcbcdex", "xabe", "abbbbbbbe", "abe"}) {
+            CAPTURE(input);
+            REQUIRE(dfa.check(input) == sample.check(input));
+        }
+
+        CHECK(dfa.number_of_cache_flushes() == 0);
+        CHECK(!dfa.fell_back_to_nfa());
+    }
+
+    TEST_CASE("bounded cache") {
+        // the dfa for this query needs 2^n states to remember which of the last n symbols were an a
+        const auto sample = suse::parse_regex(".*a.........");
+
+        std::mt19937 gen{42};
+        std::uniform_int_distribution<int> dist(0, 1);
+        const auto random_word = [&]() {
+            std::string word;
+            for (std::size_t i = 0; i < 200; ++i)
+                word += dist(gen) == 0 ? 'a' : 'b';
+            return word;
+        };
+
+        suse::lazy_dfa dfa{sample, 64};
+        for (std::size_t i = 0; i < 100; ++i) {
+            const auto word = random_word();
+            CAPTURE(word);
+            REQUIRE(dfa.check(word) == sample.check(word));
+            REQUIRE(dfa.number_of_cached_states() <= 64);
+        }
+
+        CHECK(dfa.number_of_cache_flushes() > 0);
+        CHECK(dfa.fell_back_to_nfa());
+    }
+}
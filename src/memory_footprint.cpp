@@ -0,0 +1,24 @@
+#include "memory_footprint.hpp"
+
+#if __has_include(<sys/resource.h>)
+#include <sys/resource.h>
+#define SUSE_HAS_RUSAGE 1
+#endif
+
+namespace suse {
+std::optional<std::size_t> peak_resident_bytes() {
+#ifdef SUSE_HAS_RUSAGE
+    rusage usage{};
+    if (::getrusage(RUSAGE_SELF, &usage) != 0)
+        return std::nullopt;
+
+#ifdef __APPLE__
+    return static_cast<std::size_t>(usage.ru_maxrss); // in bytes
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024; // in kilobytes
+#endif
+#else
+    return std::nullopt;
+#endif
+}
+} // namespace suse
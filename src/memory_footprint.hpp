@@ -0,0 +1,44 @@
+#ifndef SUSE_MEMORY_FOOTPRINT_HPP
+#define SUSE_MEMORY_FOOTPRINT_HPP
+
+#include <optional>
+#include <vector>
+
+#include <cstddef>
+
+namespace suse {
+// Heap memory held by a data structure: its live allocations and the bytes requested for them. Computed by
+// walking the structure, so it costs nothing while processing events.
+struct memory_footprint {
+    std::size_t allocations = 0, bytes = 0;
+
+    memory_footprint &operator+=(const memory_footprint &other) {
+        allocations += other.allocations;
+        bytes += other.bytes;
+        return *this;
+    }
+
+    friend memory_footprint operator+(memory_footprint lhs, const memory_footprint &rhs) {
+        return lhs += rhs;
+    }
+
+    friend bool operator==(const memory_footprint &, const memory_footprint &) = default;
+};
+
+// Includes the footprints of the elements, for element types that have one
+template <typename T, typename allocator_type>
+memory_footprint footprint_of(const std::vector<T, allocator_type> &values) {
+    memory_footprint footprint{values.capacity() > 0 ? 1u : 0u, values.capacity() * sizeof(T)};
+    if constexpr (requires(const T &value) { footprint_of(value); }) {
+        for (const auto &value : values)
+            footprint += footprint_of(value);
+    }
+
+    return footprint;
+}
+
+// Largest resident set size of this process so far, if the platform reports it
+std::optional<std::size_t> peak_resident_bytes();
+} // namespace suse
+
+#endif
@@ -0,0 +1,173 @@
+#include "metrics_server.hpp"
+
+#include <fmt/format.h>
+
+#include <charconv>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+
+#if __has_include(<sys/socket.h>) && __has_include(<sys/un.h>)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define SUSE_HAS_SOCKETS 1
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // e.g. macOS, where the default SIGPIPE handling applies
+#endif
+#endif
+
+namespace suse {
+namespace {
+template <typename value_type>
+void append_metric(std::string &out, std::string_view name, std::string_view type, std::string_view help, value_type value) {
+    fmt::format_to(std::back_inserter(out), "# HELP {0} {1}\n# TYPE {0} {2}\n{0} {3}\n", name, help, type, value);
+}
+} // namespace
+
+std::string format_prometheus(const live_metrics &metrics) {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    const auto uptime = std::chrono::duration<double>{std::chrono::steady_clock::now() - metrics.start_time}.count();
+    const auto processed_events = metrics.processed_events.load(relaxed);
+
+    std::string out;
+    append_metric(out, "suse_processed_events_total", "counter", "Events processed so far", processed_events);
+    append_metric(out, "suse_events_per_second", "gauge", "Average throughput since the start", uptime > 0 ? processed_events / uptime : 0.0);
+
+    fmt::format_to(std::back_inserter(out), "# HELP suse_event_latency_nanoseconds Latency of processing one event\n# TYPE suse_event_latency_nanoseconds summary\n");
+    for (std::size_t idx = 0; idx < live_metrics::latency_quantiles.size(); ++idx)
+        fmt::format_to(std::back_inserter(out), "suse_event_latency_nanoseconds{{quantile=\"{}\"}} {}\n", live_metrics::latency_quantiles[idx], metrics.latency_quantiles_ns[idx].load(relaxed));
+
+    append_metric(out, "suse_cached_events", "gauge", "Events in the summary", metrics.cached_events.load(relaxed));
+    append_metric(out, "suse_window_entries", "gauge", "Cache entries in the active time window", metrics.window_entries.load(relaxed));
+    append_metric(out, "suse_contained_matches", "gauge", "Complete matches among the cached events", metrics.contained_matches.load(relaxed));
+    append_metric(out, "suse_detected_matches_total", "counter", "Complete matches detected so far", metrics.detected_matches.load(relaxed));
+
+    if (metrics.operation_counts) {
+        fmt::format_to(std::back_inserter(out), "# HELP suse_replays_total Replays of cached events by kind\n# TYPE suse_replays_total counter\n");
+        fmt::format_to(std::back_inserter(out), "suse_replays_total{{kind=\"window\"}} {}\n", metrics.window_replays.load(relaxed));
+        fmt::format_to(std::back_inserter(out), "suse_replays_total{{kind=\"affected_range\"}} {}\n", metrics.affected_range_replays.load(relaxed));
+        fmt::format_to(std::back_inserter(out), "suse_replays_total{{kind=\"purge\"}} {}\n", metrics.purge_replays.load(relaxed));
+        append_metric(out, "suse_replayed_entries_total", "counter", "Cache entries replayed by any replay", metrics.replayed_entries.load(relaxed));
+        append_metric(out, "suse_evictions_total", "counter", "Events evicted from the summary", metrics.evictions.load(relaxed));
+        append_metric(out, "suse_expiries_total", "counter", "Events purged after their time to live", metrics.expiries.load(relaxed));
+    }
+
+    return out;
+}
+
+#ifdef SUSE_HAS_SOCKETS
+metrics_server::metrics_server(const std::string &address, const live_metrics &metrics) : metrics_{metrics} {
+    constexpr std::string_view unix_prefix = "unix:";
+
+    if (address.starts_with(unix_prefix)) {
+        sockaddr_un socket_address{};
+        socket_path_ = address.substr(unix_prefix.size());
+        if (socket_path_.empty() || socket_path_.size() >= sizeof(socket_address.sun_path))
+            throw metrics_server_error(fmt::format("Invalid metrics socket path {}", socket_path_));
+
+        socket_address.sun_family = AF_UNIX;
+        std::memcpy(socket_address.sun_path, socket_path_.c_str(), socket_path_.size() + 1);
+
+        listen_fd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd_ < 0)
+            throw metrics_server_error(fmt::format("Cannot listen on metrics socket {}", socket_path_));
+
+        // replaces a socket left behind by an earlier run, but nothing else
+        struct stat existing {};
+        if (::lstat(socket_path_.c_str(), &existing) == 0) {
+            if (!S_ISSOCK(existing.st_mode)) {
+                ::close(listen_fd_);
+                throw metrics_server_error(fmt::format("Cannot listen on metrics socket {}, which exists and is not a socket", socket_path_));
+            }
+            ::unlink(socket_path_.c_str());
+        }
+
+        if (::bind(listen_fd_, reinterpret_cast<const sockaddr *>(&socket_address), sizeof(socket_address)) != 0) {
+            ::close(listen_fd_);
+            throw metrics_server_error(fmt::format("Cannot listen on metrics socket {}", socket_path_));
+        }
+    } else {
+        std::uint16_t port = 0;
+        const auto [end, error] = std::from_chars(address.data(), address.data() + address.size(), port);
+        if (error != std::errc{} || end != address.data() + address.size())
+            throw metrics_server_error(fmt::format("Invalid metrics address {}, expected a port or unix:path", address));
+
+        sockaddr_in socket_address{};
+        socket_address.sin_family = AF_INET;
+        socket_address.sin_port = htons(port);
+        socket_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        const int reuse = 1;
+        if (listen_fd_ >= 0)
+            ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (listen_fd_ < 0 || ::bind(listen_fd_, reinterpret_cast<const sockaddr *>(&socket_address), sizeof(socket_address)) != 0) {
+            if (listen_fd_ >= 0)
+                ::close(listen_fd_);
+            throw metrics_server_error(fmt::format("Cannot listen on metrics port {}", port));
+        }
+    }
+
+    if (::listen(listen_fd_, 16) != 0) {
+        ::close(listen_fd_);
+        throw metrics_server_error(fmt::format("Cannot listen on metrics address {}", address));
+    }
+
+    thread_ = std::thread{[this] { serve(); }};
+}
+
+metrics_server::~metrics_server() {
+    stopping_ = true;
+    thread_.join();
+    ::close(listen_fd_);
+    if (!socket_path_.empty())
+        ::unlink(socket_path_.c_str());
+}
+
+// Polls with a timeout so that stopping is noticed. Requests are answered one at a time, as scrapes are rare.
+void metrics_server::serve() {
+    constexpr int poll_timeout_ms = 100;
+
+    while (!stopping_) {
+        pollfd listening{listen_fd_, POLLIN, 0};
+        if (::poll(&listening, 1, poll_timeout_ms) <= 0)
+            continue;
+
+        const int connection = ::accept(listen_fd_, nullptr, nullptr);
+        if (connection < 0)
+            continue;
+
+        // the request does not matter, but is read so that clients do not see a reset connection
+        pollfd request{connection, POLLIN, 0};
+        if (::poll(&request, 1, poll_timeout_ms * 10) > 0) {
+            char buffer[4096];
+            [[maybe_unused]] const auto ignored = ::recv(connection, buffer, sizeof(buffer), 0);
+        }
+
+        const auto body = format_prometheus(metrics_);
+        const auto response = fmt::format("HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: {}\r\nConnection: close\r\n\r\n{}", body.size(), body);
+        for (std::size_t sent = 0; sent < response.size();) {
+            const auto written = ::send(connection, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (written <= 0)
+                break;
+            sent += static_cast<std::size_t>(written);
+        }
+
+        ::close(connection);
+    }
+}
+#else
+metrics_server::metrics_server(const std::string &address, const live_metrics &metrics) : metrics_{metrics} {
+    throw metrics_server_error("Serving metrics needs POSIX sockets, which are not available on this platform");
+}
+
+metrics_server::~metrics_server() = default;
+
+void metrics_server::serve() {}
+#endif
+} // namespace suse
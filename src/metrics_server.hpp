@@ -0,0 +1,62 @@
+#ifndef SUSE_METRICS_SERVER_HPP
+#define SUSE_METRICS_SERVER_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <cstdint>
+
+namespace suse {
+struct metrics_server_error : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// Written by the thread processing events and read by a metrics_server. All values are atomics that are
+// stored and loaded with relaxed ordering, so neither side takes a lock. Single values are consistent, but
+// a scrape may see some values of the next update already.
+struct live_metrics {
+    static constexpr std::array<double, 4> latency_quantiles{0.5, 0.9, 0.99, 0.999};
+
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+    std::atomic<std::uint64_t> processed_events{0};
+    std::array<std::atomic<std::uint64_t>, latency_quantiles.size()> latency_quantiles_ns{};
+    std::atomic<std::uint64_t> cached_events{0}, window_entries{0};
+    std::atomic<double> contained_matches{0}, detected_matches{0};
+
+    // Only published if operation_counts is set before serving
+    bool operation_counts = false;
+    std::atomic<std::uint64_t> window_replays{0}, affected_range_replays{0}, purge_replays{0}, replayed_entries{0};
+    std::atomic<std::uint64_t> evictions{0}, expiries{0};
+};
+
+// Prometheus text exposition format
+std::string format_prometheus(const live_metrics &metrics);
+
+// Serves the metrics to every HTTP request on a background thread, listening on 127.0.0.1 if address is a
+// port or on a Unix domain socket if it is unix:path. The socket file is removed again on destruction.
+class metrics_server {
+  public:
+    // Throws metrics_server_error if the address is malformed or cannot be listened on
+    metrics_server(const std::string &address, const live_metrics &metrics);
+    ~metrics_server();
+
+    metrics_server(const metrics_server &) = delete;
+    metrics_server &operator=(const metrics_server &) = delete;
+
+  private:
+    const live_metrics &metrics_;
+    int listen_fd_ = -1;
+    std::string socket_path_;
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+
+    void serve();
+};
+} // namespace suse
+
+#endif
@@ -0,0 +1,95 @@
+#include "metrics_server.hpp"
+
+#include <doctest/doctest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#if __has_include(<sys/socket.h>) && __has_include(<sys/un.h>)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace {
+std::string scrape(const std::string &socket_path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    REQUIRE(fd >= 0);
+    REQUIRE(::connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0);
+
+    const std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+    REQUIRE(::send(fd, request.data(), request.size(), 0) == static_cast<ssize_t>(request.size()));
+
+    std::string response;
+    char buffer[4096];
+    for (ssize_t received; (received = ::recv(fd, buffer, sizeof(buffer), 0)) > 0;)
+        response.append(buffer, static_cast<std::size_t>(received));
+    ::close(fd);
+
+    return response;
+}
+} // namespace
+#endif
+
+TEST_SUITE("suse::metrics_server") {
+    TEST_CASE("prometheus format") {
+        suse::live_metrics metrics;
+        metrics.processed_events = 42;
+        metrics.latency_quantiles_ns[2] = 1500;
+        metrics.cached_events = 7;
+
+        auto text = suse::format_prometheus(metrics);
+        CHECK(text.find("# TYPE suse_processed_events_total counter\nsuse_processed_events_total 42\n") != std::string::npos);
+        CHECK(text.find("suse_event_latency_nanoseconds{quantile=\"0.99\"} 1500\n") != std::string::npos);
+        CHECK(text.find("suse_cached_events 7\n") != std::string::npos);
+        CHECK(text.find("suse_replays_total") == std::string::npos);
+
+        metrics.operation_counts = true;
+        metrics.purge_replays = 3;
+        text = suse::format_prometheus(metrics);
+        CHECK(text.find("suse_replays_total{kind=\"purge\"} 3\n") != std::string::npos);
+    }
+
+    TEST_CASE("invalid addresses") {
+        const suse::live_metrics metrics;
+        CHECK_THROWS_AS(suse::metrics_server("localhost", metrics), suse::metrics_server_error);
+        CHECK_THROWS_AS(suse::metrics_server("unix:", metrics), suse::metrics_server_error);
+    }
+
+#if __has_include(<sys/socket.h>) && __has_include(<sys/un.h>)
+    TEST_CASE("serves over a unix domain socket") {
+        suse::live_metrics metrics;
+        const auto socket_path = (std::filesystem::temp_directory_path() / ("suse_metrics_test_" + std::to_string(::getpid()))).string();
+
+        {
+            const suse::metrics_server server{"unix:" + socket_path, metrics};
+            metrics.processed_events = 5;
+            auto response = scrape(socket_path);
+            CHECK(response.starts_with("HTTP/1.0 200 OK\r\n"));
+            CHECK(response.find("suse_processed_events_total 5\n") != std::string::npos);
+
+            metrics.processed_events = 6;
+            response = scrape(socket_path);
+            CHECK(response.find("suse_processed_events_total 6\n") != std::string::npos);
+        }
+
+        CHECK(!std::filesystem::exists(socket_path));
+    }
+
+    TEST_CASE("keeps existing files that are not sockets") {
+        const suse::live_metrics metrics;
+        const auto path = std::filesystem::temp_directory_path() / ("suse_metrics_file_" + std::to_string(::getpid()));
+        std::ofstream{path} << "keep";
+
+        CHECK_THROWS_AS(suse::metrics_server("unix:" + path.string(), metrics), suse::metrics_server_error);
+        CHECK(std::filesystem::is_regular_file(path));
+        std::filesystem::remove(path);
+    }
+#endif
+}
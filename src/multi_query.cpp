@@ -0,0 +1,133 @@
+#include "multi_query_engine.hpp"
+#include "probabilities.hpp"
+#include "regex.hpp"
+
+#include <boost/multiprecision/cpp_bin_float.hpp>
+#include <boost/multiprecision/cpp_int.hpp>
+
+#include <cxxopts.hpp>
+
+#include <fmt/chrono.h>
+#include <fmt/color.h>
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using nanoseconds = std::chrono::nanoseconds;
+using counter_type = boost::multiprecision::uint128_t;
+using factor_type = boost::multiprecision::cpp_bin_float_50;
+using engine_type = suse::multi_query_engine<counter_type, factor_type>;
+
+template <>
+struct fmt::formatter<counter_type> : fmt::ostream_formatter {}; // enables fmt::print to print values of boost::multiprecision::uint128_t
+
+namespace {
+void generate_report(const std::filesystem::path &path, const engine_type &engine, nanoseconds init_time, nanoseconds runtime, std::size_t processed_events) {
+    std::ofstream out{path};
+    fmt::print(out, "{{\n");
+    fmt::print(out, "\t\"initialization_time_ns\": {},\n", init_time.count());
+    fmt::print(out, "\t\"runtime_ns\": {},\n", runtime.count());
+    fmt::print(out, "\t\"processed_events\": {},\n", processed_events);
+    fmt::print(out, "\t\"compiled_queries\": {},\n", engine.number_of_compiled_queries());
+    fmt::print(out, "\t\"queries\": [\n");
+
+    for (std::size_t idx = 0; idx < engine.number_of_queries(); ++idx) {
+        const auto &definition = engine.definition(idx);
+        const auto &selector = engine.selector(idx);
+        const auto &statistics = engine.statistics(idx);
+
+        fmt::print(out, "\t\t{{\n");
+        fmt::print(out, "\t\t\t\"name\": \"{}\",\n", definition.name);
+        fmt::print(out, "\t\t\t\"processing_time_ns\": {},\n", statistics.processing_time.count());
+        fmt::print(out, "\t\t\t\"processed_events\": {},\n", statistics.processed_events);
+        fmt::print(out, "\t\t\t\"final_matches\": {},\n", selector.number_of_contained_complete_matches());
+        fmt::print(out, "\t\t\t\"final_partial_matches\": {},\n", selector.number_of_contained_partial_matches());
+        fmt::print(out, "\t\t\t\"detected_matches\": {},\n", selector.number_of_detected_complete_matches());
+        fmt::print(out, "\t\t\t\"detected_partial_matches\": {}\n", selector.number_of_detected_partial_matches());
+        fmt::print(out, "\t\t}}{}\n", idx + 1 < engine.number_of_queries() ? "," : "");
+    }
+
+    fmt::print(out, "\t]\n");
+    fmt::print(out, "}}\n");
+}
+} // namespace
+
+int main(int argc, char *argv[]) try {
+    cxxopts::Options options("multi_query", "Evaluates many queries over one pass of an event stream");
+    options.add_options()("queries,q", "File with one query per line: <name> <summary size> <time window size> <regex>", cxxopts::value<std::string>())("strategy", "Eviction strategy. Must be one of suse, fifo or random. Default is suse", cxxopts::value<std::string>()->default_value("suse"))("probabilities-file", "For SuSe eviction strategy: file containing the probabilities for each character", cxxopts::value<std::string>())("time-to-live", "The maximum amount of time an event stays in the cache", cxxopts::value<std::size_t>()->default_value(std::to_string(std::numeric_limits<std::size_t>::max())))("report,r", "File to write results to", cxxopts::value<std::string>())("help,h", "Display this help meassage");
+
+    options.parse_positional("queries");
+    options.positional_help("queries");
+
+    const auto parsed_args = options.parse(argc, argv);
+
+    if (parsed_args.count("help") > 0 || argc < 2) {
+        fmt::print("{}", options.help());
+        return 0;
+    }
+
+    if (parsed_args.count("queries") == 0) {
+        fmt::print(stderr, "queries is a required argument\n");
+        return 1;
+    }
+
+    const auto strategy = suse::parse_query_strategy(parsed_args["strategy"].template as<std::string>());
+    if (!strategy) {
+        fmt::print(stderr, "{}", fmt::styled("Invalid strategy, aborting...\n", fmt::fg(fmt::color::red)));
+        return 1;
+    }
+
+    std::ifstream query_file{parsed_args["queries"].template as<std::string>()};
+    if (!query_file) {
+        fmt::print(stderr, "{}", fmt::styled("Cannot open query file, aborting...\n", fmt::fg(fmt::color::red)));
+        return 1;
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    const auto probabilities = parsed_args.count("probabilities-file") > 0 ? suse::load_probabilities<factor_type>(parsed_args["probabilities-file"].template as<std::string>()) : std::unordered_map<char, factor_type>{};
+    engine_type engine{*strategy, probabilities};
+
+    const auto time_to_live = parsed_args["time-to-live"].template as<std::size_t>();
+    for (auto definition : suse::read_query_definitions(query_file)) {
+        definition.time_to_live = time_to_live;
+        try {
+            engine.add_query(definition);
+        } catch (const suse::regex_parse_error &error) {
+            fmt::print(stderr, "{}", fmt::styled(fmt::format("Invalid query {} at position {}: {}, aborting...\n", definition.name, error.location, error.what()), fmt::fg(fmt::color::red)));
+            return 1;
+        }
+    }
+    fmt::print("{} queries, {} compiled\n", engine.number_of_queries(), engine.number_of_compiled_queries());
+
+    std::ios::sync_with_stdio(false);
+
+    const auto processing_start_time = std::chrono::steady_clock::now();
+    std::size_t processed_events = 0;
+    for (suse::event next_event; std::cin >> next_event; ++processed_events)
+        engine.process_event(next_event);
+    const auto processing_end_time = std::chrono::steady_clock::now();
+
+    for (std::size_t idx = 0; idx < engine.number_of_queries(); ++idx) {
+        const auto &selector = engine.selector(idx);
+        fmt::print("{}: Partial Matches: {}, Complete Matches: {}, processing time: {}\n", engine.definition(idx).name, selector.number_of_contained_partial_matches(), selector.number_of_contained_complete_matches(), std::chrono::duration_cast<std::chrono::milliseconds>(engine.statistics(idx).processing_time));
+    }
+
+    if (parsed_args.count("report") > 0)
+        generate_report(parsed_args["report"].template as<std::string>(), engine, processing_start_time - start_time, processing_end_time - processing_start_time, processed_events);
+
+    return 0;
+} catch (const cxxopts::exceptions::exception &e) {
+    fmt::print(stderr, "Error parsing arguments: {}\n", e.what());
+    return 1;
+} catch (const std::invalid_argument &e) {
+    fmt::print(stderr, "Error reading queries: {}\n", e.what());
+    return 1;
+}
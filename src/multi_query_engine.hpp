@@ -0,0 +1,87 @@
+#ifndef SUSE_MULTI_QUERY_ENGINE_HPP
+#define SUSE_MULTI_QUERY_ENGINE_HPP
+
+#include "compiled_query.hpp"
+#include "edgelist.hpp"
+#include "event.hpp"
+#include "eviction_strategies.hpp"
+#include "nfa.hpp"
+#include "summary_selector_count.hpp"
+
+#include <array>
+#include <chrono>
+#include <istream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <cstddef>
+
+namespace suse {
+struct query_definition {
+    std::string name, regex;
+    std::size_t summary_size, time_window_size;
+    std::size_t time_to_live = std::numeric_limits<std::size_t>::max();
+};
+
+// Reads one query per line as "<name> <summary size> <time window size> <regex>". Empty lines and lines
+// starting with '#' are skipped. Throws std::invalid_argument on malformed lines.
+std::vector<query_definition> read_query_definitions(std::istream &in);
+
+// Evaluates many queries over a single pass of the stream. Every event is only handed to the selectors of
+// queries whose automaton can read it, so each query behaves as if its stream was filtered to its alphabet.
+// Queries with the same regex, and for the suse strategy the same time window, share one compiled_query.
+template <typename counter_type, typename factor_type>
+class multi_query_engine {
+  public:
+    using selector_type = summary_selector_count<counter_type>;
+    using strategy_type = eviction_strategies::suse<counter_type, factor_type>;
+
+    struct query_statistics {
+        std::chrono::nanoseconds processing_time{0};
+        std::size_t processed_events = 0;
+    };
+
+    // For the suse strategy, uniform probabilities over each query's alphabet are used if none are given
+    explicit multi_query_engine(query_strategy strategy, std::unordered_map<char, factor_type> probabilities = {});
+
+    // Throws regex_parse_error for invalid queries
+    std::size_t add_query(query_definition definition);
+
+    void process_event(const event &new_event);
+
+    std::size_t number_of_queries() const { return queries_.size(); }
+    std::size_t number_of_compiled_queries() const { return compiled_.size(); }
+
+    const query_definition &definition(std::size_t query_idx) const { return queries_[query_idx]->definition; }
+    const selector_type &selector(std::size_t query_idx) const { return *queries_[query_idx]->selector; }
+    const query_statistics &statistics(std::size_t query_idx) const { return queries_[query_idx]->statistics; }
+
+  private:
+    struct query {
+        query_definition definition;
+        std::unique_ptr<selector_type> selector;
+        std::optional<strategy_type> strategy;
+        query_statistics statistics;
+    };
+
+    query_strategy strategy_;
+    std::unordered_map<char, factor_type> probabilities_;
+
+    std::map<std::pair<std::string, std::size_t>, std::shared_ptr<const compiled_query<>>> compiled_; // by regex and time window of the tables
+    std::vector<std::unique_ptr<query>> queries_;
+    std::array<std::vector<std::size_t>, 256> queries_by_symbol_;
+
+    std::shared_ptr<const compiled_query<>> compile(const std::string &regex, std::size_t time_window_size);
+};
+} // namespace suse
+
+#include "multi_query_engine_impl.hpp"
+
+#endif
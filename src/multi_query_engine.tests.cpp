@@ -0,0 +1,66 @@
+#include "multi_query_engine.hpp"
+
+#include <doctest/doctest.h>
+
+#include <sstream>
+#include <string>
+
+TEST_SUITE("suse::multi_query_engine") {
+    TEST_CASE("read query definitions") {
+        std::istringstream in{"# name size window regex\nfirst 10 5 a(b|c)*d\n\nsecond 20 7 .b\n"};
+        const auto definitions = suse::read_query_definitions(in);
+
+        REQUIRE(definitions.size() == 2);
+        CHECK(definitions[0].name == "first");
+        CHECK(definitions[0].summary_size == 10);
+        CHECK(definitions[0].time_window_size == 5);
+        CHECK(definitions[0].regex == "a(b|c)*d");
+        CHECK(definitions[1].regex == ".b");
+
+        std::istringstream malformed{"first 10 a(b|c)*d\n"};
+        CHECK_THROWS_AS(suse::read_query_definitions(malformed), std::invalid_argument);
+    }
+
+    TEST_CASE("matches single query runs on filtered streams") {
+        const std::string_view input = "aabcdacbadcbacdbcacbdaedabaaebdedaaddccdeaceabdebdeadaaabeadabdadbcadcdabeadeadcbedeaabbcbcbcacbccbabcdeacbdeabdadxyzxyzaaab";
+
+        suse::multi_query_engine<long, double> engine{suse::query_strategy::suse};
+        const auto bcd = engine.add_query({"bcd", "b(c|d)+", 15, 10});
+        const auto bcd_again = engine.add_query({"bcd_again", "b(c|d)+", 20, 10});
+        const auto bcd_longer = engine.add_query({"bcd_longer", "b(c|d)+", 20, 12});
+        const auto wildcard = engine.add_query({"wildcard", "a.e", 15, 10});
+        CHECK(engine.number_of_compiled_queries() == 3);
+        CHECK(engine.selector(bcd).query() == engine.selector(bcd_again).query());
+        CHECK(engine.selector(bcd).query() != engine.selector(bcd_longer).query());
+
+        for (std::size_t idx = 0; auto c : input)
+            engine.process_event({c, 0, idx++});
+
+        const auto check_query = [&](std::size_t query_idx, std::string_view alphabet) {
+            const auto &definition = engine.definition(query_idx);
+            CAPTURE(definition.name);
+
+            suse::summary_selector_count<long> selector{definition.regex, definition.summary_size, definition.time_window_size};
+            const suse::eviction_strategies::suse strategy{selector, suse::generate_uniform_probabilities<double>(selector.automaton())};
+
+            std::size_t processed = 0;
+            for (std::size_t idx = 0; auto c : input) {
+                if (alphabet.empty() || alphabet.find(c) != std::string_view::npos) {
+                    selector.process_event({c, 0, idx}, strategy);
+                    ++processed;
+                }
+                ++idx;
+            }
+
+            CHECK(engine.statistics(query_idx).processed_events == processed);
+            CHECK(engine.selector(query_idx).number_of_detected_complete_matches() == selector.number_of_detected_complete_matches());
+            CHECK(engine.selector(query_idx).number_of_contained_complete_matches() == selector.number_of_contained_complete_matches());
+            CHECK(std::ranges::equal(engine.selector(query_idx).cached_events(), selector.cached_events()));
+        };
+
+        check_query(bcd, "bcd");
+        check_query(bcd_again, "bcd");
+        check_query(bcd_longer, "bcd");
+        check_query(wildcard, "");
+    }
+}
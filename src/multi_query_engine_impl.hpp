@@ -0,0 +1,114 @@
+/*
+	Never include directly!
+	This is included by multi_query_engine.hpp and only exists to split
+	interface and implementation despite the template.
+*/
+
+#include "probabilities.hpp"
+#include "regex.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace suse {
+
+inline std::vector<query_definition> read_query_definitions(std::istream &in) {
+    std::vector<query_definition> definitions;
+
+    std::size_t line_number = 0;
+    for (std::string line; std::getline(in, line);) {
+        ++line_number;
+        if (line.empty() || line.front() == '#')
+            continue;
+
+        std::istringstream fields{line};
+        query_definition definition;
+        if (!(fields >> definition.name >> definition.summary_size >> definition.time_window_size >> definition.regex))
+            throw std::invalid_argument("Malformed query definition in line " + std::to_string(line_number));
+
+        definitions.push_back(std::move(definition));
+    }
+
+    return definitions;
+}
+
+template <typename counter_type, typename factor_type>
+multi_query_engine<counter_type, factor_type>::multi_query_engine(query_strategy strategy, std::unordered_map<char, factor_type> probabilities)
+    : strategy_{strategy},
+      probabilities_{std::move(probabilities)} {}
+
+template <typename counter_type, typename factor_type>
+std::size_t multi_query_engine<counter_type, factor_type>::add_query(query_definition definition) {
+    const auto compiled = compile(definition.regex, definition.time_window_size);
+
+    auto new_query = std::make_unique<query>();
+    new_query->selector = std::make_unique<selector_type>(compiled, definition.summary_size, definition.time_window_size, definition.time_to_live);
+    if (strategy_ == query_strategy::suse)
+        new_query->strategy.emplace(*new_query->selector);
+    new_query->definition = std::move(definition);
+
+    const auto query_idx = queries_.size();
+    queries_.push_back(std::move(new_query));
+
+    std::array<bool, 256> reads{};
+    for (const auto &state : compiled->automaton().states()) {
+        for (const auto &[symbol, _] : state.transitions)
+            reads[static_cast<unsigned char>(symbol)] = true;
+    }
+
+    const auto reads_everything = reads[static_cast<unsigned char>(nfa::wildcard_symbol)];
+    for (std::size_t symbol = 0; symbol < reads.size(); ++symbol) {
+        if (reads_everything || reads[symbol])
+            queries_by_symbol_[symbol].push_back(query_idx);
+    }
+
+    return query_idx;
+}
+
+template <typename counter_type, typename factor_type>
+void multi_query_engine<counter_type, factor_type>::process_event(const event &new_event) {
+    for (auto query_idx : queries_by_symbol_[static_cast<unsigned char>(new_event.type)]) {
+        auto &q = *queries_[query_idx];
+
+        const auto start = std::chrono::steady_clock::now();
+        switch (strategy_) {
+        case query_strategy::suse:
+            q.selector->process_event(new_event, *q.strategy);
+            break;
+        case query_strategy::fifo:
+            q.selector->process_event(new_event, eviction_strategies::fifo);
+            break;
+        case query_strategy::random:
+            q.selector->process_event(new_event, eviction_strategies::random);
+            break;
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        q.statistics.processing_time += end - start;
+        ++q.statistics.processed_events;
+    }
+}
+
+template <typename counter_type, typename factor_type>
+std::shared_ptr<const compiled_query<>> multi_query_engine<counter_type, factor_type>::compile(const std::string &regex, std::size_t time_window_size) {
+    const auto with_tables = strategy_ == query_strategy::suse;
+    const std::pair key{regex, with_tables ? time_window_size : 0};
+    if (auto it = compiled_.find(key); it != compiled_.end())
+        return it->second;
+
+    // the automaton does not depend on the time window
+    const auto same_regex = compiled_.lower_bound({regex, 0});
+    auto automaton = same_regex != compiled_.end() && same_regex->first.first == regex ? same_regex->second->automaton() : parse_regex(regex);
+    auto edges = compute_edges_per_character(automaton);
+
+    std::shared_ptr<const compiled_query<>> compiled;
+    if (with_tables) {
+        const auto probabilities = probabilities_.empty() ? generate_uniform_probabilities<factor_type>(automaton) : probabilities_;
+        auto tables = strategy_type::compute_expected_changes(automaton, time_window_size, probabilities);
+        compiled = std::make_shared<const compiled_query<>>(std::move(automaton), std::move(edges), time_window_size, std::move(tables));
+    } else
+        compiled = std::make_shared<const compiled_query<>>(std::move(automaton), std::move(edges));
+
+    return compiled_.emplace(key, std::move(compiled)).first->second;
+}
+} // namespace suse
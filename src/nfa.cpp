@@ -1,10 +1,90 @@
 #include "nfa.hpp"
 
+#include "bit_parallel_nfa.hpp"
+
+#include <array>
+#include <cassert>
 #include <numeric>
+#include <span>
 #include <string>
 
 using namespace suse;
 
+namespace {
+// Partition of {0, ..., n-1} into sets, following Valmari and Lehtinen. Elements of a set are stored contiguously,
+// marked ones at the front, so splitting off the marked elements costs time proportional to their number.
+class refinable_partition {
+  public:
+    explicit refinable_partition(std::size_t size) : elements_(size), location_(size), set_of_(size, 0) {
+        std::iota(elements_.begin(), elements_.end(), std::size_t{0});
+        std::iota(location_.begin(), location_.end(), std::size_t{0});
+        if (size > 0) {
+            first_.push_back(0);
+            past_.push_back(size);
+            marked_.push_back(0);
+        }
+    }
+
+    std::size_t number_of_sets() const { return first_.size(); }
+    std::size_t set_of(std::size_t element) const { return set_of_[element]; }
+    std::size_t size_of(std::size_t set) const { return past_[set] - first_[set]; }
+
+    std::span<const std::size_t> elements_of(std::size_t set) const {
+        return {elements_.begin() + first_[set], elements_.begin() + past_[set]};
+    }
+
+    // every element may be marked at most once between two splits
+    void mark(std::size_t element) {
+        const auto set = set_of_[element];
+        const auto from = location_[element];
+        const auto to = first_[set] + marked_[set];
+        assert(from >= to);
+
+        elements_[from] = elements_[to];
+        location_[elements_[from]] = from;
+        elements_[to] = element;
+        location_[element] = to;
+
+        if (marked_[set]++ == 0)
+            touched_.push_back(set);
+    }
+
+    // splits every set with marked and unmarked elements, the smaller part becomes a new set
+    template <typename callback_type>
+    void split(callback_type on_split) {
+        for (auto set : touched_) {
+            const auto boundary = first_[set] + marked_[set];
+            marked_[set] = 0;
+            if (boundary == past_[set])
+                continue;
+
+            const auto new_set = first_.size();
+            if (boundary - first_[set] <= past_[set] - boundary) {
+                first_.push_back(first_[set]);
+                past_.push_back(boundary);
+                first_[set] = boundary;
+            } else {
+                first_.push_back(boundary);
+                past_.push_back(past_[set]);
+                past_[set] = boundary;
+            }
+            marked_.push_back(0);
+
+            for (auto idx = first_[new_set]; idx < past_[new_set]; ++idx)
+                set_of_[elements_[idx]] = new_set;
+
+            on_split(set, new_set);
+        }
+        touched_.clear();
+    }
+
+  private:
+    std::vector<std::size_t> elements_, location_, set_of_;
+    std::vector<std::size_t> first_, past_, marked_;
+    std::vector<std::size_t> touched_;
+};
+} // namespace
+
 suse::nfa nfa::singleton(char symbol) {
     nfa result;
     result.initial_state_id_ = 0;
@@ -15,28 +95,59 @@ suse::nfa nfa::singleton(char symbol) {
     return result;
 }
 
-bool nfa::check(std::string_view word) const {
-    std::unordered_set<std::size_t> current_state_ids{initial_state_id_};
+suse::nfa nfa::symbol_class(std::string_view symbols) {
+    nfa result;
+    result.initial_state_id_ = 0;
+    result.states_.push_back(state{{}, false});
+    result.states_.push_back(state{{}, true});
 
-    for (auto c : word) {
-        std::unordered_set<std::size_t> next_state_ids;
-        for (auto state_id : current_state_ids) {
-            const auto &current_state = states_[state_id];
-            if (auto it = current_state.transitions.find(c); it != current_state.transitions.end())
-                next_state_ids.insert(it->second.begin(), it->second.end());
+    for (char symbol : symbols)
+        result.states_[0].transitions[symbol].insert(1);
 
-            if (auto it = current_state.transitions.find(wildcard_symbol); it != current_state.transitions.end())
-                next_state_ids.insert(it->second.begin(), it->second.end());
-        }
-        current_state_ids = std::move(next_state_ids);
+    return result;
+}
 
-        if (current_state_ids.empty())
-            return false;
+suse::nfa nfa::position_automaton(std::span<const std::string> symbols, std::span<const std::vector<std::size_t>> follow, std::span<const std::size_t> first, std::span<const std::size_t> last, bool nullable) {
+    assert(symbols.size() == follow.size());
+
+    nfa result;
+    result.initial_state_id_ = 0;
+    result.states_.resize(symbols.size() + 1, state{{}, false});
+
+    const auto connect = [&](state &from, std::size_t to) {
+        for (char symbol : symbols[to])
+            from.transitions[symbol].insert(to + 1);
+    };
+
+    for (auto position : first)
+        connect(result.states_[0], position);
+
+    for (std::size_t position = 0; position < symbols.size(); ++position) {
+        for (auto next : follow[position])
+            connect(result.states_[position + 1], next);
     }
 
-    return std::any_of(current_state_ids.begin(), current_state_ids.end(), [&](auto id) {
-        return states_[id].is_final;
-    });
+    for (auto position : last)
+        result.states_[position + 1].is_final = true;
+    result.states_[0].is_final = nullable;
+
+    result.remove_unreachable_states();
+    while (result.try_merge_redundant_states())
+        /*intentionally blank*/;
+    return result;
+}
+
+suse::nfa nfa::from_states(std::vector<state> states, std::size_t initial_state_id) {
+    assert(initial_state_id < states.size());
+
+    nfa result;
+    result.initial_state_id_ = initial_state_id;
+    result.states_ = std::move(states);
+    return result;
+}
+
+bool nfa::check(std::string_view word) const {
+    return bit_parallel_nfa{*this}.check(word);
 }
 
 void nfa::simplify() {
@@ -46,6 +157,173 @@ void nfa::simplify() {
         /*intentionally blank*/;
 }
 
+// Merges all states that are forward bisimilar, i.e. have the same finality and, for every symbol, reach the same
+// classes of states. This is a superset of the states with identical transitions that every automaton is already
+// merged by, but only keeps the language intact: transitions into merged states collapse into one, so the number
+// of accepting runs per word can drop, e.g. for a*a* or ((a)*)+. Match counts of a reduced query differ from those
+// of its regex.
+// The coarsest such partition is computed by partition refinement following Paige and Tarjan: every state is only
+// part of a splitter O(log n) times and each time only its incoming transitions are touched, giving O(m log n).
+void nfa::reduce() {
+    constexpr std::size_t number_of_symbols = 256;
+    const auto symbol_index = [](char symbol) -> std::size_t { return static_cast<unsigned char>(symbol); };
+
+    struct transition {
+        std::size_t from;
+        char symbol;
+        std::size_t to;
+    };
+
+    // all transitions with the same source and symbol share one counter of how many of them lead into a given
+    // union of blocks (the "compound" block their targets currently belong to)
+    std::vector<transition> transitions;
+    std::vector<std::size_t> count_of, remaining_count;
+    std::array<std::vector<std::size_t>, number_of_symbols> sources_per_symbol;
+    for (std::size_t state_id = 0; state_id < states_.size(); ++state_id) {
+        for (const auto &[symbol, targets] : states_[state_id].transitions) {
+            assert(symbol != epsilon_symbol);
+
+            sources_per_symbol[symbol_index(symbol)].push_back(state_id);
+            for (auto target : targets) {
+                transitions.push_back({state_id, symbol, target});
+                count_of.push_back(remaining_count.size());
+            }
+            remaining_count.push_back(targets.size());
+        }
+    }
+
+    std::vector<std::size_t> incoming_start(states_.size() + 1, 0), incoming(transitions.size());
+    for (const auto &t : transitions)
+        ++incoming_start[t.to + 1];
+    std::partial_sum(incoming_start.begin(), incoming_start.end(), incoming_start.begin());
+    auto next_incoming = incoming_start;
+    for (std::size_t idx = 0; idx < transitions.size(); ++idx)
+        incoming[next_incoming[transitions[idx].to]++] = idx;
+
+    refinable_partition blocks{states_.size()};
+    std::vector<std::size_t> compound_of_block{0};
+    std::vector<std::vector<std::size_t>> blocks_of_compound{{0}};
+    std::vector<std::size_t> splittable_compounds;
+
+    const auto split_blocks = [&]() {
+        blocks.split([&](std::size_t old_block, std::size_t new_block) {
+            const auto compound = compound_of_block[old_block];
+            assert(new_block == compound_of_block.size());
+            compound_of_block.push_back(compound);
+            blocks_of_compound[compound].push_back(new_block);
+            if (blocks_of_compound[compound].size() == 2)
+                splittable_compounds.push_back(compound);
+        });
+    };
+
+    // initially, states are distinguished by finality and by the symbols they have any transition for
+    for (std::size_t state_id = 0; state_id < states_.size(); ++state_id) {
+        if (states_[state_id].is_final)
+            blocks.mark(state_id);
+    }
+    split_blocks();
+
+    for (const auto &sources : sources_per_symbol) {
+        for (auto source : sources)
+            blocks.mark(source);
+        split_blocks();
+    }
+
+    std::vector<std::size_t> count_in_splitter(states_.size(), 0), count_record(states_.size()), sources;
+    std::array<std::vector<std::size_t>, number_of_symbols> incoming_per_symbol;
+    std::vector<std::size_t> touched_symbols;
+
+    while (!splittable_compounds.empty()) {
+        auto &members = blocks_of_compound[splittable_compounds.back()];
+        if (members.size() < 2) {
+            splittable_compounds.pop_back();
+            continue;
+        }
+
+        // the smaller of two blocks becomes a compound block of its own and is used as splitter
+        const std::size_t pick = blocks.size_of(members[0]) <= blocks.size_of(members[1]) ? 0 : 1;
+        const auto splitter = members[pick];
+        members[pick] = members.back();
+        members.pop_back();
+        if (members.size() < 2)
+            splittable_compounds.pop_back();
+
+        compound_of_block[splitter] = blocks_of_compound.size();
+        blocks_of_compound.push_back({splitter});
+
+        for (auto state_id : blocks.elements_of(splitter)) {
+            for (auto idx = incoming_start[state_id]; idx < incoming_start[state_id + 1]; ++idx) {
+                const auto symbol = symbol_index(transitions[incoming[idx]].symbol);
+                if (incoming_per_symbol[symbol].empty())
+                    touched_symbols.push_back(symbol);
+                incoming_per_symbol[symbol].push_back(incoming[idx]);
+            }
+        }
+
+        for (auto symbol : touched_symbols) {
+            auto &into_splitter = incoming_per_symbol[symbol];
+
+            sources.clear();
+            for (auto t : into_splitter) {
+                const auto from = transitions[t].from;
+                if (count_in_splitter[from]++ == 0) {
+                    sources.push_back(from);
+                    count_record[from] = count_of[t];
+                }
+            }
+
+            // separate states reaching the splitter from those that do not...
+            for (auto from : sources)
+                blocks.mark(from);
+            split_blocks();
+
+            // ...and those reaching only the splitter from those also reaching the rest of its former compound
+            for (auto from : sources) {
+                if (count_in_splitter[from] == remaining_count[count_record[from]])
+                    blocks.mark(from);
+            }
+            split_blocks();
+
+            // transitions into the splitter now target a compound block of their own and need their own counter
+            for (auto from : sources) {
+                remaining_count[count_record[from]] -= count_in_splitter[from];
+                count_record[from] = remaining_count.size();
+                remaining_count.push_back(count_in_splitter[from]);
+                count_in_splitter[from] = 0;
+            }
+            for (auto t : into_splitter)
+                count_of[t] = count_record[transitions[t].from];
+
+            into_splitter.clear();
+        }
+        touched_symbols.clear();
+    }
+
+    if (blocks.number_of_sets() == states_.size())
+        return;
+
+    // number the merged states in order of their first member to keep the result deterministic
+    std::vector<std::size_t> new_id(blocks.number_of_sets(), states_.size());
+    std::size_t number_of_merged_states = 0;
+    for (std::size_t state_id = 0; state_id < states_.size(); ++state_id) {
+        if (auto &id = new_id[blocks.set_of(state_id)]; id == states_.size())
+            id = number_of_merged_states++;
+    }
+
+    std::vector<state> merged_states(number_of_merged_states, state{{}, false});
+    for (std::size_t state_id = 0; state_id < states_.size(); ++state_id) {
+        auto &merged = merged_states[new_id[blocks.set_of(state_id)]];
+        merged.is_final = states_[state_id].is_final;
+        for (const auto &[symbol, targets] : states_[state_id].transitions) {
+            for (auto target : targets)
+                merged.transitions[symbol].insert(new_id[blocks.set_of(target)]);
+        }
+    }
+
+    initial_state_id_ = new_id[blocks.set_of(initial_state_id_)];
+    states_ = std::move(merged_states);
+}
+
 void nfa::eliminate_epsilon_transitions() {
     std::vector<std::unordered_set<std::size_t>> merged_per_state(states_.size());
 
@@ -92,59 +370,59 @@ void nfa::remove_unreachable_states() {
     erase_some(unreachable);
 }
 
+// States with the same finality and the same transitions are merged. Doing so can make their predecessors
+// identical in turn, which the next call merges. States are grouped by a hash of their transitions instead of
+// being compared pairwise, and all transitions are renamed in a single pass.
 bool nfa::try_merge_redundant_states() {
-    std::vector<std::size_t> grouping(states_.size());
-    std::iota(grouping.begin(), grouping.end(), std::size_t{0});
-
-    const auto find_representative_state = [&](std::size_t state_id) {
-        std::size_t representative = state_id;
-        while (grouping[representative] != representative)
-            representative = grouping[representative];
-
-        //compact:
-        while (grouping[state_id] != state_id) {
-            const auto next = grouping[state_id];
-            grouping[state_id] = representative;
-            state_id = next;
+    const auto hash_of = [](const state &s) {
+        // independent of the iteration order of the transitions
+        std::size_t hash = s.is_final;
+        for (const auto &[symbol, targets] : s.transitions) {
+            for (auto target : targets)
+                hash += std::hash<std::size_t>{}(target * 0x9e3779b97f4a7c15 ^ static_cast<unsigned char>(symbol));
         }
-
-        return representative;
-    };
-
-    const auto merge_groups = [&](std::size_t state_id0, std::size_t state_id1) {
-        state_id0 = find_representative_state(state_id0);
-        state_id1 = find_representative_state(state_id1);
-
-        if (state_id0 != state_id1)
-            grouping[state_id0] = state_id1;
+        return hash;
     };
 
+    std::vector<std::size_t> representative(states_.size());
+    std::unordered_map<std::size_t, std::vector<std::size_t>> representatives_by_hash;
     bool any_merged = false;
-    for (std::size_t state0_id = 0; state0_id < states_.size(); ++state0_id) {
-        for (std::size_t state1_id = state0_id + 1; state1_id < states_.size(); ++state1_id) {
-            if (states_[state0_id] == states_[state1_id]) {
-                merge_groups(state0_id, state1_id);
-                any_merged = true;
-            }
+    for (std::size_t state_id = 0; state_id < states_.size(); ++state_id) {
+        auto &candidates = representatives_by_hash[hash_of(states_[state_id])];
+        const auto identical = std::find_if(candidates.begin(), candidates.end(), [&](auto id) { return states_[id] == states_[state_id]; });
+        if (identical == candidates.end()) {
+            representative[state_id] = state_id;
+            candidates.push_back(state_id);
+        } else {
+            representative[state_id] = *identical;
+            any_merged = true;
         }
     }
 
-    std::vector<bool> should_erase(states_.size(), false);
-    initial_state_id_ = find_representative_state(initial_state_id_);
+    if (!any_merged)
+        return false;
+
+    std::vector<std::size_t> new_id(states_.size());
+    std::vector<state> merged_states;
     for (std::size_t state_id = 0; state_id < states_.size(); ++state_id) {
-        if (auto rep = find_representative_state(state_id); rep != state_id) {
-            should_erase[state_id] = true;
-            for (auto &state : states_) {
-                for (auto &[_, transitions] : state.transitions) {
-                    if (transitions.erase(state_id) > 0)
-                        transitions.insert(rep);
-                }
-            }
+        if (representative[state_id] == state_id) {
+            new_id[state_id] = merged_states.size();
+            merged_states.push_back(std::move(states_[state_id]));
+        }
+    }
+
+    for (auto &merged : merged_states) {
+        for (auto &[_, targets] : merged.transitions) {
+            std::unordered_set<std::size_t> renamed;
+            for (auto target : targets)
+                renamed.insert(new_id[representative[target]]);
+            targets = std::move(renamed);
         }
     }
-    erase_some(should_erase);
 
-    return any_merged;
+    initial_state_id_ = new_id[representative[initial_state_id_]];
+    states_ = std::move(merged_states);
+    return true;
 }
 
 void nfa::erase_some(std::vector<bool> should_erase) {
@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <iostream>
 #include <span>
+#include <string>
 #include <string_view>
 #include <unordered_map>
 #include <unordered_set>
@@ -27,9 +28,19 @@ class nfa {
     static constexpr char epsilon_symbol = '\0';  // it just has to be something that cannot appear in normal text
 
     static nfa singleton(char symbol);
+    static nfa symbol_class(std::string_view symbols); // two states, connected by one edge per symbol
+
+    // Position automaton of a regex: state 0 is initial, state p + 1 is entered by reading one of the symbols of position p
+    static nfa position_automaton(std::span<const std::string> symbols, std::span<const std::vector<std::size_t>> follow, std::span<const std::size_t> first, std::span<const std::size_t> last, bool nullable);
+
+    // Automaton that was compiled before, e.g. loaded from a query_artifact
+    static nfa from_states(std::vector<state> states, std::size_t initial_state_id);
 
     bool check(std::string_view word) const;
 
+    // Only keeps the language, not the number of runs per word, see the definition
+    void reduce();
+
     std::size_t number_of_states() const { return states_.size(); }
     std::size_t initial_state_id() const { return initial_state_id_; }
     std::span<const state> states() const { return states_; }
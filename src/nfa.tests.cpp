@@ -84,4 +84,48 @@ TEST_SUITE("suse::nfa") {
         CAPTURE(input);
         CHECK(!astar.check(input));
     }
+
+    TEST_CASE("identical states are merged") {
+        const auto a = suse::nfa::singleton('a');
+        const auto b = suse::nfa::singleton('b');
+        const auto c = suse::nfa::singleton('c');
+        const auto ab_or_cb = union_automaton(concatenate(a, b), concatenate(c, b));
+        CHECK(ab_or_cb.number_of_states() == 3);
+
+        CHECK(ab_or_cb.check("ab"));
+        CHECK(ab_or_cb.check("cb"));
+        CHECK(!ab_or_cb.check("b"));
+        CHECK(!ab_or_cb.check("abb"));
+        CHECK(!ab_or_cb.check("ac"));
+    }
+
+    TEST_CASE("reduce") {
+        const auto a = suse::nfa::singleton('a');
+        const auto b = suse::nfa::singleton('b');
+        auto astar_astar_b = concatenate(concatenate(kleene(a), kleene(a)), b);
+        const auto unreduced_states = astar_astar_b.number_of_states();
+
+        astar_astar_b.reduce();
+        CHECK(astar_astar_b.number_of_states() < unreduced_states);
+        CHECK(astar_astar_b.number_of_states() == 2);
+
+        CHECK(astar_astar_b.check("b"));
+        CHECK(astar_astar_b.check("aab"));
+        CHECK(!astar_astar_b.check("a"));
+        CHECK(!astar_astar_b.check("aba"));
+    }
+
+    TEST_CASE("reduce nested repetition") {
+        auto nested = kleene(concatenate(kleene(suse::nfa::singleton('a')), kleene(suse::nfa::singleton('a'))));
+        nested.reduce();
+
+        CHECK(nested.number_of_states() == 1);
+
+        std::string input = "";
+        for (std::size_t i = 0; i < 10; ++i, input += "a") {
+            CAPTURE(input);
+            REQUIRE(nested.check(input));
+        }
+        CHECK(!nested.check("ab"));
+    }
 }
@@ -0,0 +1,29 @@
+#ifndef SUSE_OFFLINE_COUNTING_HPP
+#define SUSE_OFFLINE_COUNTING_HPP
+
+#include "compiled_query.hpp"
+#include "event.hpp"
+#include "summary_selector_count.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <memory>
+#include <span>
+
+#include <cstddef>
+
+namespace suse {
+// Smallest summary size that keeps every event until it left the time window, assuming ordered timestamps.
+// With it, fifo eviction never drops an event that can still be part of a match.
+std::size_t summary_size_for_all_matches(std::span<const event> events, std::size_t time_window_size);
+
+// Counts the matches of a stream that is available as a whole, e.g. an archive. The stream is split into
+// chunks that are processed in parallel and merged pairwise in a tree. The resulting selector has seen all
+// events and reports the same counts as processing them one by one with a summary that keeps every event
+// of a time window.
+template <typename counter_type>
+std::unique_ptr<summary_selector_count<counter_type>> count_offline(std::shared_ptr<const compiled_query<>> query, std::span<const event> events, std::size_t time_window_size, work_stealing_pool &pool, std::size_t number_of_chunks);
+} // namespace suse
+
+#include "offline_counting_impl.hpp"
+
+#endif
@@ -0,0 +1,44 @@
+#include "offline_counting.hpp"
+#include "regex.hpp"
+
+#include <boost/multiprecision/cpp_int.hpp>
+
+#include <doctest/doctest.h>
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+TEST_SUITE("suse::offline_counting") {
+    TEST_CASE("summary size for all matches") {
+        const std::vector<suse::event> events{{'a', 0, 0}, {'b', 0, 0}, {'a', 0, 1}, {'b', 0, 5}, {'c', 0, 6}, {'d', 0, 6}, {'e', 0, 7}};
+
+        CHECK(suse::summary_size_for_all_matches(events, 0) == 3);
+        CHECK(suse::summary_size_for_all_matches(events, 1) == 4);
+        CHECK(suse::summary_size_for_all_matches(events, 10) == 8);
+    }
+
+    TEST_CASE("matches streaming counts") {
+        using int_type = boost::multiprecision::uint128_t;
+        const std::string_view input = "BBBABBCBCBBACABABCCCBBACBABBACXXXBBBCDCBCCBAABBABACBADBDCBCBAABBACDXXXXXXXXABAACBACBADCBCDBBDBBACBABAACBDCABBBABBBACCBCBBCDAACCBBBBAABADACBABCAACAABBBACBBDACBBBCBACACBACBCBBDAABBBABBCDCACABACB";
+        constexpr std::size_t time_window_size = 20;
+
+        std::vector<suse::event> events;
+        for (std::size_t idx = 0; idx < input.size(); ++idx)
+            events.push_back({input[idx], 0, idx / 3}); // shared timestamps
+
+        const auto query = std::make_shared<const suse::compiled_query<>>(suse::parse_regex("A(B*C)*D"));
+        suse::summary_selector_count<int_type> streaming{query, input.size(), time_window_size};
+        for (const auto &e : events)
+            streaming.process_event(e);
+
+        suse::work_stealing_pool pool{3};
+        for (std::size_t number_of_chunks : {1, 2, 5, 8, 1000}) {
+            CAPTURE(number_of_chunks);
+
+            const auto counted = suse::count_offline<int_type>(query, events, time_window_size, pool, number_of_chunks);
+            CHECK(counted->number_of_detected_complete_matches() == streaming.number_of_detected_complete_matches());
+            CHECK(counted->number_of_detected_partial_matches() == streaming.number_of_detected_partial_matches());
+        }
+    }
+}
@@ -0,0 +1,58 @@
+/*
+	Never include directly!
+	This is included by offline_counting.hpp and only exists to split
+	interface and implementation despite the template.
+*/
+
+#include "eviction_strategies.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace suse {
+
+inline std::size_t summary_size_for_all_matches(std::span<const event> events, std::size_t time_window_size) {
+    std::size_t largest_window = 0;
+    for (std::size_t window_start = 0, idx = 0; idx < events.size(); ++idx) {
+        while (events[idx].timestamp - events[window_start].timestamp > time_window_size)
+            ++window_start;
+        largest_window = std::max(largest_window, idx - window_start + 1);
+    }
+
+    return largest_window + 1; // the new event is added before an old one left the window
+}
+
+template <typename counter_type>
+std::unique_ptr<summary_selector_count<counter_type>> count_offline(std::shared_ptr<const compiled_query<>> query, std::span<const event> events, std::size_t time_window_size, work_stealing_pool &pool, std::size_t number_of_chunks) {
+    using selector_type = summary_selector_count<counter_type>;
+
+    const auto summary_size = summary_size_for_all_matches(events, time_window_size);
+    number_of_chunks = std::clamp<std::size_t>(number_of_chunks, 1, std::max<std::size_t>(events.size(), 1));
+    const auto chunk_size = (events.size() + number_of_chunks - 1) / number_of_chunks;
+
+    std::vector<std::unique_ptr<selector_type>> chunks;
+    for (std::size_t idx = 0; idx < number_of_chunks; ++idx) {
+        chunks.push_back(std::make_unique<selector_type>(query, summary_size, time_window_size));
+        chunks.back()->enable_merging();
+    }
+
+    for (std::size_t idx = 0; idx < number_of_chunks; ++idx) {
+        pool.submit([&, idx] {
+            const auto begin = std::min(idx * chunk_size, events.size());
+            const auto end = std::min(begin + chunk_size, events.size());
+            for (const auto &e : events.subspan(begin, end - begin))
+                chunks[idx]->process_event(e, eviction_strategies::fifo);
+        });
+    }
+    pool.wait_idle();
+
+    // merging is associative, so neighbouring chunks are merged pairwise on every level of the tree
+    for (std::size_t stride = 1; stride < number_of_chunks; stride *= 2) {
+        for (std::size_t idx = 0; idx + stride < number_of_chunks; idx += 2 * stride)
+            pool.submit([&, idx, stride] { merge(*chunks[idx], *chunks[idx + stride]); });
+        pool.wait_idle();
+    }
+
+    return std::move(chunks.front());
+}
+} // namespace suse
@@ -0,0 +1,90 @@
+#include "compiled_query.hpp"
+#include "offline_counting.hpp"
+#include "regex.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <boost/multiprecision/cpp_int.hpp>
+
+#include <cxxopts.hpp>
+
+#include <fmt/chrono.h>
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using nanoseconds = std::chrono::nanoseconds;
+using counter_type = boost::multiprecision::uint128_t;
+
+template <>
+struct fmt::formatter<counter_type> : fmt::ostream_formatter {}; // enables fmt::print to print values of boost::multiprecision::uint128_t
+
+int main(int argc, char *argv[]) try {
+    cxxopts::Options options("offline_summary_selector", "Counts the matches of an archived event stream on all cores");
+    options.add_options()("query,q", "Regex/Query to evaluate", cxxopts::value<std::string>())("time-window-size,t", "Size of one time window", cxxopts::value<std::size_t>())("threads,j", "Number of worker threads. Default is the number of cores", cxxopts::value<std::size_t>()->default_value(std::to_string(std::thread::hardware_concurrency())))("chunks", "Number of chunks the stream is split into. Default is four per thread", cxxopts::value<std::size_t>())("report,r", "File to write results to", cxxopts::value<std::string>())("help,h", "Display this help meassage");
+
+    options.parse_positional("query");
+    options.positional_help("query");
+
+    const auto parsed_args = options.parse(argc, argv);
+
+    if (parsed_args.count("help") > 0 || argc < 2) {
+        fmt::print("{}", options.help());
+        return 0;
+    }
+
+    for (auto required : {"query", "time-window-size"}) {
+        if (parsed_args.count(required) == 0) {
+            fmt::print(stderr, "{} is a required argument\n", required);
+            return 1;
+        }
+    }
+
+    const auto time_window_size = parsed_args["time-window-size"].template as<std::size_t>();
+
+    std::ios::sync_with_stdio(false);
+
+    const auto start_time = std::chrono::steady_clock::now();
+    const auto query = std::make_shared<const suse::compiled_query<>>(suse::parse_regex(parsed_args["query"].template as<std::string>()));
+
+    std::vector<suse::event> events;
+    for (suse::event next_event; std::cin >> next_event;)
+        events.push_back(next_event);
+
+    suse::work_stealing_pool pool{parsed_args["threads"].template as<std::size_t>()};
+    const auto number_of_chunks = parsed_args.count("chunks") > 0 ? parsed_args["chunks"].template as<std::size_t>() : 4 * pool.number_of_threads();
+
+    const auto processing_start_time = std::chrono::steady_clock::now();
+    const auto selector = suse::count_offline<counter_type>(query, events, time_window_size, pool, number_of_chunks);
+    const auto processing_end_time = std::chrono::steady_clock::now();
+
+    fmt::print("Detected Partial Matches: {}, Detected Complete Matches: {}\n", selector->number_of_detected_partial_matches(), selector->number_of_detected_complete_matches());
+
+    if (parsed_args.count("report") > 0) {
+        std::ofstream out{parsed_args["report"].template as<std::string>()};
+        fmt::print(out, "{{\n");
+        fmt::print(out, "\t\"initialization_time_ns\": {},\n", nanoseconds{processing_start_time - start_time}.count());
+        fmt::print(out, "\t\"runtime_ns\": {},\n", nanoseconds{processing_end_time - processing_start_time}.count());
+        fmt::print(out, "\t\"threads\": {},\n", pool.number_of_threads());
+        fmt::print(out, "\t\"chunks\": {},\n", number_of_chunks);
+        fmt::print(out, "\t\"processed_events\": {},\n", events.size());
+        fmt::print(out, "\t\"detected_matches\": {},\n", selector->number_of_detected_complete_matches());
+        fmt::print(out, "\t\"detected_partial_matches\": {}\n", selector->number_of_detected_partial_matches());
+        fmt::print(out, "}}\n");
+    }
+
+    return 0;
+} catch (const cxxopts::exceptions::exception &e) {
+    fmt::print(stderr, "Error parsing arguments: {}\n", e.what());
+    return 1;
+} catch (const suse::regex_parse_error &e) {
+    fmt::print(stderr, "Invalid query at position {}: {}\n", e.location, e.what());
+    return 1;
+}
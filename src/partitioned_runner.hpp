@@ -0,0 +1,81 @@
+#ifndef SUSE_PARTITIONED_RUNNER_HPP
+#define SUSE_PARTITIONED_RUNNER_HPP
+
+#include "compiled_query.hpp"
+#include "event.hpp"
+#include "eviction_strategies.hpp"
+#include "nfa.hpp"
+#include "summary_selector_count.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <cstddef>
+
+namespace suse {
+// Evaluates a query separately for every partition key of the stream, with one selector per key. Events are
+// collected per partition on the calling thread and handed to the pool in batches. At most one batch of a
+// partition is processed at a time, so every selector sees its events in stream order.
+template <typename counter_type, typename factor_type>
+class partitioned_runner {
+  public:
+    using selector_type = summary_selector_count<counter_type>;
+    using strategy_type = eviction_strategies::suse<counter_type, factor_type>;
+
+    struct partition_statistics {
+        std::size_t processed_events = 0;
+        std::size_t processed_batches = 0;
+    };
+
+    // For the suse strategy, uniform probabilities over the alphabet of the query are used if none are given
+    partitioned_runner(const nfa &automaton, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live, query_strategy strategy, work_stealing_pool &pool, std::unordered_map<char, factor_type> probabilities = {}, std::size_t batch_size = 256);
+
+    // Not thread-safe, events are expected to be ingested from a single thread
+    void process_event(const event &new_event);
+
+    // Hands over all buffered events and waits until they are processed
+    void flush();
+
+    std::size_t number_of_partitions() const { return partitions_.size(); }
+    std::vector<std::size_t> keys() const;
+
+    // Only valid after flush
+    const selector_type &selector(std::size_t key) const { return *partitions_.at(key)->selector; }
+    const partition_statistics &statistics(std::size_t key) const { return partitions_.at(key)->statistics; }
+
+  private:
+    struct partition {
+        std::unique_ptr<selector_type> selector;
+        std::optional<strategy_type> strategy;
+        partition_statistics statistics;
+
+        std::vector<event> buffer; // owned by the ingesting thread
+
+        std::mutex mutex;
+        std::vector<event> handed_over;
+        bool scheduled = false;
+    };
+
+    std::shared_ptr<const compiled_query<>> query_; // shared by the selectors of all partitions
+    std::size_t summary_size_, time_window_size_, time_to_live_;
+    query_strategy strategy_;
+
+    work_stealing_pool &pool_;
+    std::size_t batch_size_;
+
+    std::unordered_map<std::size_t, std::unique_ptr<partition>> partitions_;
+
+    partition &partition_for(std::size_t key);
+    void hand_over(partition &p);
+    void drain(partition &p);
+};
+} // namespace suse
+
+#include "partitioned_runner_impl.hpp"
+
+#endif
@@ -0,0 +1,42 @@
+#include "partitioned_runner.hpp"
+#include "probabilities.hpp"
+#include "regex.hpp"
+
+#include <doctest/doctest.h>
+
+#include <algorithm>
+#include <string_view>
+
+TEST_SUITE("suse::partitioned_runner") {
+    TEST_CASE("matches one selector per key") {
+        const std::string_view input = "aabcdacbadcbacdbcacbdaedabaaebdedaaddccdeaceabdebdeadaaabeadabdadbcadcdabeadeadcbedeaabbcbcbcacbccbabcdeacbdeabdad";
+        constexpr std::size_t number_of_keys = 5;
+
+        const auto automaton = suse::parse_regex("a(b|c)*d");
+        suse::work_stealing_pool pool{4};
+        suse::partitioned_runner<long, double> runner{automaton, 6, 8, std::numeric_limits<std::size_t>::max(), suse::query_strategy::suse, pool, {}, 3};
+
+        for (std::size_t idx = 0; idx < input.size(); ++idx)
+            runner.process_event({input[idx], 0, idx, idx % number_of_keys});
+        runner.flush();
+
+        REQUIRE(runner.number_of_partitions() == number_of_keys);
+        CHECK(runner.keys() == std::vector<std::size_t>{0, 1, 2, 3, 4});
+
+        for (std::size_t key = 0; key < number_of_keys; ++key) {
+            CAPTURE(key);
+
+            suse::summary_selector_count<long> selector{automaton, 6, 8};
+            const suse::eviction_strategies::suse strategy{selector, suse::generate_uniform_probabilities<double>(automaton)};
+
+            std::size_t processed = 0;
+            for (std::size_t idx = key; idx < input.size(); idx += number_of_keys, ++processed)
+                selector.process_event({input[idx], 0, idx, key}, strategy);
+
+            CHECK(runner.statistics(key).processed_events == processed);
+            CHECK(runner.selector(key).number_of_detected_complete_matches() == selector.number_of_detected_complete_matches());
+            CHECK(runner.selector(key).number_of_contained_complete_matches() == selector.number_of_contained_complete_matches());
+            CHECK(std::ranges::equal(runner.selector(key).cached_events(), selector.cached_events()));
+        }
+    }
+}
@@ -0,0 +1,131 @@
+/*
+	Never include directly!
+	This is included by partitioned_runner.hpp and only exists to split
+	interface and implementation despite the template.
+*/
+
+#include "probabilities.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace suse {
+
+template <typename counter_type, typename factor_type>
+partitioned_runner<counter_type, factor_type>::partitioned_runner(const nfa &automaton, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live, query_strategy strategy, work_stealing_pool &pool, std::unordered_map<char, factor_type> probabilities, std::size_t batch_size)
+    : summary_size_{summary_size},
+      time_window_size_{time_window_size},
+      time_to_live_{time_to_live},
+      strategy_{strategy},
+      pool_{pool},
+      batch_size_{std::max<std::size_t>(batch_size, 1)} {
+    if (strategy_ == query_strategy::suse) {
+        if (probabilities.empty())
+            probabilities = generate_uniform_probabilities<factor_type>(automaton);
+        auto tables = strategy_type::compute_expected_changes(automaton, time_window_size_, probabilities);
+        query_ = std::make_shared<const compiled_query<>>(automaton, compute_edges_per_character(automaton), time_window_size_, std::move(tables));
+    } else
+        query_ = std::make_shared<const compiled_query<>>(automaton);
+}
+
+template <typename counter_type, typename factor_type>
+void partitioned_runner<counter_type, factor_type>::process_event(const event &new_event) {
+    auto &p = partition_for(new_event.key);
+    p.buffer.push_back(new_event);
+
+    if (p.buffer.size() >= batch_size_)
+        hand_over(p);
+}
+
+template <typename counter_type, typename factor_type>
+void partitioned_runner<counter_type, factor_type>::flush() {
+    for (auto &[_, p] : partitions_) {
+        if (!p->buffer.empty())
+            hand_over(*p);
+    }
+
+    pool_.wait_idle();
+}
+
+template <typename counter_type, typename factor_type>
+std::vector<std::size_t> partitioned_runner<counter_type, factor_type>::keys() const {
+    std::vector<std::size_t> result;
+    for (const auto &[key, _] : partitions_)
+        result.push_back(key);
+
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+template <typename counter_type, typename factor_type>
+auto partitioned_runner<counter_type, factor_type>::partition_for(std::size_t key) -> partition & {
+    if (auto it = partitions_.find(key); it != partitions_.end())
+        return *it->second;
+
+    auto new_partition = std::make_unique<partition>();
+    new_partition->selector = std::make_unique<selector_type>(query_, summary_size_, time_window_size_, time_to_live_);
+    if (strategy_ == query_strategy::suse)
+        new_partition->strategy.emplace(*new_partition->selector);
+    new_partition->buffer.reserve(batch_size_);
+
+    return *partitions_.emplace(key, std::move(new_partition)).first->second;
+}
+
+template <typename counter_type, typename factor_type>
+void partitioned_runner<counter_type, factor_type>::hand_over(partition &p) {
+    bool needs_scheduling = false;
+    {
+        std::lock_guard lock{p.mutex};
+        if (p.handed_over.empty())
+            std::swap(p.handed_over, p.buffer);
+        else
+            p.handed_over.insert(p.handed_over.end(), p.buffer.begin(), p.buffer.end());
+
+        needs_scheduling = !std::exchange(p.scheduled, true);
+    }
+    p.buffer.clear();
+
+    if (needs_scheduling)
+        pool_.submit([this, &p] { drain(p); });
+}
+
+template <typename counter_type, typename factor_type>
+void partitioned_runner<counter_type, factor_type>::drain(partition &p) {
+    std::vector<event> batch;
+    while (true) {
+        {
+            std::lock_guard lock{p.mutex};
+            batch.clear();
+            std::swap(batch, p.handed_over);
+            if (batch.empty()) {
+                p.scheduled = false;
+                return;
+            }
+        }
+
+        // the pool reports the exception, and the next hand_over must schedule the partition again
+        try {
+            for (const auto &e : batch) {
+                switch (strategy_) {
+                case query_strategy::suse:
+                    p.selector->process_event(e, *p.strategy);
+                    break;
+                case query_strategy::fifo:
+                    p.selector->process_event(e, eviction_strategies::fifo);
+                    break;
+                case query_strategy::random:
+                    p.selector->process_event(e, eviction_strategies::random);
+                    break;
+                }
+            }
+        } catch (...) {
+            std::lock_guard lock{p.mutex};
+            p.scheduled = false;
+            throw;
+        }
+
+        p.statistics.processed_events += batch.size();
+        ++p.statistics.processed_batches;
+    }
+}
+} // namespace suse
@@ -0,0 +1,173 @@
+#include "eviction_strategies.hpp"
+#include "partitioned_runner.hpp"
+#include "probabilities.hpp"
+#include "regex.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <boost/multiprecision/cpp_bin_float.hpp>
+#include <boost/multiprecision/cpp_int.hpp>
+
+#include <cxxopts.hpp>
+
+#include <fmt/color.h>
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using nanoseconds = std::chrono::nanoseconds;
+using counter_type = boost::multiprecision::uint128_t;
+using factor_type = boost::multiprecision::cpp_bin_float_50;
+using runner_type = suse::partitioned_runner<counter_type, factor_type>;
+
+template <>
+struct fmt::formatter<counter_type> : fmt::ostream_formatter {}; // enables fmt::print to print values of boost::multiprecision::uint128_t
+
+namespace {
+// Maps the partition keys of the input, e.g. tickers or stations, to the dense ids used by the events
+class key_dictionary {
+  public:
+    std::size_t id_of(const std::string &name) {
+        const auto [it, inserted] = ids_.emplace(name, names_.size());
+        if (inserted)
+            names_.push_back(name);
+        return it->second;
+    }
+
+    const std::string &name_of(std::size_t id) const { return names_[id]; }
+
+  private:
+    std::unordered_map<std::string, std::size_t> ids_;
+    std::vector<std::string> names_;
+};
+
+// Reads "<key> <type> <value> <timestamp>"
+bool read_keyed_event(std::istream &in, suse::event &e, key_dictionary &keys) {
+    std::string key;
+    if (!(in >> key >> e))
+        return false;
+
+    e.key = keys.id_of(key);
+    return true;
+}
+
+struct totals {
+    counter_type final_matches{0}, final_partial_matches{0};
+    counter_type detected_matches{0}, detected_partial_matches{0};
+};
+
+totals sum_over_partitions(const runner_type &runner) {
+    totals result;
+    for (auto key : runner.keys()) {
+        const auto &selector = runner.selector(key);
+        result.final_matches += selector.number_of_contained_complete_matches();
+        result.final_partial_matches += selector.number_of_contained_partial_matches();
+        result.detected_matches += selector.number_of_detected_complete_matches();
+        result.detected_partial_matches += selector.number_of_detected_partial_matches();
+    }
+    return result;
+}
+
+void generate_report(const std::filesystem::path &path, const runner_type &runner, const key_dictionary &keys, const suse::work_stealing_pool &pool, nanoseconds init_time, nanoseconds runtime, std::size_t processed_events) {
+    const auto total = sum_over_partitions(runner);
+
+    std::ofstream out{path};
+    fmt::print(out, "{{\n");
+    fmt::print(out, "\t\"initialization_time_ns\": {},\n", init_time.count());
+    fmt::print(out, "\t\"runtime_ns\": {},\n", runtime.count());
+    fmt::print(out, "\t\"threads\": {},\n", pool.number_of_threads());
+    fmt::print(out, "\t\"steals\": {},\n", pool.number_of_steals());
+    fmt::print(out, "\t\"processed_events\": {},\n", processed_events);
+    fmt::print(out, "\t\"final_matches\": {},\n", total.final_matches);
+    fmt::print(out, "\t\"final_partial_matches\": {},\n", total.final_partial_matches);
+    fmt::print(out, "\t\"detected_matches\": {},\n", total.detected_matches);
+    fmt::print(out, "\t\"detected_partial_matches\": {},\n", total.detected_partial_matches);
+    fmt::print(out, "\t\"partitions\": [\n");
+
+    const auto partition_keys = runner.keys();
+    for (std::size_t idx = 0; idx < partition_keys.size(); ++idx) {
+        const auto &selector = runner.selector(partition_keys[idx]);
+        const auto &statistics = runner.statistics(partition_keys[idx]);
+
+        fmt::print(out, "\t\t{{\n");
+        fmt::print(out, "\t\t\t\"key\": \"{}\",\n", keys.name_of(partition_keys[idx]));
+        fmt::print(out, "\t\t\t\"processed_events\": {},\n", statistics.processed_events);
+        fmt::print(out, "\t\t\t\"processed_batches\": {},\n", statistics.processed_batches);
+        fmt::print(out, "\t\t\t\"final_matches\": {},\n", selector.number_of_contained_complete_matches());
+        fmt::print(out, "\t\t\t\"final_partial_matches\": {},\n", selector.number_of_contained_partial_matches());
+        fmt::print(out, "\t\t\t\"detected_matches\": {},\n", selector.number_of_detected_complete_matches());
+        fmt::print(out, "\t\t\t\"detected_partial_matches\": {}\n", selector.number_of_detected_partial_matches());
+        fmt::print(out, "\t\t}}{}\n", idx + 1 < partition_keys.size() ? "," : "");
+    }
+
+    fmt::print(out, "\t]\n");
+    fmt::print(out, "}}\n");
+}
+} // namespace
+
+int main(int argc, char *argv[]) try {
+    cxxopts::Options options("partitioned_summary_selector", "Evaluates a query per partition key of an event stream with lines \"<key> <type> <value> <timestamp>\"");
+    options.add_options()("query,q", "Regex/Query to evaluate", cxxopts::value<std::string>())("strategy", "Eviction strategy. Must be one of suse, fifo or random. Default is suse", cxxopts::value<std::string>()->default_value("suse"))("probabilities-file", "For SuSe eviction strategy: file containing the probabilities for each character", cxxopts::value<std::string>())("summary-size,s", "Size of the summary cache of each partition", cxxopts::value<std::size_t>())("time-window-size,t", "Size of one time window", cxxopts::value<std::size_t>())("time-to-live", "The maximum amount of time an event stays in the cache", cxxopts::value<std::size_t>()->default_value(std::to_string(std::numeric_limits<std::size_t>::max())))("threads,j", "Number of worker threads. Default is the number of cores", cxxopts::value<std::size_t>()->default_value(std::to_string(std::thread::hardware_concurrency())))("batch-size", "Number of events of one partition processed as one task", cxxopts::value<std::size_t>()->default_value("256"))("report,r", "File to write results to", cxxopts::value<std::string>())("help,h", "Display this help meassage");
+
+    options.parse_positional("query");
+    options.positional_help("query");
+
+    const auto parsed_args = options.parse(argc, argv);
+
+    if (parsed_args.count("help") > 0 || argc < 2) {
+        fmt::print("{}", options.help());
+        return 0;
+    }
+
+    for (auto required : {"query", "summary-size", "time-window-size"}) {
+        if (parsed_args.count(required) == 0) {
+            fmt::print(stderr, "{} is a required argument\n", required);
+            return 1;
+        }
+    }
+
+    const auto strategy = suse::parse_query_strategy(parsed_args["strategy"].template as<std::string>());
+    if (!strategy) {
+        fmt::print(stderr, "{}", fmt::styled("Invalid strategy, aborting...\n", fmt::fg(fmt::color::red)));
+        return 1;
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+
+    const auto automaton = suse::parse_regex(parsed_args["query"].template as<std::string>());
+    const auto probabilities = parsed_args.count("probabilities-file") > 0 ? suse::load_probabilities<factor_type>(parsed_args["probabilities-file"].template as<std::string>()) : std::unordered_map<char, factor_type>{};
+
+    suse::work_stealing_pool pool{parsed_args["threads"].template as<std::size_t>()};
+    runner_type runner{automaton, parsed_args["summary-size"].template as<std::size_t>(), parsed_args["time-window-size"].template as<std::size_t>(), parsed_args["time-to-live"].template as<std::size_t>(), *strategy, pool, probabilities, parsed_args["batch-size"].template as<std::size_t>()};
+
+    std::ios::sync_with_stdio(false);
+
+    const auto processing_start_time = std::chrono::steady_clock::now();
+    key_dictionary keys;
+    std::size_t processed_events = 0;
+    for (suse::event next_event; read_keyed_event(std::cin, next_event, keys); ++processed_events)
+        runner.process_event(next_event);
+    runner.flush();
+    const auto processing_end_time = std::chrono::steady_clock::now();
+
+    const auto total = sum_over_partitions(runner);
+    fmt::print("{} partitions on {} threads, Partial Matches: {}, Complete Matches: {}\n", runner.number_of_partitions(), pool.number_of_threads(), total.final_partial_matches, total.final_matches);
+
+    if (parsed_args.count("report") > 0)
+        generate_report(parsed_args["report"].template as<std::string>(), runner, keys, pool, processing_start_time - start_time, processing_end_time - processing_start_time, processed_events);
+
+    return 0;
+} catch (const cxxopts::exceptions::exception &e) {
+    fmt::print(stderr, "Error parsing arguments: {}\n", e.what());
+    return 1;
+} catch (const suse::regex_parse_error &e) {
+    fmt::print(stderr, "Invalid query at position {}: {}\n", e.location, e.what());
+    return 1;
+}
@@ -0,0 +1,44 @@
+#ifndef SUSE_PROBABILITIES_HPP
+#define SUSE_PROBABILITIES_HPP
+
+#include "nfa.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+
+namespace suse {
+// Reads whitespace separated pairs of symbol and probability, as used by the suse eviction strategy
+template <typename factor_type>
+std::unordered_map<char, factor_type> load_probabilities(const std::filesystem::path &path) {
+    std::ifstream in{path};
+    std::unordered_map<char, factor_type> probabilities;
+
+    char symbol;
+    factor_type probability;
+    while (in >> symbol >> probability)
+        probabilities[symbol] = probability;
+
+    probabilities[nfa::wildcard_symbol] = 1;
+    return probabilities;
+}
+
+// Assigns the same probability to every symbol occurring in the automaton
+template <typename factor_type>
+std::unordered_map<char, factor_type> generate_uniform_probabilities(const nfa &automaton) {
+    std::unordered_map<char, factor_type> probabilities;
+    for (const auto &state : automaton.states())
+        for (const auto &[symbol, _] : state.transitions)
+            if (symbol != nfa::wildcard_symbol)
+                probabilities[symbol] = {};
+
+    const auto uniform_fraction = factor_type{1} / probabilities.size();
+    for (auto &[_, prob] : probabilities)
+        prob = uniform_fraction;
+
+    probabilities[nfa::wildcard_symbol] = 1;
+    return probabilities;
+}
+} // namespace suse
+
+#endif
@@ -0,0 +1,272 @@
+#include "query_artifact.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SUSE_HAS_MMAP 1
+#endif
+
+namespace suse {
+namespace {
+constexpr std::array<char, 8> magic{'S', 'U', 'S', 'E', 'Q', 'R', 'Y', '\0'};
+constexpr std::uint32_t byte_order_mark = 0x01020304;
+constexpr std::size_t section_alignment = 64;
+
+struct stored_range {
+    std::uint64_t start, size;
+};
+
+struct stored_edge {
+    std::uint64_t from, to;
+};
+} // namespace
+
+struct query_artifact::header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint64_t file_size;
+
+    std::uint64_t number_of_states, initial_state;
+    std::uint64_t regex_offset, regex_size;
+    std::uint64_t final_offset; // one byte per state
+    std::uint64_t ranges_offset;
+    std::uint64_t edges_offset, number_of_edges;
+
+    std::uint64_t tables_type_name_offset, tables_type_name_size;
+    std::uint64_t tables_offset, tables_size, tables_factor_size, tables_time_window_size;
+};
+
+query_artifact::query_artifact(const std::filesystem::path &path) {
+#ifdef SUSE_HAS_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw query_artifact_error(fmt::format("Cannot open query artifact {}", path.string()));
+
+    struct stat info {};
+    if (::fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        throw query_artifact_error(fmt::format("Cannot read query artifact {}", path.string()));
+    }
+
+    void *mapped = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+        throw query_artifact_error(fmt::format("Cannot map query artifact {}", path.string()));
+
+    data_ = static_cast<const std::byte *>(mapped);
+    size_ = static_cast<std::size_t>(info.st_size);
+#else
+    std::ifstream in{path, std::ios::binary};
+    if (!in)
+        throw query_artifact_error(fmt::format("Cannot open query artifact {}", path.string()));
+
+    fallback_buffer_.resize(std::filesystem::file_size(path));
+    in.read(reinterpret_cast<char *>(fallback_buffer_.data()), static_cast<std::streamsize>(fallback_buffer_.size()));
+    data_ = fallback_buffer_.data();
+    size_ = fallback_buffer_.size();
+#endif
+
+    try {
+        if (size_ < sizeof(header))
+            throw query_artifact_error("Query artifact is truncated");
+
+        const auto &h = get_header();
+        if (h.magic != magic)
+            throw query_artifact_error("Not a query artifact");
+        if (h.byte_order != byte_order_mark)
+            throw query_artifact_error("Query artifact was written on a machine with different byte order");
+        if (h.version != version)
+            throw query_artifact_error(fmt::format("Query artifact has version {}, expected {}", h.version, version));
+        if (h.file_size != size_)
+            throw query_artifact_error("Query artifact is truncated");
+        if (h.number_of_states == 0 || h.initial_state >= h.number_of_states)
+            throw query_artifact_error("Query artifact contains an invalid automaton");
+
+        // validates bounds of all sections
+        section<char>(h.regex_offset, h.regex_size);
+        section<std::uint8_t>(h.final_offset, h.number_of_states);
+        const auto ranges = section<stored_range>(h.ranges_offset, 256);
+        const auto stored_edges = section<stored_edge>(h.edges_offset, h.number_of_edges);
+        section<char>(h.tables_type_name_offset, h.tables_type_name_size);
+        section<std::byte>(h.tables_offset, h.tables_size);
+
+        const auto valid_range = [&](const stored_range &r) { return r.start <= h.number_of_edges && r.size <= h.number_of_edges - r.start; };
+        const auto valid_edge = [&](const stored_edge &e) { return e.from < h.number_of_states && e.to < h.number_of_states; };
+        if (!std::all_of(ranges.begin(), ranges.end(), valid_range) || !std::all_of(stored_edges.begin(), stored_edges.end(), valid_edge))
+            throw query_artifact_error("Query artifact contains an invalid automaton");
+    } catch (...) {
+        release();
+        throw;
+    }
+}
+
+query_artifact::~query_artifact() {
+    release();
+}
+
+query_artifact::query_artifact(query_artifact &&other) noexcept : data_{std::exchange(other.data_, nullptr)},
+                                                                  size_{std::exchange(other.size_, 0)},
+                                                                  fallback_buffer_{std::move(other.fallback_buffer_)} {}
+
+query_artifact &query_artifact::operator=(query_artifact &&other) noexcept {
+    if (this != &other) {
+        release();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        fallback_buffer_ = std::move(other.fallback_buffer_);
+    }
+    return *this;
+}
+
+void query_artifact::release() {
+#ifdef SUSE_HAS_MMAP
+    if (data_)
+        ::munmap(const_cast<std::byte *>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    fallback_buffer_.clear();
+}
+
+const query_artifact::header &query_artifact::get_header() const {
+    return *reinterpret_cast<const header *>(data_);
+}
+
+template <typename T>
+std::span<const T> query_artifact::section(std::uint64_t offset, std::uint64_t count) const {
+    if (offset > size_ || count > (size_ - offset) / sizeof(T) || reinterpret_cast<std::uintptr_t>(data_ + offset) % alignof(T) != 0)
+        throw query_artifact_error("Query artifact contains an invalid section");
+
+    return {reinterpret_cast<const T *>(data_ + offset), static_cast<std::size_t>(count)};
+}
+
+std::string_view query_artifact::regex() const {
+    const auto &h = get_header();
+    const auto chars = section<char>(h.regex_offset, h.regex_size);
+    return {chars.data(), chars.size()};
+}
+
+nfa query_artifact::automaton() const {
+    const auto &h = get_header();
+    const auto is_final = section<std::uint8_t>(h.final_offset, h.number_of_states);
+    const auto ranges = section<stored_range>(h.ranges_offset, 256);
+    const auto stored_edges = section<stored_edge>(h.edges_offset, h.number_of_edges);
+
+    std::vector<state> states;
+    for (auto final : is_final)
+        states.push_back(state{{}, final != 0});
+
+    for (std::size_t symbol = 0; symbol < ranges.size(); ++symbol) {
+        for (const auto &e : stored_edges.subspan(ranges[symbol].start, ranges[symbol].size))
+            states[e.from].transitions[static_cast<char>(symbol)].insert(e.to);
+    }
+
+    return nfa::from_states(std::move(states), h.initial_state);
+}
+
+edgelist query_artifact::edges() const {
+    const auto &h = get_header();
+    const auto ranges = section<stored_range>(h.ranges_offset, 256);
+    const auto stored_edges = section<stored_edge>(h.edges_offset, h.number_of_edges);
+
+    edgelist result;
+    for (std::size_t symbol = 0; symbol < ranges.size(); ++symbol)
+        result.character_to_range_[symbol] = {ranges[symbol].start, ranges[symbol].size};
+
+    result.edges_.reserve(stored_edges.size());
+    for (const auto &e : stored_edges)
+        result.edges_.push_back({e.from, e.to});
+
+    return result;
+}
+
+bool query_artifact::has_strategy_tables() const {
+    return get_header().tables_size > 0;
+}
+
+std::size_t query_artifact::strategy_tables_time_window_size() const {
+    return get_header().tables_time_window_size;
+}
+
+std::span<const std::byte> query_artifact::strategy_table_bytes(std::string_view type_name, std::size_t factor_size, std::size_t factor_alignment) const {
+    const auto &h = get_header();
+    if (h.tables_size == 0)
+        throw query_artifact_error("Query artifact does not contain strategy tables");
+
+    const auto stored_type_name = section<char>(h.tables_type_name_offset, h.tables_type_name_size);
+    if (h.tables_factor_size != factor_size || std::string_view{stored_type_name.data(), stored_type_name.size()} != type_name)
+        throw query_artifact_error("Strategy tables of query artifact were computed for a different factor type");
+
+    const auto bytes = section<std::byte>(h.tables_offset, h.tables_size);
+    if (reinterpret_cast<std::uintptr_t>(bytes.data()) % factor_alignment != 0 || bytes.size() % factor_size != 0)
+        throw query_artifact_error("Query artifact contains an invalid section");
+
+    return bytes;
+}
+
+void query_artifact::write(std::ostream &out, const nfa &automaton, const edgelist &edges, std::string_view regex) {
+    write(out, automaton, edges, regex, table_description{});
+}
+
+void query_artifact::write(std::ostream &out, const nfa &automaton, const edgelist &edges, std::string_view regex, const table_description &tables) {
+    std::vector<std::byte> buffer(sizeof(header));
+
+    const auto append = [&](const void *data, std::size_t size) -> std::uint64_t {
+        buffer.resize((buffer.size() + section_alignment - 1) / section_alignment * section_alignment);
+        const auto offset = buffer.size();
+        buffer.resize(offset + size);
+        if (size > 0)
+            std::memcpy(buffer.data() + offset, data, size);
+        return offset;
+    };
+
+    header h{};
+    h.magic = magic;
+    h.version = version;
+    h.byte_order = byte_order_mark;
+    h.number_of_states = automaton.number_of_states();
+    h.initial_state = automaton.initial_state_id();
+
+    h.regex_size = regex.size();
+    h.regex_offset = append(regex.data(), regex.size());
+
+    std::vector<std::uint8_t> is_final;
+    for (const auto &state : automaton.states())
+        is_final.push_back(state.is_final);
+    h.final_offset = append(is_final.data(), is_final.size());
+
+    std::array<stored_range, 256> ranges{};
+    for (std::size_t symbol = 0; symbol < ranges.size(); ++symbol)
+        ranges[symbol] = {edges.character_to_range_[symbol].start, edges.character_to_range_[symbol].size};
+    h.ranges_offset = append(ranges.data(), sizeof(ranges));
+
+    std::vector<stored_edge> stored_edges;
+    for (const auto &e : edges.edges_)
+        stored_edges.push_back({e.from, e.to});
+    h.number_of_edges = stored_edges.size();
+    h.edges_offset = append(stored_edges.data(), stored_edges.size() * sizeof(stored_edge));
+
+    h.tables_type_name_size = tables.type_name.size();
+    h.tables_type_name_offset = append(tables.type_name.data(), tables.type_name.size());
+    h.tables_factor_size = tables.factor_size;
+    h.tables_time_window_size = tables.time_window_size;
+    h.tables_size = tables.bytes.size();
+    h.tables_offset = append(tables.bytes.data(), tables.bytes.size());
+
+    h.file_size = buffer.size();
+    std::memcpy(buffer.data(), &h, sizeof(h));
+
+    out.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+}
+} // namespace suse
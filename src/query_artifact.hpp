@@ -0,0 +1,92 @@
+#ifndef SUSE_QUERY_ARTIFACT_HPP
+#define SUSE_QUERY_ARTIFACT_HPP
+
+#include "edgelist.hpp"
+#include "nfa.hpp"
+
+#include <filesystem>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace suse {
+struct query_artifact_error : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// Strategy tables are used in place from the mapped file. That is fine for types that do not own any
+// resources, which includes the fixed precision boost floats used as factors by the CLI.
+template <typename T>
+concept mappable_factor = std::is_trivially_destructible_v<T> && std::is_standard_layout_v<T>;
+
+// Compiled query as written by `regex_compiler --emit-artifact`: the automaton, its edgelist and, optionally,
+// the tables of the suse eviction strategy for one time window size. The file is mapped, not read, so
+// loading does not depend on the size of the tables.
+class query_artifact {
+  public:
+    static constexpr std::uint32_t version = 1;
+
+    explicit query_artifact(const std::filesystem::path &path);
+    ~query_artifact();
+
+    query_artifact(query_artifact &&other) noexcept;
+    query_artifact &operator=(query_artifact &&other) noexcept;
+
+    query_artifact(const query_artifact &) = delete;
+    query_artifact &operator=(const query_artifact &) = delete;
+
+    std::string_view regex() const;
+    nfa automaton() const;
+    edgelist edges() const;
+
+    bool has_strategy_tables() const;
+    std::size_t strategy_tables_time_window_size() const;
+
+    template <mappable_factor factor_type>
+    std::span<const factor_type> strategy_tables() const {
+        const auto bytes = strategy_table_bytes(typeid(factor_type).name(), sizeof(factor_type), alignof(factor_type));
+        return {reinterpret_cast<const factor_type *>(bytes.data()), bytes.size() / sizeof(factor_type)};
+    }
+
+    static void write(std::ostream &out, const nfa &automaton, const edgelist &edges, std::string_view regex);
+
+    template <mappable_factor factor_type>
+    static void write(std::ostream &out, const nfa &automaton, const edgelist &edges, std::string_view regex, std::size_t time_window_size, std::span<const factor_type> strategy_tables) {
+        const std::span<const std::byte> bytes{reinterpret_cast<const std::byte *>(strategy_tables.data()), strategy_tables.size_bytes()};
+        write(out, automaton, edges, regex, {typeid(factor_type).name(), sizeof(factor_type), time_window_size, bytes});
+    }
+
+  private:
+    struct table_description {
+        std::string_view type_name;
+        std::size_t factor_size, time_window_size;
+        std::span<const std::byte> bytes;
+    };
+
+    const std::byte *data_ = nullptr;
+    std::size_t size_ = 0;
+    std::vector<std::byte> fallback_buffer_; // used where files cannot be mapped
+
+    struct header;
+    const header &get_header() const;
+
+    template <typename T>
+    std::span<const T> section(std::uint64_t offset, std::uint64_t count) const;
+
+    std::span<const std::byte> strategy_table_bytes(std::string_view type_name, std::size_t factor_size, std::size_t factor_alignment) const;
+
+    void release();
+
+    static void write(std::ostream &out, const nfa &automaton, const edgelist &edges, std::string_view regex, const table_description &tables);
+};
+} // namespace suse
+
+#endif
@@ -0,0 +1,117 @@
+#include "query_artifact.hpp"
+
+#include "eviction_strategies.hpp"
+#include "regex.hpp"
+#include "summary_selector_count.hpp"
+
+#include <doctest/doctest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+struct temporary_file {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "suse_query_artifact_test.bin";
+    ~temporary_file() { std::filesystem::remove(path); }
+};
+
+void check_same_edges(const suse::edgelist &lhs, const suse::edgelist &rhs) {
+    for (int symbol = 0; symbol < 128; ++symbol) {
+        CAPTURE(symbol);
+        const auto lhs_edges = lhs.edges_for(static_cast<char>(symbol));
+        const auto rhs_edges = rhs.edges_for(static_cast<char>(symbol));
+        REQUIRE(std::equal(lhs_edges.begin(), lhs_edges.end(), rhs_edges.begin(), rhs_edges.end()));
+    }
+}
+} // namespace
+
+TEST_SUITE("suse::query_artifact") {
+    TEST_CASE("round trip") {
+        const temporary_file file;
+        const std::string_view regex = "a*b(c|d)+e";
+        const auto automaton = suse::parse_regex(regex);
+        const auto edges = suse::compute_edges_per_character(automaton);
+
+        {
+            std::ofstream out{file.path, std::ios::binary};
+            suse::query_artifact::write(out, automaton, edges, regex);
+        }
+
+        const suse::query_artifact artifact{file.path};
+        CHECK(artifact.regex() == regex);
+        CHECK(!artifact.has_strategy_tables());
+        CHECK_THROWS_AS(artifact.strategy_tables<double>(), suse::query_artifact_error);
+
+        const auto loaded = artifact.automaton();
+        CHECK(loaded.initial_state_id() == automaton.initial_state_id());
+        CHECK(std::ranges::equal(loaded.states(), automaton.states()));
+        check_same_edges(artifact.edges(), edges);
+    }
+
+    TEST_CASE("strategy tables") {
+        const temporary_file file;
+        const std::string_view regex = "a*b(c|d)+e";
+        const std::string_view input = "aabcdacbadcbacdbcacbdaedabaaebdedaaddccdeaceabdebdeadaaabeadabdadbcadcdabeadeadcbedeaabbcbcbcacbccbabcdeacbdeabdad";
+        const std::unordered_map<char, double> probabilities{{'a', 0.3}, {'b', 0.1}, {'c', 0.2}, {'d', 0.2}, {'e', 0.2}, {suse::nfa::wildcard_symbol, 1}};
+        const auto automaton = suse::parse_regex(regex);
+
+        using strategy_type = suse::eviction_strategies::suse<int, double>;
+        {
+            std::ofstream out{file.path, std::ios::binary};
+            const auto tables = strategy_type::compute_expected_changes(automaton, 17, probabilities);
+            suse::query_artifact::write<double>(out, automaton, suse::compute_edges_per_character(automaton), regex, 17, tables);
+        }
+
+        const suse::query_artifact artifact{file.path};
+        REQUIRE(artifact.has_strategy_tables());
+        CHECK(artifact.strategy_tables_time_window_size() == 17);
+        CHECK_THROWS_AS(artifact.strategy_tables<float>(), suse::query_artifact_error);
+
+        suse::summary_selector_count<int> computing_selector{regex, 20, 17};
+        suse::summary_selector_count<int> loading_selector{artifact.automaton(), artifact.edges(), 20, 17};
+        const strategy_type computing_strategy{computing_selector, probabilities};
+        const strategy_type loading_strategy{loading_selector, artifact.strategy_tables<double>()};
+
+        for (std::size_t idx = 0; auto c : input) {
+            computing_selector.process_event({c, 0, idx}, computing_strategy);
+            loading_selector.process_event({c, 0, idx++}, loading_strategy);
+        }
+
+        CHECK(std::ranges::equal(loading_selector.cached_events(), computing_selector.cached_events()));
+        CHECK(loading_selector.number_of_contained_complete_matches() == computing_selector.number_of_contained_complete_matches());
+
+        suse::summary_selector_count<int> other_window_selector{regex, 20, 18};
+        CHECK_THROWS_AS((strategy_type{other_window_selector, artifact.strategy_tables<double>()}), std::invalid_argument);
+    }
+
+    TEST_CASE("invalid files") {
+        const temporary_file file;
+        const auto automaton = suse::parse_regex("ab");
+
+        std::string valid;
+        {
+            std::ostringstream out;
+            suse::query_artifact::write(out, automaton, suse::compute_edges_per_character(automaton), "ab");
+            valid = out.str();
+        }
+
+        const auto check_rejected = [&](std::string_view contents) {
+            {
+                std::ofstream out{file.path, std::ios::binary};
+                out << contents;
+            }
+            CHECK_THROWS_AS(suse::query_artifact{file.path}, suse::query_artifact_error);
+        };
+
+        check_rejected(valid.substr(0, valid.size() / 2));
+        check_rejected("not an artifact, but long enough to contain a header of the expected size..................................................");
+
+        auto wrong_version = valid;
+        wrong_version[8] = 42;
+        check_rejected(wrong_version);
+
+        CHECK_THROWS_AS(suse::query_artifact{file.path.string() + ".missing"}, suse::query_artifact_error);
+    }
+}
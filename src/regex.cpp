@@ -5,7 +5,10 @@
 
 #include <algorithm>
 #include <initializer_list>
+#include <limits>
 #include <optional>
+#include <string>
+#include <vector>
 
 namespace {
 enum class token_type {
@@ -13,10 +16,12 @@ enum class token_type {
     optional_repetition,
     required_repetition,
     option,
+    counted_repetition,
     alternative,
     open_parenthesis,
     close_parenthesis,
     character,
+    character_class,
     end_of_input
 };
 
@@ -31,6 +36,8 @@ std::string_view to_string(token_type type) {
         return "required repetition('+')";
     case option:
         return "option('?')";
+    case counted_repetition:
+        return "counted repetition('{m,n}')";
     case alternative:
         return "alternative('|')";
     case open_parenthesis:
@@ -39,6 +46,8 @@ std::string_view to_string(token_type type) {
         return "close parenthesis(')')";
     case character:
         return "character";
+    case character_class:
+        return "character class('[...]')";
     case end_of_input:
         return "end of input";
     }
@@ -50,6 +59,10 @@ struct token {
     token_type type;
     char symbol;
     std::size_t position;
+
+    std::string symbols{};                  // for character classes, sorted and without duplicates
+    std::size_t min_count{};                // for counted repetitions
+    std::optional<std::size_t> max_count{}; // for counted repetitions, unbounded if empty
 };
 } // namespace
 
@@ -92,6 +105,9 @@ class lexer {
     token next_token_;
 
     token tokenize_next();
+    token tokenize_character_class(std::size_t start);
+    token tokenize_counted_repetition(std::size_t start);
+    std::size_t tokenize_count();
 };
 
 token lexer::consume() {
@@ -142,6 +158,10 @@ token lexer::tokenize_next() {
         return token{token_type::required_repetition, symbol, input_position_ - 1};
     case '?':
         return token{token_type::option, symbol, input_position_ - 1};
+    case '[':
+        return tokenize_character_class(input_position_ - 1);
+    case '{':
+        return tokenize_counted_repetition(input_position_ - 1);
     case '\\': {
         if (input_position_ >= input_.size())
             throw suse::regex_parse_error("Unescaped '\\' at end of input. To include a single backslash, double it up like this: '\\\\'", input_position_);
@@ -152,21 +172,246 @@ token lexer::tokenize_next() {
     }
 }
 
-suse::nfa parse_repetition(lexer &lex, suse::nfa to_repeat) {
+token lexer::tokenize_character_class(std::size_t start) {
+    const auto next_symbol = [&]() {
+        if (input_position_ >= input_.size())
+            throw suse::regex_parse_error("Unterminated character class, expected ']'", start);
+
+        const char symbol = input_[input_position_++];
+        if (symbol != '\\')
+            return symbol;
+
+        if (input_position_ >= input_.size())
+            throw suse::regex_parse_error("Unescaped '\\' at end of input. To include a single backslash, double it up like this: '\\\\'", input_position_);
+        return input_[input_position_++];
+    };
+
+    std::string symbols;
+    while (input_position_ >= input_.size() || input_[input_position_] != ']') {
+        const char from = next_symbol();
+        if (input_position_ + 1 < input_.size() && input_[input_position_] == '-' && input_[input_position_ + 1] != ']') {
+            ++input_position_;
+            const auto range_position = input_position_;
+            const char to = next_symbol();
+            if (to < from)
+                throw suse::regex_parse_error(fmt::format("Invalid range '{}-{}' in character class", from, to), range_position);
+
+            for (int symbol = from; symbol <= to; ++symbol)
+                symbols.push_back(static_cast<char>(symbol));
+        } else
+            symbols.push_back(from);
+    }
+    ++input_position_;
+
+    if (symbols.empty())
+        throw suse::regex_parse_error("Empty character class", start);
+
+    std::sort(symbols.begin(), symbols.end());
+    symbols.erase(std::unique(symbols.begin(), symbols.end()), symbols.end());
+    return token{token_type::character_class, '[', start, std::move(symbols)};
+}
+
+token lexer::tokenize_counted_repetition(std::size_t start) {
+    token result{token_type::counted_repetition, '{', start};
+
+    result.min_count = tokenize_count();
+    if (input_position_ < input_.size() && input_[input_position_] == ',') {
+        ++input_position_;
+        if (input_position_ < input_.size() && input_[input_position_] != '}')
+            result.max_count = tokenize_count();
+    } else
+        result.max_count = result.min_count;
+
+    if (input_position_ >= input_.size() || input_[input_position_] != '}')
+        throw suse::regex_parse_error("Expected '}' to close counted repetition", input_position_);
+    ++input_position_;
+
+    if (result.max_count && *result.max_count < result.min_count)
+        throw suse::regex_parse_error(fmt::format("Maximum repetition count {} is less than minimum {}", *result.max_count, result.min_count), start);
+
+    return result;
+}
+
+std::size_t lexer::tokenize_count() {
+    const auto start = input_position_;
+    std::size_t count = 0;
+    for (; input_position_ < input_.size() && input_[input_position_] >= '0' && input_[input_position_] <= '9'; ++input_position_) {
+        if (count > (std::numeric_limits<std::size_t>::max() - 9) / 10)
+            throw suse::regex_parse_error("Repetition count too large", start);
+        count = count * 10 + static_cast<std::size_t>(input_[input_position_] - '0');
+    }
+
+    if (input_position_ == start)
+        throw suse::regex_parse_error("Expected a repetition count", start);
+
+    return count;
+}
+
+// The parser is independent of how automatons are constructed. Builders provide the fragment type for
+// subexpressions and the operations to combine them.
+class thompson_builder {
+  public:
+    using fragment = suse::nfa;
+
+    fragment empty() const { return suse::nfa::singleton(suse::nfa::epsilon_symbol); }
+    fragment symbol(char symbol) const { return suse::nfa::singleton(symbol); }
+    fragment symbol_class(std::string_view symbols) const { return suse::nfa::symbol_class(symbols); }
+    fragment copy(const fragment &original) const { return original; }
+
+    fragment concatenation(fragment lhs, const fragment &rhs) const { return concatenate(std::move(lhs), rhs); }
+    fragment alternative(fragment lhs, const fragment &rhs) const { return union_automaton(std::move(lhs), rhs); }
+
+    fragment optional_repetition(fragment to_repeat) const { return kleene(std::move(to_repeat)); }
+    fragment required_repetition(fragment to_repeat) const { return concatenate(to_repeat, kleene(to_repeat)); }
+    fragment option(fragment to_repeat) const { return union_automaton(std::move(to_repeat), empty()); }
+
+    suse::nfa finish(fragment result) const { return result; }
+};
+
+// Builds the position (Glushkov) automaton: every symbol occurring in the regex is a state, which is entered
+// by reading that symbol. Fragments only track which positions can start and end them, transitions are
+// collected in a single follow list per position, so no automaton is copied and no epsilon transitions arise.
+class glushkov_builder {
+  public:
+    struct fragment {
+        bool nullable;
+        std::vector<std::size_t> first, last;
+        std::size_t begin, end; // positions are allocated in parsing order, so each fragment owns a contiguous range
+    };
+
+    fragment empty() const { return {true, {}, {}, symbols_.size(), symbols_.size()}; }
+
+    fragment symbol(char symbol) { return symbol_class(std::string_view{&symbol, 1}); }
+
+    fragment symbol_class(std::string_view symbols) {
+        const auto position = symbols_.size();
+        symbols_.emplace_back(symbols);
+        follow_.emplace_back();
+        return {false, {position}, {position}, position, position + 1};
+    }
+
+    // Duplicates the positions of a fragment. Must happen before the fragment is connected to anything outside
+    // of it, i.e. its follow lists still point into its own range only.
+    fragment copy(const fragment &original) {
+        const auto offset = symbols_.size() - original.begin;
+        for (auto position = original.begin; position < original.end; ++position) {
+            symbols_.push_back(symbols_[position]);
+            auto follow = follow_[position];
+            for (auto &next : follow)
+                next += offset;
+            follow_.push_back(std::move(follow));
+        }
+
+        fragment result{original.nullable, original.first, original.last, original.begin + offset, original.end + offset};
+        for (auto &position : result.first)
+            position += offset;
+        for (auto &position : result.last)
+            position += offset;
+        return result;
+    }
+
+    fragment concatenation(fragment lhs, fragment rhs) {
+        connect(lhs.last, rhs.first);
+
+        if (lhs.nullable)
+            lhs.first.insert(lhs.first.end(), rhs.first.begin(), rhs.first.end());
+        if (rhs.nullable)
+            rhs.last.insert(rhs.last.end(), lhs.last.begin(), lhs.last.end());
+
+        return {lhs.nullable && rhs.nullable, std::move(lhs.first), std::move(rhs.last), std::min(lhs.begin, rhs.begin), std::max(lhs.end, rhs.end)};
+    }
+
+    fragment alternative(fragment lhs, const fragment &rhs) const {
+        lhs.nullable |= rhs.nullable;
+        lhs.first.insert(lhs.first.end(), rhs.first.begin(), rhs.first.end());
+        lhs.last.insert(lhs.last.end(), rhs.last.begin(), rhs.last.end());
+        lhs.begin = std::min(lhs.begin, rhs.begin);
+        lhs.end = std::max(lhs.end, rhs.end);
+        return lhs;
+    }
+
+    fragment optional_repetition(fragment to_repeat) {
+        to_repeat = required_repetition(std::move(to_repeat));
+        to_repeat.nullable = true;
+        return to_repeat;
+    }
+
+    fragment required_repetition(fragment to_repeat) {
+        connect(to_repeat.last, to_repeat.first);
+        return to_repeat;
+    }
+
+    fragment option(fragment to_repeat) const {
+        to_repeat.nullable = true;
+        return to_repeat;
+    }
+
+    suse::nfa finish(const fragment &result) const {
+        return suse::nfa::position_automaton(symbols_, follow_, result.first, result.last, result.nullable);
+    }
+
+  private:
+    std::vector<std::string> symbols_;
+    std::vector<std::vector<std::size_t>> follow_;
+
+    void connect(const std::vector<std::size_t> &from, const std::vector<std::size_t> &to) {
+        for (auto position : from)
+            follow_[position].insert(follow_[position].end(), to.begin(), to.end());
+    }
+};
+
+// e{m,n} becomes e...e(e(e...)?)? with m leading copies, e{m,} becomes e...ee+. Nesting the optional copies
+// instead of chaining e?e? keeps every match reachable by exactly one run, which the counters rely on.
+template <typename builder_type>
+auto repeat(builder_type &builder, typename builder_type::fragment to_repeat, std::size_t min_count, std::optional<std::size_t> max_count) {
+    const auto instances_needed = max_count ? *max_count : std::max<std::size_t>(min_count, 1);
+    if (instances_needed == 0)
+        return builder.empty();
+
+    // all copies are taken before the original gets connected to any of them
+    std::vector<typename builder_type::fragment> instances;
+    instances.reserve(instances_needed);
+    for (std::size_t i = 1; i < instances_needed; ++i)
+        instances.push_back(builder.copy(to_repeat));
+    instances.insert(instances.begin(), std::move(to_repeat));
+
+    if (!max_count) {
+        auto &last = instances.back();
+        last = min_count == 0 ? builder.optional_repetition(std::move(last)) : builder.required_repetition(std::move(last));
+    } else if (*max_count > min_count) {
+        auto tail = builder.option(std::move(instances.back()));
+        for (auto i = *max_count - 1; i-- > min_count;)
+            tail = builder.option(builder.concatenation(std::move(instances[i]), std::move(tail)));
+        instances.erase(instances.begin() + static_cast<std::ptrdiff_t>(min_count), instances.end());
+        instances.push_back(std::move(tail));
+    }
+
+    auto result = std::move(instances.front());
+    for (std::size_t i = 1; i < instances.size(); ++i)
+        result = builder.concatenation(std::move(result), std::move(instances[i]));
+    return result;
+}
+
+template <typename builder_type>
+auto parse_repetition(lexer &lex, builder_type &builder, typename builder_type::fragment to_repeat) {
     using enum token_type;
 
-    while (auto rep = lex.consume_if({optional_repetition, required_repetition, option})) {
+    while (auto rep = lex.consume_if({optional_repetition, required_repetition, option, counted_repetition})) {
         switch (rep->type) {
         case optional_repetition: {
-            to_repeat = kleene(std::move(to_repeat));
+            to_repeat = builder.optional_repetition(std::move(to_repeat));
             break;
         }
         case required_repetition: {
-            to_repeat = concatenate(to_repeat, kleene(to_repeat));
+            to_repeat = builder.required_repetition(std::move(to_repeat));
             break;
         }
         case option: {
-            to_repeat = union_automaton(std::move(to_repeat), suse::nfa::singleton(suse::nfa::epsilon_symbol));
+            to_repeat = builder.option(std::move(to_repeat));
+            break;
+        }
+        case counted_repetition: {
+            to_repeat = repeat(builder, std::move(to_repeat), rep->min_count, rep->max_count);
             break;
         }
 
@@ -177,45 +422,70 @@ suse::nfa parse_repetition(lexer &lex, suse::nfa to_repeat) {
     return to_repeat;
 };
 
-suse::nfa parse_union(lexer &lex);
+template <typename builder_type>
+typename builder_type::fragment parse_union(lexer &lex, builder_type &builder);
 
-suse::nfa parse_concatenation(lexer &lex) {
+template <typename builder_type>
+typename builder_type::fragment parse_concatenation(lexer &lex, builder_type &builder) {
     using enum token_type;
 
-    auto result = suse::nfa::singleton(suse::nfa::epsilon_symbol);
-    while (auto token = lex.consume_if({open_parenthesis, wildcard, character})) {
+    auto result = builder.empty();
+    while (auto token = lex.consume_if({open_parenthesis, wildcard, character, character_class})) {
         if (token->type == open_parenthesis) {
-            auto inner = parse_union(lex);
+            auto inner = parse_union(lex, builder);
             lex.consume_and_check({token_type::close_parenthesis}, token->position);
-            result = concatenate(result, parse_repetition(lex, std::move(inner)));
+            result = builder.concatenation(std::move(result), parse_repetition(lex, builder, std::move(inner)));
+        } else if (token->type == character_class) {
+            auto inner = builder.symbol_class(token->symbols);
+            result = builder.concatenation(std::move(result), parse_repetition(lex, builder, std::move(inner)));
         } else {
             const auto symbol = token->type == wildcard ? suse::nfa::wildcard_symbol : token->symbol;
-            auto inner = suse::nfa::singleton(symbol);
-            result = concatenate(result, parse_repetition(lex, std::move(inner)));
+            auto inner = builder.symbol(symbol);
+            result = builder.concatenation(std::move(result), parse_repetition(lex, builder, std::move(inner)));
         }
     }
 
     return result;
 };
 
-suse::nfa parse_union(lexer &lex) {
-    auto lhs = parse_concatenation(lex);
+template <typename builder_type>
+typename builder_type::fragment parse_union(lexer &lex, builder_type &builder) {
+    auto lhs = parse_concatenation(lex, builder);
     while (lex.consume_if({token_type::alternative})) {
-        auto rhs = parse_concatenation(lex);
-        lhs = union_automaton(std::move(lhs), std::move(rhs));
+        auto rhs = parse_concatenation(lex, builder);
+        lhs = builder.alternative(std::move(lhs), std::move(rhs));
     }
 
     return lhs;
 };
+
+template <typename builder_type>
+suse::nfa parse_with(std::string_view input, builder_type builder) {
+    lexer lex{input};
+
+    auto result = parse_union(lex, builder);
+    lex.consume_and_check({token_type::end_of_input});
+
+    return builder.finish(std::move(result));
+}
 } // namespace
 
 using namespace suse;
 
-nfa suse::parse_regex(std::string_view input) {
-    lexer lex{input};
+std::optional<regex_construction> suse::parse_regex_construction(std::string_view name) {
+    if (name == "thompson")
+        return regex_construction::thompson;
+    if (name == "glushkov")
+        return regex_construction::glushkov;
 
-    auto result = parse_union(lex);
-    lex.consume_and_check({token_type::end_of_input});
+    return std::nullopt;
+}
+
+nfa suse::parse_regex(std::string_view input, const regex_options &options) {
+    auto result = options.construction == regex_construction::glushkov ? parse_with(input, glushkov_builder{}) : parse_with(input, thompson_builder{});
+
+    if (options.reduce)
+        result.reduce();
 
     return result;
 }
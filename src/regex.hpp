@@ -3,6 +3,7 @@
 
 #include "nfa.hpp"
 
+#include <optional>
 #include <stdexcept>
 #include <string_view>
 
@@ -14,7 +15,24 @@ struct regex_parse_error : std::runtime_error {
     std::size_t location;
 };
 
-nfa parse_regex(std::string_view input);
+// Both accept the same language and count the same runs, except for repetitions directly nested in repetitions,
+// e.g. ((b)+)+ or ((ab)*|c)+d: thompson can leave and reenter the inner one between two symbols, which counts
+// additional runs, while glushkov counts each sequence of positions once.
+enum class regex_construction {
+    thompson, // combines automatons per operator and eliminates epsilon transitions after every step
+    glushkov  // builds the epsilon-free position automaton directly, in a single pass
+};
+
+std::optional<regex_construction> parse_regex_construction(std::string_view name);
+
+struct regex_options {
+    // States with identical transitions are always merged, e.g. (a|a)b has a single run on ab. Reduction also
+    // merges bisimilar states, which keeps the language but not the number of runs, see nfa::reduce.
+    bool reduce = false;
+    regex_construction construction = regex_construction::thompson;
+};
+
+nfa parse_regex(std::string_view input, const regex_options &options = {});
 } // namespace suse
 
 #endif
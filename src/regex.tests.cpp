@@ -2,6 +2,33 @@
 
 #include <doctest/doctest.h>
 
+#include <string>
+#include <vector>
+
+namespace {
+std::size_t count_accepting_runs(const suse::nfa &automaton, std::string_view word) {
+    std::vector<std::size_t> runs(automaton.number_of_states());
+    runs[automaton.initial_state_id()] = 1;
+
+    for (char symbol : word) {
+        std::vector<std::size_t> next(runs.size());
+        for (std::size_t id = 0; id < runs.size(); ++id) {
+            for (const auto &[edge_symbol, targets] : automaton.states()[id].transitions) {
+                if (edge_symbol == symbol || edge_symbol == suse::nfa::wildcard_symbol)
+                    for (auto target : targets)
+                        next[target] += runs[id];
+            }
+        }
+        runs = std::move(next);
+    }
+
+    std::size_t accepting = 0;
+    for (std::size_t id = 0; id < runs.size(); ++id)
+        accepting += automaton.states()[id].is_final ? runs[id] : 0;
+    return accepting;
+}
+} // namespace
+
 TEST_SUITE("suse::regex") {
     TEST_CASE("empty") {
         const auto empty = suse::parse_regex("");
@@ -131,4 +158,162 @@ TEST_SUITE("suse::regex") {
 
         CHECK(!rep.check("ab"));
     }
+
+    TEST_CASE("character class") {
+        const auto single = suse::parse_regex("[a-cx\\]]", {.reduce = false});
+        CHECK(single.number_of_states() == 2);
+
+        for (std::string_view word : {"a", "b", "c", "x", "]"}) {
+            CAPTURE(word);
+            REQUIRE(single.check(word));
+        }
+        CHECK(!single.check("d"));
+        CHECK(!single.check("-"));
+        CHECK(!single.check("ab"));
+        CHECK(!single.check(""));
+
+        const auto repeated = suse::parse_regex("[ab]+c");
+        CHECK(repeated.check("abbac"));
+        CHECK(!repeated.check("c"));
+
+        CHECK_THROWS_AS(suse::parse_regex("[]"), suse::regex_parse_error);
+        CHECK_THROWS_AS(suse::parse_regex("[ab"), suse::regex_parse_error);
+        CHECK_THROWS_AS(suse::parse_regex("[c-a]"), suse::regex_parse_error);
+    }
+
+    TEST_CASE("counted repetition") {
+        const auto exact = suse::parse_regex("a{3}", {.reduce = false, .construction = suse::regex_construction::glushkov});
+        CHECK(exact.number_of_states() == 4);
+        CHECK(exact.check("aaa"));
+        CHECK(!exact.check("aa"));
+        CHECK(!exact.check("aaaa"));
+
+        const auto bounded = suse::parse_regex("b(a{1,3})c");
+        CHECK(!bounded.check("bc"));
+        CHECK(bounded.check("bac"));
+        CHECK(bounded.check("baaac"));
+        CHECK(!bounded.check("baaaac"));
+
+        const auto unbounded = suse::parse_regex("a{2,}");
+        CHECK(!unbounded.check("a"));
+        CHECK(unbounded.check("aa"));
+        CHECK(unbounded.check("aaaaaa"));
+
+        const auto none = suse::parse_regex("ba{0}c");
+        CHECK(none.check("bc"));
+        CHECK(!none.check("bac"));
+
+        CHECK_THROWS_AS(suse::parse_regex("a{"), suse::regex_parse_error);
+        CHECK_THROWS_AS(suse::parse_regex("a{,2}"), suse::regex_parse_error);
+        CHECK_THROWS_AS(suse::parse_regex("a{3,2}"), suse::regex_parse_error);
+        CHECK_THROWS_AS(suse::parse_regex("a{2"), suse::regex_parse_error);
+    }
+
+    TEST_CASE("counted repetition is unambiguous") {
+        for (auto construction : {suse::regex_construction::thompson, suse::regex_construction::glushkov}) {
+            const auto bounded = suse::parse_regex("a{0,3}", {.reduce = false, .construction = construction});
+            const auto nested = suse::parse_regex("(a(ab){1,2}|b){2,3}", {.reduce = false, .construction = construction});
+            const auto unrolled = suse::parse_regex("(a(ab)(ab)?|b)(a(ab)(ab)?|b)(a(ab)(ab)?|b)?", {.reduce = false, .construction = construction});
+
+            for (std::string_view word : {"", "a", "aa", "aaa", "aaaa"}) {
+                CAPTURE(word);
+                REQUIRE(count_accepting_runs(bounded, word) == (word.size() <= 3 ? 1 : 0));
+            }
+            for (std::string_view word : {"bb", "bbb", "bbbb", "aabb", "aababb", "baababab", "aabababb"}) {
+                CAPTURE(word);
+                REQUIRE(nested.check(word) == unrolled.check(word));
+                REQUIRE(count_accepting_runs(nested, word) == count_accepting_runs(unrolled, word));
+            }
+        }
+    }
+
+    TEST_CASE("glushkov construction") {
+        const suse::regex_options glushkov{.construction = suse::regex_construction::glushkov};
+
+        std::vector<std::string> words{""};
+        for (std::size_t begin = 0, length = 0; length < 5; ++length) {
+            const auto end = words.size();
+            for (; begin < end; ++begin)
+                for (char symbol : {'a', 'b', 'c', 'd'})
+                    words.push_back(words[begin] + symbol);
+        }
+
+        for (std::string_view regex : {"", "a", ".", "ab|cb", "(a|a)b", "a*a*", "a*b+(c|d)", "(a|b)*c?", "(a?b?)+", "a.b*|(.c)?", "[ab]{1,3}c", "(a[bc]){2,}|d{0,2}", "(a{2}b?){1,2}"}) {
+            CAPTURE(regex);
+            const auto thompson_automaton = suse::parse_regex(regex);
+            const auto glushkov_automaton = suse::parse_regex(regex, glushkov);
+
+            for (const auto &state : glushkov_automaton.states())
+                REQUIRE(!state.transitions.contains(suse::nfa::epsilon_symbol));
+
+            for (const auto &word : words) {
+                CAPTURE(word);
+                REQUIRE(glushkov_automaton.check(word) == thompson_automaton.check(word));
+                REQUIRE(count_accepting_runs(glushkov_automaton, word) == count_accepting_runs(thompson_automaton, word));
+            }
+        }
+
+        // thompson's construction can leave and reenter a repetition directly nested in another one between two
+        // symbols, which adds runs
+        for (std::string_view regex : {"((ab)*|c)+d", "((b)+)+", "((a)*)+"}) {
+            CAPTURE(regex);
+            const auto thompson_automaton = suse::parse_regex(regex);
+            const auto glushkov_automaton = suse::parse_regex(regex, glushkov);
+
+            bool fewer_runs = false;
+            for (const auto &word : words) {
+                CAPTURE(word);
+                REQUIRE(glushkov_automaton.check(word) == thompson_automaton.check(word));
+                REQUIRE(count_accepting_runs(glushkov_automaton, word) <= count_accepting_runs(thompson_automaton, word));
+                fewer_runs |= count_accepting_runs(glushkov_automaton, word) < count_accepting_runs(thompson_automaton, word);
+            }
+            CHECK(fewer_runs);
+        }
+        CHECK(count_accepting_runs(suse::parse_regex("((ab)*|c)+d"), "ababcd") == 3);
+        CHECK(count_accepting_runs(suse::parse_regex("((ab)*|c)+d", glushkov), "ababcd") == 1);
+    }
+
+    TEST_CASE("glushkov construction is linear") {
+        std::string regex = "a";
+        for (char symbol = 'b'; symbol <= 'z'; ++symbol)
+            (regex += '|') += symbol;
+
+        // one state per position, the final ones of which are then merged
+        const auto automaton = suse::parse_regex(regex, {.construction = suse::regex_construction::glushkov});
+        CHECK(automaton.number_of_states() == 2);
+        CHECK(automaton.check("q"));
+        CHECK(!automaton.check("qq"));
+    }
+
+    TEST_CASE("reduction keeps the language, but not the number of runs") {
+        for (const auto *regex : {"((a)*)+", "a*a*", "a*a*b"}) {
+            const auto unreduced = suse::parse_regex(regex);
+            const auto reduced = suse::parse_regex(regex, {.reduce = true});
+            CAPTURE(regex);
+            CHECK(reduced.number_of_states() < unreduced.number_of_states());
+
+            bool fewer_runs = false;
+            for (const std::string word : {"", "a", "aa", "aaa", "ab", "b"}) {
+                CAPTURE(word);
+                REQUIRE(reduced.check(word) == unreduced.check(word));
+                REQUIRE(count_accepting_runs(reduced, word) <= count_accepting_runs(unreduced, word));
+                fewer_runs |= count_accepting_runs(reduced, word) < count_accepting_runs(unreduced, word);
+            }
+            CHECK(fewer_runs);
+        }
+
+        // a*a* has k + 1 runs for a^k, one per split point
+        const auto ambiguous = suse::parse_regex("a*a*");
+        CHECK(count_accepting_runs(ambiguous, "aaa") == 4);
+        CHECK(count_accepting_runs(suse::parse_regex("a*a*", {.reduce = true}), "aaa") == 1);
+    }
+
+    TEST_CASE("states with identical transitions are merged without reduction") {
+        CHECK(suse::parse_regex("a*b(c|d)*e").number_of_states() == 3);
+        CHECK(suse::parse_regex("a(b|c)+d?e").number_of_states() == 5);
+        CHECK(suse::parse_regex("((ab)*|c)+d").number_of_states() == 5);
+
+        // which makes both alternatives share their run
+        CHECK(count_accepting_runs(suse::parse_regex("(a|a)b"), "ab") == 1);
+    }
 }
@@ -1,5 +1,14 @@
+#include "edgelist.hpp"
+#include "eviction_strategies.hpp"
+#include "lazy_dfa.hpp"
 #include "nfa.hpp"
+#include "probabilities.hpp"
+#include "query_artifact.hpp"
 #include "regex.hpp"
+#include "static_query.hpp"
+
+#include <boost/multiprecision/cpp_bin_float.hpp>
+#include <boost/multiprecision/cpp_int.hpp>
 
 #include <cxxopts.hpp>
 
@@ -14,9 +23,13 @@
 #include <string_view>
 
 namespace {
-std::optional<suse::nfa> try_compile(std::string_view line) {
+// must match summary_selector for the strategy tables to be usable
+using counter_type = boost::multiprecision::uint128_t;
+using factor_type = boost::multiprecision::cpp_bin_float_50;
+
+std::optional<suse::nfa> try_compile(std::string_view line, const suse::regex_options &options) {
     try {
-        return suse::parse_regex(line);
+        return suse::parse_regex(line, options);
     } catch (const suse::regex_parse_error &error) {
         const auto prefix = line.substr(0, error.location);
         const auto error_char = error.location < line.size() ? line.substr(error.location, 1) : std::string_view{};
@@ -30,9 +43,12 @@ std::optional<suse::nfa> try_compile(std::string_view line) {
     }
 }
 
-void filter(const suse::nfa &nfa) {
+void filter(const suse::nfa &nfa, std::size_t max_cached_states) {
+    std::ios::sync_with_stdio(false);
+
+    suse::lazy_dfa matcher{nfa, max_cached_states};
     for (std::string line; std::getline(std::cin, line);) {
-        if (nfa.check(line))
+        if (matcher.check(line))
             fmt::print("{}\n", line);
     }
 }
@@ -40,7 +56,7 @@ void filter(const suse::nfa &nfa) {
 
 int main(int argc, char *argv[]) try {
     cxxopts::Options options("regex_compiler", "Transforms a regex into a corresponding NFA to draw and use.");
-    options.add_options()("regex,r", "Regex to convert/evaluate", cxxopts::value<std::string>())("output,o", "File to write the graphviz-dot representation of the compiled NFA to", cxxopts::value<std::string>())("evaluate,e", "Pretend to be a cheap imitation of grep: read lines from stdin and print those matching the given regex")("interactive,i", "Repeatedly wait for lines from stdin, parse them and output the compiled automaton to a file")("help,h", "Display this help meassage");
+    options.add_options()("regex,r", "Regex to convert/evaluate", cxxopts::value<std::string>())("output,o", "File to write the graphviz-dot representation of the compiled NFA to", cxxopts::value<std::string>())("evaluate,e", "Pretend to be a cheap imitation of grep: read lines from stdin and print those matching the given regex")("interactive,i", "Repeatedly wait for lines from stdin, parse them and output the compiled automaton to a file")("dfa-cache-size", "For evaluation mode: maximum number of lazily constructed DFA states to keep", cxxopts::value<std::size_t>()->default_value(std::to_string(suse::lazy_dfa::default_max_cached_states)))("emit-header", "File to write a C++ header with the compiled query as suse::static_query to", cxxopts::value<std::string>())("emit-artifact", "File to write the compiled query to, for summary_selector --artifact", cxxopts::value<std::string>())("time-window-size,t", "For --emit-artifact: also precompute the tables of the suse eviction strategy for this time window size", cxxopts::value<std::size_t>())("probabilities-file", "For --emit-artifact: file containing the probabilities for each character, uniform if omitted", cxxopts::value<std::string>())("header-name", "For --emit-header: name of the generated query constant", cxxopts::value<std::string>()->default_value("query"))("construction", "Automaton construction. Must be one of thompson or glushkov. Glushkov counts fewer matches for repetitions directly nested in repetitions, e.g. ((b)+)+", cxxopts::value<std::string>()->default_value("thompson"))("reduce", "Merge bisimilar NFA states. Keeps the matched language, but can lower match counts, e.g. for a*a*")("help,h", "Display this help meassage");
 
     options.parse_positional("regex");
     options.positional_help("regex");
@@ -62,6 +78,13 @@ int main(int argc, char *argv[]) try {
         return 1;
     }
 
+    const auto construction = suse::parse_regex_construction(parsed_args["construction"].template as<std::string>());
+    if (!construction) {
+        fmt::print(stderr, "Invalid construction, must be one of thompson or glushkov\n");
+        return 1;
+    }
+    const suse::regex_options regex_options{.reduce = parsed_args.count("reduce") > 0, .construction = *construction};
+
     std::optional<suse::nfa> current_nfa = std::nullopt;
 
     const std::optional<std::filesystem::path> target_filename = parsed_args.count("output") ? parsed_args["output"].as<std::string>() : std::optional<std::filesystem::path>{};
@@ -74,15 +97,34 @@ int main(int argc, char *argv[]) try {
     };
 
     if (parsed_args.count("regex") > 0)
-        current_nfa = try_compile(parsed_args["regex"].template as<std::string>());
+        current_nfa = try_compile(parsed_args["regex"].template as<std::string>(), regex_options);
     try_save();
 
+    if (parsed_args.count("emit-artifact") > 0 && current_nfa) {
+        std::ofstream out{parsed_args["emit-artifact"].template as<std::string>(), std::ios::binary};
+        const auto regex = parsed_args["regex"].template as<std::string>();
+        const auto edges = suse::compute_edges_per_character(*current_nfa);
+
+        if (parsed_args.count("time-window-size") > 0) {
+            const auto time_window_size = parsed_args["time-window-size"].template as<std::size_t>();
+            const auto probabilities = parsed_args.count("probabilities-file") > 0 ? suse::load_probabilities<factor_type>(parsed_args["probabilities-file"].template as<std::string>()) : suse::generate_uniform_probabilities<factor_type>(*current_nfa);
+            const auto tables = suse::eviction_strategies::suse<counter_type, factor_type>::compute_expected_changes(*current_nfa, time_window_size, probabilities);
+            suse::query_artifact::write<factor_type>(out, *current_nfa, edges, regex, time_window_size, tables);
+        } else
+            suse::query_artifact::write(out, *current_nfa, edges, regex);
+    }
+
+    if (parsed_args.count("emit-header") > 0 && current_nfa) {
+        std::ofstream out{parsed_args["emit-header"].template as<std::string>()};
+        suse::write_static_query_header(out, *current_nfa, parsed_args["header-name"].template as<std::string>(), parsed_args["regex"].template as<std::string>());
+    }
+
     if (parsed_args.count("evaluate") > 0 && current_nfa)
-        filter(*current_nfa);
+        filter(*current_nfa, parsed_args["dfa-cache-size"].template as<std::size_t>());
 
     if (parsed_args.count("interactive") > 0) {
         for (std::string line; std::getline(std::cin, line);) {
-            if ((current_nfa = try_compile(line)))
+            if ((current_nfa = try_compile(line, regex_options)))
                 try_save();
         }
     }
@@ -1,32 +1,46 @@
 #ifndef SUSE_RING_BUFFER_HPP
 #define SUSE_RING_BUFFER_HPP
 
+#include "memory_footprint.hpp"
+
+#include <memory_resource>
 #include <vector>
 
 #include <cstddef>
 
 namespace suse {
+// Allocates from a memory resource, which allocator-aware values such as execution_state_counter share
 template <typename T>
 class ring_buffer {
   public:
-    explicit ring_buffer(std::size_t capacity, const T &initial_value = {});
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    explicit ring_buffer(std::size_t capacity, const T &initial_value = {}, const allocator_type &allocator = {});
 
     T &operator[](std::size_t idx);
     const T &operator[](std::size_t idx) const;
 
-    void push_back(T value);
-    void pop_front();
+    // Grows if full. Values are assigned to preallocated slots, which keep their memory.
+    void push_back(const T &value);
+    void push_back(T &&value);
+    void pop_front(std::size_t count = 1);
     void clear();
 
     bool empty() const;
     std::size_t size() const;
     std::size_t capacity() const;
 
+    // All slots hold a value, used or not
+    friend memory_footprint footprint_of(const ring_buffer &buffer) {
+        return footprint_of(buffer.buffer_);
+    }
+
   private:
-    std::vector<T> buffer_;
+    std::pmr::vector<T> buffer_;
     std::size_t start_ = 0, size_ = 0;
 
     std::size_t to_real_index(std::size_t idx) const;
+    void grow(const T &filler);
 };
 
 template <typename T>
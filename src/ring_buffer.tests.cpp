@@ -3,6 +3,7 @@
 #include <doctest/doctest.h>
 
 #include <queue>
+#include <vector>
 
 TEST_SUITE("suse::ring_buffer") {
     TEST_CASE("simple") {
@@ -27,4 +28,35 @@ TEST_SUITE("suse::ring_buffer") {
                 REQUIRE(queue[idx] == buffer[idx]);
         }
     }
+
+    TEST_CASE("grows when full") {
+        std::deque<int> queue;
+        suse::ring_buffer<int> buffer(3);
+
+        for (int value = 0; value < 100; ++value) {
+            CAPTURE(value);
+
+            queue.push_back(value);
+            buffer.push_back(value);
+            if (value % 3 == 0 && queue.size() >= 2) {
+                queue.erase(queue.begin(), queue.begin() + 2);
+                buffer.pop_front(2);
+            }
+
+            REQUIRE(queue.size() == buffer.size());
+            for (std::size_t idx = 0; idx < queue.size(); ++idx)
+                REQUIRE(queue[idx] == buffer[idx]);
+        }
+
+        CHECK(buffer.capacity() >= buffer.size());
+    }
+
+    TEST_CASE("memory footprint") {
+        suse::ring_buffer<int> buffer(10);
+        CHECK(footprint_of(buffer) == suse::memory_footprint{1, 10 * sizeof(int)});
+
+        // the slots of a buffer of vectors hold their own allocations
+        suse::ring_buffer<std::vector<int>> nested(4, std::vector<int>(3));
+        CHECK(footprint_of(nested) == suse::memory_footprint{5, 4 * sizeof(std::vector<int>) + 4 * 3 * sizeof(int)});
+    }
 }
@@ -4,10 +4,13 @@
 	interface and implementation despite the template.
 */
 
+#include <algorithm>
+#include <cassert>
+
 namespace suse {
 
 template <typename T>
-ring_buffer<T>::ring_buffer(std::size_t capacity, const T &initial_value) : buffer_(capacity, initial_value) {}
+ring_buffer<T>::ring_buffer(std::size_t capacity, const T &initial_value, const allocator_type &allocator) : buffer_(capacity, initial_value, allocator) {}
 
 template <typename T>
 T &ring_buffer<T>::operator[](std::size_t idx) {
@@ -20,14 +23,30 @@ const T &ring_buffer<T>::operator[](std::size_t idx) const {
 }
 
 template <typename T>
-void ring_buffer<T>::push_back(T value) {
+void ring_buffer<T>::push_back(const T &value) {
+    if (size_ == buffer_.size())
+        grow(value);
+
+    buffer_[to_real_index(size_++)] = value;
+}
+
+template <typename T>
+void ring_buffer<T>::push_back(T &&value) {
+    if (size_ == buffer_.size())
+        grow(value);
+
     buffer_[to_real_index(size_++)] = std::move(value);
 }
 
 template <typename T>
-void ring_buffer<T>::pop_front() {
-    start_ = (start_ + 1) % buffer_.size();
-    --size_;
+void ring_buffer<T>::pop_front(std::size_t count) {
+    assert(count <= size_);
+
+    if (count == 0)
+        return;
+
+    start_ = (start_ + count) % buffer_.size();
+    size_ -= count;
 }
 
 template <typename T>
@@ -55,9 +74,23 @@ std::size_t ring_buffer<T>::to_real_index(std::size_t idx) const {
     return (start_ + idx) % buffer_.size();
 }
 
+template <typename T>
+void ring_buffer<T>::grow(const T &filler) {
+    const auto grown_capacity = std::max<std::size_t>(2 * buffer_.size(), 1);
+
+    std::pmr::vector<T> grown{buffer_.get_allocator()};
+    grown.reserve(grown_capacity);
+    for (std::size_t idx = 0; idx < size_; ++idx)
+        grown.push_back(std::move(buffer_[to_real_index(idx)]));
+    grown.resize(grown_capacity, filler);
+
+    buffer_ = std::move(grown);
+    start_ = 0;
+}
+
 template <typename T>
 bool operator==(const ring_buffer<T> &lhs, const ring_buffer<T> &rhs) {
-    if (lhs.capacity() != rhs.capacity() || lhs.size() != rhs.size())
+    if (lhs.size() != rhs.size())
         return false;
     for (std::size_t i = 0; i < lhs.size(); ++i) {
         if (lhs[i] != rhs[i])
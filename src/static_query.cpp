@@ -0,0 +1,56 @@
+#include "static_query.hpp"
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+// Octal escapes have a fixed length, so unlike \x they cannot swallow following characters
+std::string escape(std::string_view text, char quote) {
+    std::string result;
+    for (char symbol : text) {
+        const auto code = static_cast<unsigned char>(symbol);
+        if (code >= 0x20 && code < 0x7f && symbol != quote && symbol != '\\')
+            result.push_back(symbol);
+        else
+            result += fmt::format("\\{:03o}", code);
+    }
+    return result;
+}
+} // namespace
+
+namespace suse {
+void write_static_query_header(std::ostream &out, const nfa &automaton, std::string_view name, std::string_view regex) {
+    std::vector<static_edge> edges;
+    std::vector<std::string_view> is_final;
+    for (std::size_t source_id = 0; source_id < automaton.number_of_states(); ++source_id) {
+        const auto &state = automaton.states()[source_id];
+        is_final.push_back(state.is_final ? "true" : "false");
+
+        for (const auto &[symbol, targets] : state.transitions) {
+            for (auto target : targets)
+                edges.push_back({symbol, source_id, target});
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    std::vector<std::string> formatted_edges;
+    for (const auto &e : edges)
+        formatted_edges.push_back(fmt::format("{{'{}', {}, {}}}", escape({&e.symbol, 1}, '\''), e.from, e.to));
+
+    fmt::print(out, "// Generated by regex_compiler, do not edit.\n");
+    fmt::print(out, "#pragma once\n\n");
+    fmt::print(out, "#include \"static_query.hpp\"\n\n");
+    fmt::print(out, "#include <string_view>\n\n");
+    fmt::print(out, "namespace suse::compiled_queries {{\n");
+    fmt::print(out, "inline constexpr std::string_view {}_regex = \"{}\";\n", name, escape(regex, '"'));
+    fmt::print(out, "inline constexpr static_query<{}, {}> {}{{\n", automaton.number_of_states(), edges.size(), name);
+    fmt::print(out, "    {},\n", automaton.initial_state_id());
+    fmt::print(out, "    {{{}}},\n", fmt::join(is_final, ", "));
+    fmt::print(out, "    {{{{{}}}}}}};\n", fmt::join(formatted_edges, ", "));
+    fmt::print(out, "}} // namespace suse::compiled_queries\n");
+}
+} // namespace suse
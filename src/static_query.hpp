@@ -0,0 +1,158 @@
+#ifndef SUSE_STATIC_QUERY_HPP
+#define SUSE_STATIC_QUERY_HPP
+
+#include "edgelist.hpp"
+#include "event.hpp"
+#include "execution_state_counter.hpp"
+#include "nfa.hpp"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <cmath>
+#include <cstddef>
+
+namespace suse {
+struct static_edge {
+    char symbol;
+    std::size_t from, to;
+
+    friend constexpr auto operator<=>(const static_edge &, const static_edge &) = default;
+};
+
+// Compiled automaton of a query that is known at build time. It is structural, so it can be passed as a
+// template argument. Instances are generated by `regex_compiler --emit-header`.
+template <std::size_t number_of_states, std::size_t number_of_edges>
+struct static_query {
+    std::size_t initial_state;
+    std::array<bool, number_of_states> is_final;
+    std::array<static_edge, number_of_edges> edges; // sorted
+};
+
+// Drop-in replacement for edgelist, with the edges of every symbol unrolled at compile time
+template <auto query>
+class static_edgelist {
+  public:
+    static constexpr std::size_t number_of_states = query.is_final.size();
+
+    // Throws std::invalid_argument if automaton is not the one the query was compiled from.
+    explicit static_edgelist(const nfa &automaton);
+
+    template <typename callback_type>
+    static void for_each_edge(char symbol, callback_type &&callback) {
+        dispatch(symbol, callback, std::make_index_sequence<number_of_runs>{});
+    }
+
+    friend constexpr bool operator==(const static_edgelist &, const static_edgelist &) = default;
+
+  private:
+    static_assert(std::is_sorted(query.edges.begin(), query.edges.end()), "edges of a static query must be sorted");
+
+    // edges are grouped into runs of the same symbol
+    static constexpr std::size_t number_of_runs = [] {
+        std::size_t runs = 0;
+        for (std::size_t i = 0; i < query.edges.size(); ++i)
+            runs += i == 0 || query.edges[i].symbol != query.edges[i - 1].symbol;
+        return runs;
+    }();
+
+    static constexpr auto run_starts = [] {
+        std::array<std::size_t, number_of_runs + 1> starts{};
+        for (std::size_t i = 0, run = 0; i < query.edges.size(); ++i) {
+            if (i == 0 || query.edges[i].symbol != query.edges[i - 1].symbol)
+                starts[run++] = i;
+        }
+        starts[number_of_runs] = query.edges.size();
+        return starts;
+    }();
+
+    template <std::size_t first, typename callback_type, std::size_t... offsets>
+    static void apply_run(callback_type &callback, std::index_sequence<offsets...>) {
+        (callback(query.edges[first + offsets].from, query.edges[first + offsets].to), ...);
+    }
+
+    template <typename callback_type, std::size_t... runs>
+    static void dispatch(char symbol, callback_type &callback, std::index_sequence<runs...>) {
+        ((symbol == query.edges[run_starts[runs]].symbol && (apply_run<run_starts[runs]>(callback, std::make_index_sequence<run_starts[runs + 1] - run_starts[runs]>{}), true)) || ...);
+    }
+};
+
+template <auto query>
+static_edgelist<query>::static_edgelist(const nfa &automaton) {
+    const auto matches = [&]() {
+        if (automaton.number_of_states() != number_of_states || automaton.initial_state_id() != query.initial_state)
+            return false;
+
+        std::vector<static_edge> edges;
+        for (std::size_t source_id = 0; source_id < automaton.number_of_states(); ++source_id) {
+            const auto &state = automaton.states()[source_id];
+            if (state.is_final != query.is_final[source_id])
+                return false;
+
+            for (const auto &[symbol, targets] : state.transitions) {
+                for (auto target : targets)
+                    edges.push_back({symbol, source_id, target});
+            }
+        }
+
+        std::sort(edges.begin(), edges.end());
+        return std::equal(edges.begin(), edges.end(), query.edges.begin(), query.edges.end());
+    };
+
+    if (!matches())
+        throw std::invalid_argument("Automaton does not match the statically compiled query");
+}
+
+template <typename underlying, auto query>
+execution_state_counter<underlying> advance(const execution_state_counter<underlying> &counter, const static_edgelist<query> &, char symbol, const typename execution_state_counter<underlying>::allocator_type &allocator = {}) {
+    auto followup = execution_state_counter<underlying>{counter.size(), allocator};
+
+    const auto add = [&](std::size_t from, std::size_t to) {
+        followup[to] += counter[from];
+    };
+
+    static_edgelist<query>::for_each_edge(symbol, add);
+    static_edgelist<query>::for_each_edge(nfa::wildcard_symbol, add);
+
+    return followup;
+}
+
+template <typename underlying, auto query>
+execution_state_counter<underlying> advance_sum(const execution_state_counter<underlying> &count_counter, const execution_state_counter<underlying> &sum_counter, const static_edgelist<query> &, const event &event, const typename execution_state_counter<underlying>::allocator_type &allocator = {}) {
+    auto followup = execution_state_counter<underlying>{count_counter.size(), allocator};
+
+    const auto sum = [&](std::size_t from, std::size_t to) {
+        followup[to] += sum_counter[from] + count_counter[from] * event.value;
+    };
+
+    static_edgelist<query>::for_each_edge(event.type, sum);
+    static_edgelist<query>::for_each_edge(nfa::wildcard_symbol, sum);
+
+    return followup;
+}
+
+template <typename underlying, auto query>
+execution_state_counter<underlying> advance_prod(const execution_state_counter<underlying> &count_counter, const execution_state_counter<underlying> &mult_counter, const static_edgelist<query> &, const event &event, const typename execution_state_counter<underlying>::allocator_type &allocator = {}) {
+    auto followup = execution_state_counter<underlying>{count_counter.size(), allocator};
+    std::fill(followup.begin(), followup.end(), 1);
+
+    const auto mult = [&](std::size_t from, std::size_t to) {
+        followup[to] *= mult_counter[from] * pow(event.value, count_counter[from]);
+    };
+
+    static_edgelist<query>::for_each_edge(event.type, mult);
+    static_edgelist<query>::for_each_edge(nfa::wildcard_symbol, mult);
+
+    return followup;
+}
+
+// Writes a header defining `name` as the static_query of automaton, and `name_regex` as the query it was compiled from
+void write_static_query_header(std::ostream &out, const nfa &automaton, std::string_view name, std::string_view regex);
+} // namespace suse
+
+#endif
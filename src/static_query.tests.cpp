@@ -0,0 +1,75 @@
+#include "static_query.hpp"
+
+#include "eviction_strategies.hpp"
+#include "regex.hpp"
+#include "summary_selector_count.hpp"
+
+#include <boost/multiprecision/cpp_int.hpp>
+
+#include <doctest/doctest.h>
+
+#include <limits>
+#include <sstream>
+
+namespace {
+// regex_compiler "a*b(c|d)+e" --reduce --emit-header ... --header-name abcde
+inline constexpr std::string_view abcde_regex = "a*b(c|d)+e";
+inline constexpr suse::static_query<4, 7> abcde{
+    0,
+    {false, false, false, true},
+    {{{'a', 0, 0}, {'b', 0, 1}, {'c', 1, 2}, {'c', 2, 2}, {'d', 1, 2}, {'d', 2, 2}, {'e', 2, 3}}}};
+} // namespace
+
+TEST_SUITE("suse::static_query") {
+    TEST_CASE("advance matches edgelist") {
+        const auto automaton = suse::parse_regex(abcde_regex, {.reduce = true});
+        const auto edges = suse::compute_edges_per_character(automaton);
+        const suse::static_edgelist<abcde> static_edges{automaton};
+
+        auto counter = suse::execution_state_counter<int>(automaton.number_of_states());
+        counter[automaton.initial_state_id()] = 1;
+        for (char c : "aabcdbcdeeabx") {
+            CAPTURE(c);
+            const auto expected = advance(counter, edges, c);
+            const auto actual = advance(counter, static_edges, c);
+            REQUIRE(expected == actual);
+            counter += actual;
+        }
+    }
+
+    TEST_CASE("rejects other automatons") {
+        CHECK_THROWS_AS(suse::static_edgelist<abcde>{suse::parse_regex("a*b(c|d)*e")}, std::invalid_argument);
+        CHECK_THROWS_AS(suse::static_edgelist<abcde>{suse::parse_regex("a*b(c|e)+e")}, std::invalid_argument);
+    }
+
+    TEST_CASE("selector") {
+        using int_type = boost::multiprecision::uint128_t;
+        const std::string_view input = "aabcdacbadcbacdbcacbdaedabaaebdedaaddccdeaceabdebdeadaaabeadabdadbcadcdabeadeadcbedeaabbcbcbcacbccbabcdeacbdeabdadedbcbcdacdeacbdacaaacbcabcdbcacbcdacbadcbacdbcacbdabdacbdacbcbcecbacbbcbbcbbcacbdcabcaaaaabddccbacbcadcbbedacccadcbc";
+
+        const suse::regex_options reduced{.reduce = true};
+        suse::summary_selector_count<int_type> dynamic_selector(abcde_regex, 50, 42, std::numeric_limits<std::size_t>::max(), reduced);
+        suse::summary_selector_count<int_type, suse::static_edgelist<abcde>> static_selector(abcde_regex, 50, 42, std::numeric_limits<std::size_t>::max(), reduced);
+
+        const suse::eviction_strategies::suse dynamic_strategy{dynamic_selector, std::unordered_map<char, double>{{'a', 0.2}, {'b', 0.2}, {'c', 0.2}, {'d', 0.2}, {'e', 0.2}}};
+        const suse::eviction_strategies::suse static_strategy{static_selector, std::unordered_map<char, double>{{'a', 0.2}, {'b', 0.2}, {'c', 0.2}, {'d', 0.2}, {'e', 0.2}}};
+
+        for (std::size_t idx = 0; auto c : input) {
+            dynamic_selector.process_event({c, 0, idx}, dynamic_strategy);
+            static_selector.process_event({c, 0, idx++}, static_strategy);
+        }
+
+        CHECK(static_selector.number_of_contained_complete_matches() == dynamic_selector.number_of_contained_complete_matches());
+        CHECK(static_selector.number_of_detected_complete_matches() == dynamic_selector.number_of_detected_complete_matches());
+        CHECK(std::ranges::equal(static_selector.cached_events(), dynamic_selector.cached_events()));
+    }
+
+    TEST_CASE("emit header") {
+        std::ostringstream out;
+        suse::write_static_query_header(out, suse::parse_regex(abcde_regex, {.reduce = true}), "abcde", abcde_regex);
+
+        const auto header = out.str();
+        CHECK(header.find("inline constexpr std::string_view abcde_regex = \"a*b(c|d)+e\";") != std::string::npos);
+        CHECK(header.find("inline constexpr static_query<4, 7> abcde{") != std::string::npos);
+        CHECK(header.find("{{{'a', 0, 0}, {'b', 0, 1}, {'c', 1, 2}, {'c', 2, 2}, {'d', 1, 2}, {'d', 2, 2}, {'e', 2, 3}}}") != std::string::npos);
+    }
+}
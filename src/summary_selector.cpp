@@ -1,7 +1,14 @@
+#include "cycle_clock.hpp"
 #include "eviction_strategies.hpp"
+#include "latency_histogram.hpp"
+#include "memory_footprint.hpp"
+#include "metrics_server.hpp"
 #include "nfa.hpp"
+#include "probabilities.hpp"
+#include "query_artifact.hpp"
 #include "regex.hpp"
 #include "summary_selector_count.hpp"
+#include "trace_writer.hpp"
 
 #include <boost/multiprecision/cpp_bin_float.hpp>
 #include <boost/multiprecision/cpp_int.hpp>
@@ -14,6 +21,7 @@
 #include <fmt/ostream.h>
 
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
@@ -25,18 +33,22 @@
 #include <string_view>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include <cstdint>
+
 using nanoseconds = std::chrono::nanoseconds;
 using counter_type = boost::multiprecision::uint128_t;
+using factor_type = boost::multiprecision::cpp_bin_float_50;
 
 template <>
 struct fmt::formatter<counter_type> : fmt::ostream_formatter {}; // enables fmt::print to print values of boost::multiprecision::uint128_t
 
 namespace {
-std::optional<suse::nfa> try_compile(std::string_view line) {
+std::optional<suse::nfa> try_compile(std::string_view line, const suse::regex_options &options = {}) {
     try {
-        return suse::parse_regex(line);
+        return suse::parse_regex(line, options);
     } catch (const suse::regex_parse_error &error) {
         const auto prefix = line.substr(0, error.location);
         const auto error_char = error.location < line.size() ? line.substr(error.location, 1) : std::string_view{};
@@ -50,87 +62,182 @@ std::optional<suse::nfa> try_compile(std::string_view line) {
     }
 }
 
-std::unordered_map<char, boost::multiprecision::cpp_bin_float_50> load_probabilities(const std::filesystem::path &path) {
-    std::ifstream in{path};
-    std::unordered_map<char, boost::multiprecision::cpp_bin_float_50> probabilities;
-
-    char symbol;
-    boost::multiprecision::cpp_bin_float_50 probability;
-    while (in >> symbol >> probability)
-        probabilities[symbol] = probability;
-
-    probabilities[suse::nfa::wildcard_symbol] = 1;
-    return probabilities;
-}
-
-std::unordered_map<char, boost::multiprecision::cpp_bin_float_50> generate_uniform_probabilities(const suse::nfa &nfa) {
-    std::unordered_map<char, boost::multiprecision::cpp_bin_float_50> probabilities;
-    for (const auto &state : nfa.states())
-        for (const auto &[symbol, _] : state.transitions)
-            if (symbol != suse::nfa::wildcard_symbol)
-                probabilities[symbol] = {};
-
-    const auto uniform_fraction = boost::multiprecision::cpp_bin_float_50{1} / probabilities.size();
-    for (auto &[_, prob] : probabilities)
-        prob = uniform_fraction;
-
-    probabilities[suse::nfa::wildcard_symbol] = 1;
-    return probabilities;
-}
-
 struct summary_observation {
     counter_type matches;
     std::size_t timestamp;
 };
 
+struct automaton_statistics {
+    std::optional<std::size_t> states_before_reduction; // unknown for artifacts
+    std::size_t states;
+};
+
 struct run_result {
-    nanoseconds average_latency{0}, max_latency{0}, min_latency = std::chrono::hours{42};
+    nanoseconds average_latency{0}, max_latency{0}, min_latency{0};
+    suse::latency_histogram latencies; // in cycle_clock ticks, as are the phase latencies
+    std::optional<std::array<suse::latency_histogram, suse::number_of_processing_phases>> phase_latencies;
+    double nanoseconds_per_tick;
     std::vector<summary_observation> observations;
     counter_type final_matches, final_partial_matches;
     counter_type detected_matches, detected_partial_matches;
     std::size_t processed_events;
+    std::size_t reclaimed_entries;
+    std::size_t max_deferred_entries, deferred_entries;
+    suse::selector_stats stats;
+    suse::memory_footprint cache_memory, window_memory, strategy_memory;
+    std::size_t scratch_bytes, cached_events;
+    std::optional<std::size_t> peak_resident_bytes;
 };
 
+// Computing quantiles and match counts takes longer than processing an event, so most events only publish
+// the number of processed events
+constexpr std::size_t metrics_publish_interval = 1024;
+
+void publish_metrics(suse::live_metrics &metrics, const suse::summary_selector_count<counter_type> &selector, const suse::latency_histogram &latencies, double nanoseconds_per_tick) {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    for (std::size_t idx = 0; idx < suse::live_metrics::latency_quantiles.size(); ++idx)
+        metrics.latency_quantiles_ns[idx].store(static_cast<std::uint64_t>(latencies.value_at_percentile(suse::live_metrics::latency_quantiles[idx] * 100) * nanoseconds_per_tick), relaxed);
+
+    metrics.cached_events.store(selector.number_of_cached_events(), relaxed);
+    metrics.window_entries.store(selector.active_window().per_event_counters.size(), relaxed);
+    metrics.contained_matches.store(selector.number_of_contained_complete_matches().convert_to<double>(), relaxed);
+    metrics.detected_matches.store(selector.number_of_detected_complete_matches().convert_to<double>(), relaxed);
+
+    if constexpr (suse::collect_stats) {
+        const auto stats = selector.stats();
+        metrics.window_replays.store(stats.window_replays, relaxed);
+        metrics.affected_range_replays.store(stats.affected_range_replays, relaxed);
+        metrics.purge_replays.store(stats.purge_replays, relaxed);
+        metrics.replayed_entries.store(stats.replayed_entries, relaxed);
+        metrics.evictions.store(stats.evictions, relaxed);
+        metrics.expiries.store(stats.expiries, relaxed);
+    }
+}
+
 template <typename strategy_type>
-auto run(suse::summary_selector_count<counter_type> &selector, strategy_type &strategy, const std::unordered_set<std::size_t> evaluation_timestamps) {
+auto run(suse::summary_selector_count<counter_type> &selector, strategy_type &strategy, const std::unordered_set<std::size_t> evaluation_timestamps, suse::live_metrics *metrics, bool phase_timing) {
     run_result result{};
+    const suse::cycle_clock_calibration calibration;
+    selector.enable_phase_timing(phase_timing);
 
     for (suse::event next_event; std::cin >> next_event; ++result.processed_events) {
         if (evaluation_timestamps.contains(next_event.timestamp))
             result.observations.push_back({selector.number_of_contained_complete_matches(), next_event.timestamp});
 
-        const auto start = std::chrono::steady_clock::now();
+        const auto start = suse::cycle_clock::now();
         selector.process_event(next_event, strategy);
-        const auto end = std::chrono::steady_clock::now();
+        result.latencies.record(suse::cycle_clock::now() - start);
+        result.max_deferred_entries = std::max(result.max_deferred_entries, selector.number_of_deferred_entries());
+
+        if (metrics) {
+            metrics->processed_events.store(result.processed_events + 1, std::memory_order_relaxed);
+            if (result.processed_events % metrics_publish_interval == 0)
+                publish_metrics(*metrics, selector, result.latencies, calibration.nanoseconds_per_tick());
+        }
+    }
 
-        result.average_latency += end - start;
-        result.max_latency = std::max(result.max_latency, end - start);
-        result.min_latency = std::min(result.min_latency, end - start);
+    result.nanoseconds_per_tick = calibration.nanoseconds_per_tick();
+    if (metrics)
+        publish_metrics(*metrics, selector, result.latencies, result.nanoseconds_per_tick);
+    if (phase_timing) {
+        result.phase_latencies.emplace();
+        for (std::size_t phase = 0; phase < suse::number_of_processing_phases; ++phase)
+            (*result.phase_latencies)[phase] = selector.phase_latencies(static_cast<suse::processing_phase>(phase));
     }
-    result.average_latency /= result.processed_events;
+
+    const auto to_nanoseconds = [&](double ticks) { return nanoseconds{static_cast<nanoseconds::rep>(ticks * result.nanoseconds_per_tick)}; };
+    result.average_latency = to_nanoseconds(result.processed_events == 0 ? 0.0 : static_cast<double>(result.latencies.total()) / result.processed_events);
+    result.max_latency = to_nanoseconds(result.latencies.max());
+    result.min_latency = to_nanoseconds(result.latencies.min());
     result.final_matches = selector.number_of_contained_complete_matches();
     result.final_partial_matches = selector.number_of_contained_partial_matches();
 
     result.detected_matches = selector.number_of_detected_complete_matches();
     result.detected_partial_matches = selector.number_of_detected_partial_matches();
+    result.reclaimed_entries = selector.number_of_reclaimed_entries();
+    result.deferred_entries = selector.number_of_deferred_entries();
+    result.stats = selector.stats();
+
+    result.cache_memory = selector.cache_footprint();
+    result.window_memory = selector.window_footprint();
+    if constexpr (requires { strategy.table_footprint(); })
+        result.strategy_memory = strategy.table_footprint();
+    result.scratch_bytes = selector.scratch_capacity();
+    result.cached_events = selector.number_of_cached_events();
+    result.peak_resident_bytes = suse::peak_resident_bytes();
 
     fmt::print("Partial Matches: {}, Complete Matches: {}\n", result.final_partial_matches, result.final_matches);
     return result;
 }
 
-void generate_report(const std::filesystem::path &path, nanoseconds init_time, nanoseconds runtime, const run_result &result) {
+void generate_report(const std::filesystem::path &path, const automaton_statistics &automaton, nanoseconds init_time, nanoseconds runtime, const run_result &result) {
     std::ofstream out{path};
     fmt::print(out, "{{\n");
+    if (automaton.states_before_reduction)
+        fmt::print(out, "\t\"nfa_states_before_reduction\": {},\n", *automaton.states_before_reduction);
+    fmt::print(out, "\t\"nfa_states\": {},\n", automaton.states);
     fmt::print(out, "\t\"initialization_time_ns\": {},\n", init_time.count());
     fmt::print(out, "\t\"runtime_ns\": {},\n", runtime.count());
     fmt::print(out, "\t\"average_latency_ns\": {},\n", result.average_latency.count());
     fmt::print(out, "\t\"max_latency_ns\": {},\n", result.max_latency.count());
     fmt::print(out, "\t\"min_latency_ns\": {},\n", result.min_latency.count());
+
+    const auto percentile_ns = [&](const suse::latency_histogram &histogram, double percentile) {
+        return static_cast<std::uint64_t>(histogram.value_at_percentile(percentile) * result.nanoseconds_per_tick);
+    };
+    constexpr std::array<std::pair<std::string_view, double>, 4> percentiles{{{"p50", 50}, {"p90", 90}, {"p99", 99}, {"p99.9", 99.9}}};
+    for (const auto &[name, percentile] : percentiles)
+        fmt::print(out, "\t\"{}_latency_ns\": {},\n", name, percentile_ns(result.latencies, percentile));
+
+    if (result.phase_latencies) {
+        fmt::print(out, "\t\"phase_latencies\": {{\n");
+        for (std::size_t phase = 0; phase < suse::number_of_processing_phases; ++phase) {
+            const auto &histogram = (*result.phase_latencies)[phase];
+            fmt::print(out, "\t\t\"{}\": {{\"count\": {}, \"total_ns\": {}", to_string(static_cast<suse::processing_phase>(phase)), histogram.count(), static_cast<std::uint64_t>(histogram.total() * result.nanoseconds_per_tick));
+            for (const auto &[name, percentile] : percentiles)
+                fmt::print(out, ", \"{}_ns\": {}", name, percentile_ns(histogram, percentile));
+            fmt::print(out, ", \"max_ns\": {}}}{}\n", static_cast<std::uint64_t>(histogram.max() * result.nanoseconds_per_tick), phase + 1 < suse::number_of_processing_phases ? "," : "");
+        }
+        fmt::print(out, "\t}},\n");
+    }
     fmt::print(out, "\t\"final_matches\": {},\n", result.final_matches);
     fmt::print(out, "\t\"final_partial_matches\": {},\n", result.final_partial_matches);
     fmt::print(out, "\t\"detected_matches\": {},\n", result.detected_matches);
     fmt::print(out, "\t\"detected_partial_matches\": {},\n", result.detected_partial_matches);
     fmt::print(out, "\t\"processed_events\": {},\n", result.processed_events);
+    fmt::print(out, "\t\"reclaimed_entries\": {},\n", result.reclaimed_entries);
+    fmt::print(out, "\t\"max_deferred_entries\": {},\n", result.max_deferred_entries);
+    fmt::print(out, "\t\"deferred_entries\": {},\n", result.deferred_entries);
+
+    const auto memory_field = [&](std::string_view name, const suse::memory_footprint &footprint) {
+        fmt::print(out, "\t\t\"{0}_allocations\": {1},\n\t\t\"{0}_bytes\": {2},\n", name, footprint.allocations, footprint.bytes);
+    };
+    fmt::print(out, "\t\"memory\": {{\n");
+    memory_field("cache", result.cache_memory);
+    memory_field("window", result.window_memory);
+    memory_field("strategy_table", result.strategy_memory);
+    fmt::print(out, "\t\t\"scratch_bytes\": {},\n", result.scratch_bytes);
+    fmt::print(out, "\t\t\"bytes_per_cached_event\": {},\n", result.cached_events == 0 ? 0 : (result.cache_memory.bytes + result.window_memory.bytes) / result.cached_events);
+    if (result.peak_resident_bytes)
+        fmt::print(out, "\t\t\"peak_rss_bytes\": {}\n", *result.peak_resident_bytes);
+    else
+        fmt::print(out, "\t\t\"peak_rss_bytes\": null\n");
+    fmt::print(out, "\t}},\n");
+
+    if constexpr (suse::collect_stats) {
+        const auto &stats = result.stats;
+        fmt::print(out, "\t\"stats\": {{\n");
+        fmt::print(out, "\t\t\"advance_calls\": {},\n", stats.advance_calls);
+        fmt::print(out, "\t\t\"window_replays\": {},\n", stats.window_replays);
+        fmt::print(out, "\t\t\"affected_range_replays\": {},\n", stats.affected_range_replays);
+        fmt::print(out, "\t\t\"purge_replays\": {},\n", stats.purge_replays);
+        fmt::print(out, "\t\t\"replayed_entries\": {},\n", stats.replayed_entries);
+        fmt::print(out, "\t\t\"evictions\": {},\n", stats.evictions);
+        fmt::print(out, "\t\t\"expiries\": {},\n", stats.expiries);
+        fmt::print(out, "\t\t\"peak_cached_events\": {},\n", stats.peak_cached_events);
+        fmt::print(out, "\t\t\"peak_window_entries\": {}\n", stats.peak_window_entries);
+        fmt::print(out, "\t}},\n");
+    }
 
     const auto observed_timestamps = std::views::transform(result.observations, [](const auto &o) {
         return o.timestamp;
@@ -148,7 +255,7 @@ void generate_report(const std::filesystem::path &path, nanoseconds init_time, n
 
 int main(int argc, char *argv[]) try {
     cxxopts::Options options("summary_selector", "Transforms an eventstream to ");
-    options.add_options()("query,q", "Regex/Query to evaluate", cxxopts::value<std::string>())("strategy", "Eviction strategy. Must be one of suse, fifo or random. Default is suse", cxxopts::value<std::string>()->default_value("suse"))("probabilities-file", "For SuSe eviction strategy: file containing the probabilities for each character", cxxopts::value<std::string>())("summary-size,s", "Size of the summary cache", cxxopts::value<std::size_t>())("time-window-size,t", "Size of one time window", cxxopts::value<std::size_t>())("time-to-live", "The maximum amount of time an event stays in the cache", cxxopts::value<std::size_t>()->default_value(std::to_string(std::numeric_limits<std::size_t>::max())))("evaluation-timestamps,e", "Timestamps to evaluate at", cxxopts::value<std::vector<std::size_t>>())("output-nfa", "File to write the graphviz-dot representation of the compiled NFA to", cxxopts::value<std::string>())("report,r", "File to write results to", cxxopts::value<std::string>())("help,h", "Display this help meassage");
+    options.add_options()("query,q", "Regex/Query to evaluate", cxxopts::value<std::string>())("strategy", "Eviction strategy. Must be one of suse, fifo or random. Default is suse", cxxopts::value<std::string>()->default_value("suse"))("probabilities-file", "For SuSe eviction strategy: file containing the probabilities for each character", cxxopts::value<std::string>())("summary-size,s", "Size of the summary cache", cxxopts::value<std::size_t>())("time-window-size,t", "Size of one time window", cxxopts::value<std::size_t>())("time-to-live", "The maximum amount of time an event stays in the cache", cxxopts::value<std::size_t>()->default_value(std::to_string(std::numeric_limits<std::size_t>::max())))("evaluation-timestamps,e", "Timestamps to evaluate at", cxxopts::value<std::vector<std::size_t>>())("construction", "Automaton construction. Must be one of thompson or glushkov. Default is thompson. Glushkov counts fewer matches for repetitions directly nested in repetitions, e.g. ((b)+)+", cxxopts::value<std::string>()->default_value("thompson"))("reduce", "Merge bisimilar NFA states. Keeps the matched language, but can lower match counts, e.g. for a*a*")("reclaim-dead-entries", "Drop cached events that left the time window without being part of any match")("compress-runs", "Cache consecutive events of the same type and timestamp as one entry. Counts are unchanged with fifo, but can differ with suse, which scores each run once")("low-water-mark", "Once the summary is full, evict events down to this many at once", cxxopts::value<std::size_t>())("lazy-aggregates", "Update the counters of cached events only when they are read")("replay-budget", "Defer replays after evictions and replay about this many affected events per event. Counts are unchanged with fifo, but can differ with suse, which may evict based on outdated counters", cxxopts::value<std::size_t>())("metrics", "Serve live metrics in Prometheus format over HTTP at this localhost port or at unix:path", cxxopts::value<std::string>())("phase-timing", "Time the processing phases of each event separately and add their latencies to the report")("trace", "File to write a Chrome trace of the processing phases and replays to", cxxopts::value<std::string>())("trace-sampling", "Trace every n-th event only", cxxopts::value<std::size_t>()->default_value("1"))("artifact", "Compiled query written by regex_compiler --emit-artifact, used instead of the query", cxxopts::value<std::string>())("output-nfa", "File to write the graphviz-dot representation of the compiled NFA to", cxxopts::value<std::string>())("report,r", "File to write results to", cxxopts::value<std::string>())("help,h", "Display this help meassage");
 
     options.parse_positional("query");
     options.positional_help("query");
@@ -160,7 +267,12 @@ int main(int argc, char *argv[]) try {
         return 0;
     }
 
-    for (auto required : {"query", "summary-size", "time-window-size"}) {
+    if (parsed_args.count("query") == 0 && parsed_args.count("artifact") == 0) {
+        fmt::print(stderr, "query is a required argument\n");
+        return 1;
+    }
+
+    for (auto required : {"summary-size", "time-window-size"}) {
         if (parsed_args.count(required) == 0) {
             fmt::print(stderr, "{} is a required argument\n", required);
             return 1;
@@ -174,15 +286,34 @@ int main(int argc, char *argv[]) try {
         return 1;
     }
 
+    const auto construction = suse::parse_regex_construction(parsed_args["construction"].template as<std::string>());
+    if (!construction) {
+        fmt::print(stderr, "{}", fmt::styled("Invalid construction, aborting...\n", fmt::fg(fmt::color::red)));
+        return 1;
+    }
+
     const std::optional<std::filesystem::path> nfa_filename = parsed_args.count("output-nfa") ? parsed_args["output-nfa"].as<std::string>() : std::optional<std::filesystem::path>{};
 
-    const auto query = parsed_args["query"].template as<std::string>();
-    auto nfa = try_compile(query);
+    const auto start_time = std::chrono::steady_clock::now();
+
+    const auto artifact = parsed_args.count("artifact") > 0 ? std::optional<suse::query_artifact>{parsed_args["artifact"].template as<std::string>()} : std::nullopt;
+
+    auto nfa = artifact ? artifact->automaton() : try_compile(parsed_args["query"].template as<std::string>(), {.construction = *construction});
     if (!nfa) {
         fmt::print(stderr, "{}", fmt::styled("Invalid query, aborting...\n", fmt::fg(fmt::color::red)));
         return 1;
     }
 
+    // artifacts are reduced by regex_compiler --reduce, if at all
+    const auto states_before_reduction = artifact ? std::nullopt : std::optional{nfa->number_of_states()};
+    if (!artifact && parsed_args.count("reduce") > 0)
+        nfa->reduce();
+    const automaton_statistics automaton{states_before_reduction, nfa->number_of_states()};
+    if (automaton.states_before_reduction)
+        fmt::print("NFA states: {} before reduction, {} after\n", *automaton.states_before_reduction, automaton.states);
+    else
+        fmt::print("NFA states: {}\n", automaton.states);
+
     if (nfa_filename) {
         std::ofstream out{*nfa_filename};
         out << *nfa;
@@ -191,6 +322,19 @@ int main(int argc, char *argv[]) try {
     const auto summary_size = parsed_args["summary-size"].template as<std::size_t>();
     const auto time_window_size = parsed_args["time-window-size"].template as<std::size_t>();
     const auto time_to_live = parsed_args["time-to-live"].template as<std::size_t>();
+    const auto batch_eviction = parsed_args.count("low-water-mark") > 0;
+    if (batch_eviction && parsed_args["low-water-mark"].template as<std::size_t>() >= summary_size) {
+        fmt::print(stderr, "{}", fmt::styled("The low water mark must be below the summary size, aborting...\n", fmt::fg(fmt::color::red)));
+        return 1;
+    }
+    if (parsed_args.count("replay-budget") > 0 && parsed_args["replay-budget"].template as<std::size_t>() == 0) {
+        fmt::print(stderr, "{}", fmt::styled("The replay budget must be positive, aborting...\n", fmt::fg(fmt::color::red)));
+        return 1;
+    }
+    if (parsed_args["trace-sampling"].template as<std::size_t>() == 0) {
+        fmt::print(stderr, "{}", fmt::styled("The trace sampling interval must be positive, aborting...\n", fmt::fg(fmt::color::red)));
+        return 1;
+    }
     const auto evaluation_timestamps = [&]() -> std::unordered_set<std::size_t> {
         if (parsed_args.count("evaluation-timestamps") == 0)
             return {};
@@ -199,18 +343,38 @@ int main(int argc, char *argv[]) try {
         return {timestamps.begin(), timestamps.end()};
     }();
 
-    const auto start_time = std::chrono::steady_clock::now();
-
-    suse::summary_selector_count<counter_type> selector{query, summary_size, time_window_size, time_to_live};
+    auto selector = artifact ? suse::summary_selector_count<counter_type>{*nfa, artifact->edges(), summary_size, time_window_size, time_to_live} : suse::summary_selector_count<counter_type>{*nfa, summary_size, time_window_size, time_to_live};
+    selector.enable_dead_entry_reclamation(parsed_args.count("reclaim-dead-entries") > 0);
+    selector.enable_run_length_compression(parsed_args.count("compress-runs") > 0);
+    selector.enable_lazy_aggregates(parsed_args.count("lazy-aggregates") > 0);
+    if (batch_eviction)
+        selector.enable_batch_eviction(parsed_args["low-water-mark"].template as<std::size_t>());
+    if (parsed_args.count("replay-budget") > 0)
+        selector.enable_deferred_replays(parsed_args["replay-budget"].template as<std::size_t>());
+
+    suse::live_metrics metrics;
+    metrics.operation_counts = suse::collect_stats;
+    std::optional<suse::metrics_server> server;
+    if (parsed_args.count("metrics") > 0)
+        server.emplace(parsed_args["metrics"].template as<std::string>(), metrics);
+
+    suse::trace_writer tracer;
+    if (parsed_args.count("trace") > 0)
+        selector.enable_tracing(tracer, parsed_args["trace-sampling"].template as<std::size_t>());
 
     const auto measured_run = [&](auto &strategy) {
         const auto processing_start_time = std::chrono::steady_clock::now();
-        const auto result = run(selector, strategy, evaluation_timestamps);
+        const auto result = run(selector, strategy, evaluation_timestamps, server ? &metrics : nullptr, parsed_args.count("phase-timing") > 0);
         const auto processing_end_time = std::chrono::steady_clock::now();
 
+        if (parsed_args.count("trace") > 0) {
+            std::ofstream out{parsed_args["trace"].template as<std::string>()};
+            tracer.write(out, result.nanoseconds_per_tick);
+        }
+
         if (parsed_args.count("report") > 0) {
             const auto filename = parsed_args["report"].template as<std::string>();
-            generate_report(filename, processing_start_time - start_time, processing_end_time - processing_start_time, result);
+            generate_report(filename, automaton, processing_start_time - start_time, processing_end_time - processing_start_time, result);
         }
     };
 
@@ -219,14 +383,25 @@ int main(int argc, char *argv[]) try {
     else if (strategy == "random")
         measured_run(suse::eviction_strategies::random);
     else {
-        const auto probabilities = parsed_args.count("probabilities-file") > 0 ? load_probabilities(parsed_args["probabilities-file"].template as<std::string>()) : generate_uniform_probabilities(*nfa);
-        suse::eviction_strategies::suse suse{selector, probabilities};
-
-        measured_run(suse);
+        const auto use_precomputed_tables = artifact && artifact->has_strategy_tables() && artifact->strategy_tables_time_window_size() == time_window_size && parsed_args.count("probabilities-file") == 0;
+        if (use_precomputed_tables) {
+            suse::eviction_strategies::suse suse{selector, artifact->strategy_tables<factor_type>()};
+            measured_run(suse);
+        } else {
+            const auto probabilities = parsed_args.count("probabilities-file") > 0 ? suse::load_probabilities<factor_type>(parsed_args["probabilities-file"].template as<std::string>()) : suse::generate_uniform_probabilities<factor_type>(*nfa);
+            suse::eviction_strategies::suse suse{selector, probabilities};
+            measured_run(suse);
+        }
     }
 
     return 0;
 } catch (const cxxopts::exceptions::exception &e) {
     fmt::print(stderr, "Error parsing arguments: {}\n", e.what());
     return 1;
+} catch (const suse::query_artifact_error &e) {
+    fmt::print(stderr, "Error loading query artifact: {}\n", e.what());
+    return 1;
+} catch (const suse::metrics_server_error &e) {
+    fmt::print(stderr, "Error serving metrics: {}\n", e.what());
+    return 1;
 }
@@ -1,22 +1,41 @@
 #ifndef SUSE_SUMMARY_SELECTOR_BASE_HPP
 #define SUSE_SUMMARY_SELECTOR_BASE_HPP
 
+#include "arena_resource.hpp"
+#include "compiled_query.hpp"
+#include "cycle_clock.hpp"
 #include "edgelist.hpp"
 #include "event.hpp"
 #include "execution_state_counter.hpp"
+#include "latency_histogram.hpp"
+#include "memory_footprint.hpp"
 #include "nfa.hpp"
 #include "regex.hpp"
 #include "ring_buffer.hpp"
+#include "trace_writer.hpp"
 
+#include <algorithm>
+#include <array>
 #include <concepts>
+#include <functional>
+#include <initializer_list>
+#include <istream>
+#include <iterator>
 #include <limits>
+#include <memory>
+#include <memory_resource>
 #include <optional>
+#include <ostream>
 #include <span>
+#include <stdexcept>
+#include <string>
 #include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <cstddef>
+#include <cstdint>
 
 namespace suse {
 
@@ -35,33 +54,108 @@ concept eviction_strategy_object = requires(const T strategy, const cache_type c
 template <typename T, typename cache_type>
 concept eviction_strategy = callable_eviction_strategy<T, cache_type> || eviction_strategy_object<T, cache_type>;
 
+// Strategies that can select several events at once for selectors with batch eviction enabled
+template <typename T, typename cache_type>
+concept batch_eviction_strategy = eviction_strategy<T, cache_type> && requires(const T strategy, const cache_type cache, const event e, std::size_t count) {
+    { strategy.select_batch(cache, e, count) }
+    ->std::convertible_to<std::vector<std::size_t>>;
+};
+
+// Strategies that never read the state counters of cached events declare so with a member
+// static constexpr bool reads_state_counters = false, see enable_lazy_aggregates
+template <typename T>
+constexpr bool strategy_reads_state_counters = [] {
+    if constexpr (requires { T::reads_state_counters; })
+        return T::reads_state_counters;
+    else
+        return true;
+}();
+
+// Parts of process_event that are timed separately, see enable_phase_timing
+enum class processing_phase {
+    update_window, // including reclaiming dead entries
+    purge_expired,
+    select_eviction,
+    remove_events, // including the replays the removals cause
+    add_event,
+    deferred_replay
+};
+
+inline constexpr std::size_t number_of_processing_phases = 6;
+
+constexpr std::string_view to_string(processing_phase phase) {
+    constexpr std::array<std::string_view, number_of_processing_phases> names{"update_window", "purge_expired", "select_eviction", "remove_events", "add_event", "deferred_replay"};
+    return names[static_cast<std::size_t>(phase)];
+}
+
+#ifdef SUSE_COLLECT_STATS
+inline constexpr bool collect_stats = true;
+#else
+inline constexpr bool collect_stats = false;
+#endif
+
+// Operation counts of a selector. Only collected if SUSE_COLLECT_STATS is defined, otherwise counting compiles
+// to nothing and all counts stay zero.
+struct selector_stats {
+    std::size_t advance_calls = 0; // a change of a compressed run counts as one
+    std::size_t window_replays = 0; // of the active window
+    std::size_t affected_range_replays = 0; // after removals, whether deferred or not
+    std::size_t purge_replays = 0;
+    std::size_t replayed_entries = 0; // by any replay
+    std::size_t evictions = 0;
+    std::size_t expiries = 0;
+    std::size_t peak_cached_events = 0;
+    std::size_t peak_window_entries = 0;
+};
+
 template <typename counter_type>
 struct cache_entry {
     event cached_event;
-    execution_state_counter<counter_type> state_counter;
+    execution_state_counter<counter_type> state_counter; // of each single event if it stands for a run
+    std::size_t multiplicity = 1; // consecutive events of the same type and timestamp, see enable_run_length_compression
     friend auto operator<=>(const cache_entry &, const cache_entry &) = default;
+
+    friend memory_footprint footprint_of(const cache_entry &entry) {
+        return footprint_of(entry.state_counter);
+    }
 };
 
-template <typename counter_type>
+// transitions_type is edgelist, or a static_edgelist for queries compiled into the binary
+template <typename counter_type, typename transitions_type = edgelist>
 class summary_selector_base {
   public:
-    summary_selector_base(std::string_view query, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live) : automaton_{parse_regex(query)},
-                                                                                                                                      per_character_edges_{compute_edges_per_character(automaton_)},
-                                                                                                                                      time_to_live_{time_to_live},
-                                                                                                                                      cache_{},
-                                                                                                                                      total_counter_{automaton_.number_of_states()},
-                                                                                                                                      total_detected_counter_{automaton_.number_of_states()},
-                                                                                                                                      active_window_{create_window_info(time_window_size)} {
+    summary_selector_base(std::shared_ptr<const compiled_query<transitions_type>> query, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live) : query_{std::move(query)},
+                                                                                                                                                                   time_to_live_{time_to_live},
+                                                                                                                                                                   time_window_size_{time_window_size},
+                                                                                                                                                                   cache_{},
+                                                                                                                                                                   total_counter_{query_->automaton().number_of_states()},
+                                                                                                                                                                   total_detected_counter_{query_->automaton().number_of_states()},
+                                                                                                                                                                   active_window_{create_window_info(time_window_size)} {
         cache_.reserve(summary_size);
     }
 
     virtual ~summary_selector_base() = default;
 
-    template <eviction_strategy<summary_selector_base<counter_type>> strategy_type>
+    template <eviction_strategy<summary_selector_base> strategy_type>
     void process_event(const event &new_event, const strategy_type &strategy) {
+        start_tracing_event();
+        std::uint64_t phase_start = phase_latencies_ || tracing_event_ ? cycle_clock::now() : 0;
+        const auto event_start = phase_start;
+        if (record_head_ && (head_events_.empty() || new_event.timestamp - head_events_.front().timestamp <= time_window_size()))
+            head_events_.push_back(new_event);
+
         current_time_ = new_event.timestamp;
-        update_window(active_window_, new_event.timestamp);
-        purge_expired();
+        const auto previous_window_start_idx = active_window_.start_idx;
+        if (window_detached_)
+            attach_counters_leaving_window(new_event.timestamp);
+        if (update_window(active_window_, new_event.timestamp)) {
+            if (reclaim_dead_entries_)
+                reclaim_dead_entries(previous_window_start_idx);
+            end_phase(processing_phase::update_window, phase_start);
+        }
+
+        if (purge_expired())
+            end_phase(processing_phase::purge_expired, phase_start);
 
         const auto select_idx_to_evict = [&]() -> std::optional<std::size_t> {
             if constexpr (callable_eviction_strategy<strategy_type, summary_selector_base>)
@@ -70,13 +164,51 @@ class summary_selector_base {
                 return strategy.select(*this, new_event);
         };
 
-        if (cache_.size() == cache_.capacity()) {
-            if (auto to_remove = select_idx_to_evict(); to_remove)
-                remove_event(*to_remove);
+        const auto select_batch_to_evict = [&]() -> std::vector<std::size_t> {
+            if constexpr (batch_eviction_strategy<strategy_type, summary_selector_base>)
+                return strategy.select_batch(*this, new_event, cache_.capacity() - *low_water_mark_);
+            else
+                return {};
+        };
+
+        if (number_of_cached_events() == cache_.capacity()) {
+            if constexpr (strategy_reads_state_counters<strategy_type>)
+                attach_window_counters();
+
+            if (low_water_mark_ && batch_eviction_strategy<strategy_type, summary_selector_base>) {
+                auto to_remove = select_batch_to_evict();
+                end_phase(processing_phase::select_eviction, phase_start);
+                update_stats([&](auto &stats) { stats.evictions += to_remove.size(); });
+                remove_events(std::move(to_remove));
+                end_phase(processing_phase::remove_events, phase_start);
+            } else {
+                const auto to_remove = select_idx_to_evict();
+                end_phase(processing_phase::select_eviction, phase_start);
+                if (to_remove) {
+                    update_stats([](auto &stats) { ++stats.evictions; });
+                    remove_event(*to_remove);
+                    end_phase(processing_phase::remove_events, phase_start);
+                }
+            }
         }
 
-        if (cache_.size() < cache_.capacity())
+        if (number_of_cached_events() < cache_.capacity()) {
             add_event(new_event);
+            end_phase(processing_phase::add_event, phase_start);
+        }
+
+        if (!deferred_replays_.empty()) {
+            replay_deferred(*replay_budget_);
+            end_phase(processing_phase::deferred_replay, phase_start);
+        }
+
+        update_stats([&](auto &stats) {
+            stats.peak_cached_events = std::max(stats.peak_cached_events, number_of_cached_events());
+            stats.peak_window_entries = std::max(stats.peak_window_entries, active_window_.per_event_counters.size());
+        });
+
+        trace_span("process_event", event_start, {{"timestamp", new_event.timestamp}, {"cached_events", number_of_cached_events()}});
+        tracing_event_ = false;
     }
 
     void process_event(const event &new_event) {
@@ -85,10 +217,139 @@ class summary_selector_base {
 
     virtual void remove_event(std::size_t cache_index) = 0;
 
+    // Removes one event per given index, so an index may occur up to the multiplicity of its entry. The
+    // default removes them one at a time, youngest first, so that the remaining indices stay valid.
+    virtual void remove_events(std::vector<std::size_t> cache_indices) {
+        std::sort(cache_indices.begin(), cache_indices.end(), std::greater<>{});
+        for (auto cache_index : cache_indices)
+            remove_event(cache_index);
+    }
+
+    // Once the summary is full, strategies supporting it evict events down to low_water_mark at once instead
+    // of a single one per event, which spreads the cost of selecting and replaying over the following events.
+    // Other strategies still evict one event at a time. Throws std::invalid_argument unless low_water_mark is
+    // below the summary size.
+    void enable_batch_eviction(std::size_t low_water_mark) {
+        if (low_water_mark >= cache_.capacity())
+            throw std::invalid_argument("The low water mark must be below the summary size");
+
+        low_water_mark_ = low_water_mark;
+    }
+
+    // Records how many cycle_clock ticks each processing_phase of process_event takes. Phases that do nothing
+    // for an event, like evicting before the summary is full or updating a window no event leaves, are not
+    // recorded for it.
+    void enable_phase_timing(bool enabled = true) {
+        if (enabled && !phase_latencies_)
+            phase_latencies_.emplace();
+        else if (!enabled)
+            phase_latencies_.reset();
+    }
+
+    // Records spans of every sampling_interval-th event to writer: for process_event, its phases and the
+    // replays within them. The writer must outlive the selector or a call to disable_tracing. Throws
+    // std::invalid_argument if sampling_interval is zero.
+    void enable_tracing(trace_writer &writer, std::size_t sampling_interval = 1) {
+        if (sampling_interval == 0)
+            throw std::invalid_argument("The trace sampling interval must be positive");
+
+        tracer_ = &writer;
+        trace_sampling_interval_ = sampling_interval;
+        events_until_traced_ = 0;
+    }
+
+    void disable_tracing() {
+        tracer_ = nullptr;
+    }
+
+    // Replays and the updates for new events allocate their temporary counters from scratch memory. By
+    // default, a selector has its own arena_resource, which is reset after each of them. A given resource is
+    // used instead, without resets, until use_own_scratch_memory is called, and must outlive its use. Cached
+    // and window counters always use the default memory resource, see std::pmr::set_default_resource.
+    void use_scratch_resource(std::pmr::memory_resource &resource) {
+        external_scratch_ = &resource;
+    }
+
+    void use_own_scratch_memory() {
+        external_scratch_ = nullptr;
+    }
+
+    // Bytes kept by the own scratch arena between replays
+    std::size_t scratch_capacity() const {
+        return scratch_arena_.capacity();
+    }
+
+    // Heap memory of the cached events and their state counters
+    memory_footprint cache_footprint() const {
+        return footprint_of(cache_);
+    }
+
+    // Heap memory of the counters of the active window
+    memory_footprint window_footprint() const {
+        return footprint_of(active_window_.per_event_counters) + footprint_of(active_window_.total_counter);
+    }
+
+    // All zero unless built with SUSE_COLLECT_STATS
+    selector_stats stats() const {
+        if constexpr (collect_stats)
+            return stats_;
+        else
+            return {};
+    }
+
+    // Empty unless phase timing is enabled
+    const latency_histogram &phase_latencies(processing_phase phase) const {
+        static const latency_histogram untimed;
+        return phase_latencies_ ? (*phase_latencies_)[static_cast<std::size_t>(phase)] : untimed;
+    }
+
+    // Off by default, as reclaiming shifts the cache indices of all younger events.
+    void enable_dead_entry_reclamation(bool enabled = true) {
+        reclaim_dead_entries_ = enabled;
+    }
+
+    // Records the events of the first time window, which merge() needs from the later of two selectors.
+    // Must be enabled before the first event.
+    void enable_merging(bool enabled = true) {
+        record_head_ = enabled;
+    }
+
+    // With lazy aggregates, the state counters of events in the active window are only current after this.
+    // process_event calls it for eviction strategies reading them.
+    void materialize_state_counters() {
+        attach_window_counters();
+    }
+
+    // Replays all deferred replays, see enable_deferred_replays
+    void complete_deferred_replays() {
+        refresh_state_counters(0, std::numeric_limits<std::size_t>::max());
+    }
+
+    // Cached events whose state counters await a deferred replay
+    std::size_t number_of_deferred_entries() const {
+        std::size_t deferred = 0;
+        for (const auto &[first_timestamp, last_timestamp] : deferred_replays_)
+            deferred += first_index_past(last_timestamp) - first_index_not_older_than(first_timestamp);
+
+        return deferred;
+    }
+
+    std::size_t number_of_reclaimed_entries() const {
+        return number_of_reclaimed_entries_;
+    }
+
+    // With lazy aggregates, the state counters of events in the active window are stale until
+    // materialize_state_counters is called, and with deferred replays until complete_deferred_replays is.
+    // The events themselves and their multiplicities are always current.
     auto cached_events() const {
         return std::span{cache_.begin(), cache_.end()};
     }
 
+    // Differs from the number of cache entries if runs are compressed
+    std::size_t number_of_cached_events() const {
+        return cache_.size() + number_of_compressed_events_;
+    }
+
     const auto &active_window() const {
         return active_window_;
     }
@@ -106,30 +367,38 @@ class summary_selector_base {
     }
 
     const auto &automaton() const {
-        return automaton_;
+        return query_->automaton();
+    }
+
+    // Pass this to further selectors of the same query to share the compiled automaton and tables
+    const auto &query() const {
+        return query_;
     }
 
     auto time_window_size() const {
-        return active_window_.per_event_counters.capacity();
+        return time_window_size_;
     }
 
-    friend bool operator==(const summary_selector_base<counter_type> &lhs, const summary_selector_base<counter_type> &rhs) {
-        if (lhs.per_character_edges_ != rhs.per_character_edges_)
+    friend bool operator==(const summary_selector_base &lhs, const summary_selector_base &rhs) {
+        if (lhs.query_->transitions() != rhs.query_->transitions())
             return false;
-        if (lhs.cache_ != rhs.cache_)
+        if (lhs.window_detached_ || rhs.window_detached_) {
+            if (lhs.attached_cache() != rhs.attached_cache())
+                return false;
+        } else if (lhs.cache_ != rhs.cache_)
             return false;
         if (lhs.total_counter_ != rhs.total_counter_)
             return false;
-        if (lhs.current_time_ != rhs.current_time_)
+        if (lhs.current_time_ != rhs.current_time_ || lhs.time_window_size_ != rhs.time_window_size_)
             return false;
 
         return lhs.active_window_ == rhs.active_window_;
     }
 
   protected:
-    nfa automaton_;
-    edgelist per_character_edges_;
+    std::shared_ptr<const compiled_query<transitions_type>> query_;
     std::size_t time_to_live_;
+    std::size_t time_window_size_;
     std::vector<cache_entry<counter_type>> cache_;
 
     struct window_info {
@@ -144,49 +413,675 @@ class summary_selector_base {
 
     std::size_t current_time_{0};
 
+    bool reclaim_dead_entries_{false};
+    std::size_t number_of_reclaimed_entries_{0};
+
     virtual void add_event(const event &new_event) = 0;
-    void purge_expired() {
-        std::size_t purge_until = 0;
-        while (purge_until < cache_.size() && current_time() - cache_[purge_until].cached_event.timestamp > time_to_live_) {
-            total_counter_ -= cache_[purge_until].state_counter;
-            const auto removed_timestamp = timestamp_at(purge_until);
-            cache_[purge_until].cached_event.timestamp = std::numeric_limits<std::size_t>::max(); // dirty hack to make the replay ignore this event
-            std::fill(cache_[purge_until].state_counter.begin(), cache_[purge_until].state_counter.end(), 0);
-            replay_affected_range(purge_until + 1, removed_timestamp);
-            ++purge_until;
+
+    std::vector<event> head_events_;
+    bool record_head_{false};
+
+    std::optional<std::size_t> low_water_mark_;
+
+    std::optional<std::array<latency_histogram, number_of_processing_phases>> phase_latencies_;
+
+    void end_phase(processing_phase phase, std::uint64_t &phase_start) {
+        if (!phase_latencies_ && !tracing_event_)
+            return;
+
+        const auto now = cycle_clock::now();
+        if (phase_latencies_)
+            (*phase_latencies_)[static_cast<std::size_t>(phase)].record(now - phase_start);
+        if (tracing_event_)
+            tracer_->add_span(to_string(phase), phase_start, now);
+        phase_start = now;
+    }
+
+    mutable arena_resource scratch_arena_;
+    std::pmr::memory_resource *external_scratch_ = nullptr;
+    mutable std::size_t scratch_depth_ = 0; // of nested scratch_scopes
+
+    std::pmr::polymorphic_allocator<> scratch_allocator() const {
+        return external_scratch_ ? external_scratch_ : &scratch_arena_;
+    }
+
+    // Scratch memory is reset when the outermost scope ends, so temporaries must not outlive their scope
+    class scratch_scope {
+      public:
+        explicit scratch_scope(const summary_selector_base &selector) : selector_{selector} {
+            ++selector_.scratch_depth_;
         }
 
-        if (purge_until == 0)
+        ~scratch_scope() {
+            if (--selector_.scratch_depth_ == 0 && !selector_.external_scratch_)
+                selector_.scratch_arena_.reset();
+        }
+
+        scratch_scope(const scratch_scope &) = delete;
+        scratch_scope &operator=(const scratch_scope &) = delete;
+
+      private:
+        const summary_selector_base &selector_;
+    };
+
+    trace_writer *tracer_ = nullptr;
+    std::size_t trace_sampling_interval_ = 1;
+    std::size_t events_until_traced_ = 0;
+    bool tracing_event_ = false; // whether the event being processed is sampled
+
+    void start_tracing_event() {
+        tracing_event_ = tracer_ && events_until_traced_ == 0;
+        if (tracing_event_)
+            events_until_traced_ = trace_sampling_interval_;
+        if (tracer_)
+            --events_until_traced_;
+    }
+
+    std::uint64_t trace_start() const {
+        return tracing_event_ ? cycle_clock::now() : 0;
+    }
+
+    void trace_span(std::string_view name, std::uint64_t start, std::initializer_list<trace_writer::argument> arguments = {}) const {
+        if (tracing_event_)
+            tracer_->add_span(name, start, cycle_clock::now(), arguments);
+    }
+
+    struct no_stats {};
+    [[no_unique_address]] mutable std::conditional_t<collect_stats, selector_stats, no_stats> stats_;
+
+    template <typename update_type>
+    void update_stats(update_type &&update) const {
+        if constexpr (collect_stats)
+            update(stats_);
+    }
+
+    void count_advances(std::size_t number_of_advances) const {
+        update_stats([&](auto &stats) { stats.advance_calls += number_of_advances; });
+    }
+
+    bool compress_runs_{false};
+    std::size_t number_of_compressed_events_{0}; // events represented by the multiplicity of an entry beyond the first
+
+    // With lazy aggregates, add_event only advances the per-event counters of the active window. The state
+    // counter of each event in it then holds the difference to its per-event counter, which stays constant
+    // until the window is replayed, and the per-event counter is added back before anything reads it.
+    bool lazy_aggregates_{false};
+    bool window_detached_{false};
+
+    void attach_window_counters() {
+        if (!window_detached_)
+            return;
+
+        for (std::size_t i = 0; i < active_window_.per_event_counters.size(); ++i)
+            cache_[active_window_.start_idx + i].state_counter += active_window_.per_event_counters[i];
+        window_detached_ = false;
+    }
+
+    void detach_window_counters() {
+        if (!lazy_aggregates_ || window_detached_)
+            return;
+
+        for (std::size_t i = 0; i < active_window_.per_event_counters.size(); ++i)
+            cache_[active_window_.start_idx + i].state_counter -= active_window_.per_event_counters[i];
+        window_detached_ = true;
+    }
+
+    // Called before update_window on the active window, which drops the per-event counters of events leaving it
+    void attach_counters_leaving_window(std::size_t timestamp) {
+        const auto window_end = active_window_.start_idx + active_window_.per_event_counters.size();
+        const auto new_start_idx = first_index_in_window_of(timestamp, active_window_.start_idx, window_end);
+
+        // update_window replays the whole window if an initiator leaves it
+        const auto leaving = std::span{cache_.begin() + active_window_.start_idx, cache_.begin() + new_start_idx};
+        if (std::any_of(leaving.begin(), leaving.end(), [&](const auto &entry) { return query_->is_initiator(entry.cached_event.type); })) {
+            attach_window_counters();
+            return;
+        }
+
+        for (std::size_t idx = active_window_.start_idx; idx < new_start_idx; ++idx)
+            cache_[idx].state_counter += active_window_.per_event_counters[idx - active_window_.start_idx];
+    }
+
+    // Timestamps whose cached events have stale state counters, sorted and disjoint. Match counts stay exact,
+    // as the state counters of events are brought up to date before they are subtracted.
+    std::optional<std::size_t> replay_budget_;
+    std::vector<std::pair<std::size_t, std::size_t>> deferred_replays_;
+
+    void defer_replay(std::size_t first_timestamp, std::size_t last_timestamp) {
+        const auto first_overlapping = std::partition_point(deferred_replays_.begin(), deferred_replays_.end(), [&](const auto &range) { return range.second < first_timestamp; });
+        auto last_overlapping = first_overlapping;
+        while (last_overlapping != deferred_replays_.end() && last_overlapping->first <= last_timestamp) {
+            first_timestamp = std::min(first_timestamp, last_overlapping->first);
+            last_timestamp = std::max(last_timestamp, last_overlapping->second);
+            ++last_overlapping;
+        }
+
+        const auto position = deferred_replays_.erase(first_overlapping, last_overlapping);
+        deferred_replays_.insert(position, {first_timestamp, last_timestamp});
+    }
+
+    // Replays the deferred replays overlapping the given timestamps right away, e.g. before their state
+    // counters are read
+    void refresh_state_counters(std::size_t first_timestamp, std::size_t last_timestamp) {
+        if (deferred_replays_.empty())
+            return;
+
+        std::vector<std::pair<std::size_t, std::size_t>> remaining;
+        for (const auto &[first_deferred, last_deferred] : deferred_replays_) {
+            if (last_deferred < first_timestamp || first_deferred > last_timestamp) {
+                remaining.emplace_back(first_deferred, last_deferred);
+                continue;
+            }
+
+            recompute_deferred(std::max(first_deferred, first_timestamp), std::min(last_deferred, last_timestamp));
+            if (first_deferred < first_timestamp)
+                remaining.emplace_back(first_deferred, first_timestamp - 1);
+            if (last_deferred > last_timestamp)
+                remaining.emplace_back(last_timestamp + 1, last_deferred);
+        }
+
+        deferred_replays_ = std::move(remaining);
+    }
+
+    // Recomputing overwrites the state counters of the events between the timestamps, so those in the active
+    // window must be attached first. Replays of older events leave lazy aggregates detached.
+    void recompute_deferred(std::size_t first_timestamp, std::size_t last_timestamp) {
+        const auto window_end = active_window_.start_idx + active_window_.per_event_counters.size();
+        if (window_detached_ && first_index_not_older_than(first_timestamp) < window_end && first_index_past(last_timestamp) > active_window_.start_idx)
+            attach_window_counters();
+
+        recompute_state_counters(first_timestamp, last_timestamp);
+    }
+
+    bool has_deferred_replay_at(std::size_t timestamp) const {
+        return std::any_of(deferred_replays_.begin(), deferred_replays_.end(), [&](const auto &range) { return range.first <= timestamp && timestamp <= range.second; });
+    }
+
+    // Replays the events of the oldest deferred replays, about budget of them
+    void replay_deferred(std::size_t budget) {
+        while (budget > 0 && !deferred_replays_.empty()) {
+            auto &[first_timestamp, last_timestamp] = deferred_replays_.front();
+            const auto first_idx = first_index_not_older_than(first_timestamp);
+            const auto past_idx = first_index_past(last_timestamp);
+
+            if (past_idx - first_idx <= budget) {
+                recompute_deferred(first_timestamp, last_timestamp);
+                deferred_replays_.erase(deferred_replays_.begin());
+                budget -= std::min(budget, std::max<std::size_t>(past_idx - first_idx, 1));
+                continue;
+            }
+
+            // all events of the last timestamp are replayed, so the rest starts at the next one
+            const auto chunk_last_timestamp = timestamp_at(first_idx + budget - 1);
+            recompute_deferred(first_timestamp, chunk_last_timestamp);
+            if (chunk_last_timestamp < last_timestamp)
+                first_timestamp = chunk_last_timestamp + 1;
+            else
+                deferred_replays_.erase(deferred_replays_.begin());
+            budget = 0;
+        }
+    }
+
+    std::size_t first_index_past(std::size_t timestamp) const {
+        const auto first = std::partition_point(cache_.begin(), cache_.end(), [&](const auto &entry) { return entry.cached_event.timestamp <= timestamp; });
+        return static_cast<std::size_t>(first - cache_.begin());
+    }
+
+    std::vector<cache_entry<counter_type>> attached_cache() const {
+        auto entries = cache_;
+        if (window_detached_) {
+            for (std::size_t i = 0; i < active_window_.per_event_counters.size(); ++i)
+                entries[active_window_.start_idx + i].state_counter += active_window_.per_event_counters[i];
+        }
+
+        return entries;
+    }
+
+    // Runs crossing the boundary between this selector's part of the stream and the part a later selector
+    // processed are counted by replaying the events around the boundary in fresh selectors: the runs of the
+    // joint replay minus those of the replays of either side. Only events within one time window of the
+    // boundary take part, so merging costs as much as processing two time windows.
+    template <typename selector_type>
+    struct merge_boundary {
+        std::size_t tail_start = 0; // first entry of this cache within one time window of the later part
+        std::size_t head_size = 0;  // entries of the later cache within one time window of this part
+        std::unique_ptr<selector_type> joint, tail, head; // cached events only, for contained counts
+        std::unique_ptr<selector_type> joint_detected, head_detected; // all recorded events of the later part, if some are no longer cached
+    };
+
+    template <typename selector_type>
+    std::unique_ptr<selector_type> replay_in_fresh_selector(std::span<const event> events) const {
+        auto fresh = std::make_unique<selector_type>(query_, std::max<std::size_t>(events.size(), 1), time_window_size());
+        for (const auto &e : events)
+            fresh->process_event(e);
+        return fresh;
+    }
+
+    template <typename selector_type>
+    merge_boundary<selector_type> replay_boundary(const selector_type &later) const {
+        const summary_selector_base &other = later;
+        if (other.head_events_.empty() && !other.cache_.empty())
+            throw std::invalid_argument("Selectors can only be merged if merging was enabled on the later one");
+        if (compress_runs_ || other.compress_runs_)
+            throw std::invalid_argument("Selectors with run-length compression cannot be merged");
+        if (!deferred_replays_.empty() || !other.deferred_replays_.empty())
+            throw std::invalid_argument("Selectors can only be merged after completing their deferred replays");
+
+        merge_boundary<selector_type> boundary;
+        if (cache_.empty() || other.head_events_.empty())
+            return boundary;
+
+        boundary.tail_start = first_index_in_window_of(other.head_events_.front().timestamp);
+        boundary.head_size = other.first_index_past_window_of(current_time_);
+
+        std::vector<event> tail_events, head_events, recorded_head_events;
+        for (std::size_t idx = boundary.tail_start; idx < cache_.size(); ++idx)
+            tail_events.push_back(cache_[idx].cached_event);
+        for (std::size_t idx = 0; idx < boundary.head_size; ++idx)
+            head_events.push_back(other.cache_[idx].cached_event);
+        for (const auto &e : other.head_events_) {
+            if (in_shared_window(current_time_, e.timestamp))
+                recorded_head_events.push_back(e);
+        }
+
+        const auto concatenated = [&](const std::vector<event> &head) {
+            auto joint_events = tail_events;
+            joint_events.insert(joint_events.end(), head.begin(), head.end());
+            return joint_events;
+        };
+
+        boundary.joint = replay_in_fresh_selector<selector_type>(concatenated(head_events));
+        boundary.tail = replay_in_fresh_selector<selector_type>(tail_events);
+        boundary.head = replay_in_fresh_selector<selector_type>(head_events);
+        if (recorded_head_events != head_events) {
+            boundary.joint_detected = replay_in_fresh_selector<selector_type>(concatenated(recorded_head_events));
+            boundary.head_detected = replay_in_fresh_selector<selector_type>(recorded_head_events);
+        }
+
+        return boundary;
+    }
+
+    // Adds the counts of the later selector and of the runs across the boundary, and appends its cache
+    template <typename selector_type>
+    void merge_counts(const selector_type &later, const merge_boundary<selector_type> &boundary) {
+        const summary_selector_base &other = later;
+        total_counter_ += other.total_counter_;
+        total_detected_counter_ += other.total_detected_counter_;
+        number_of_reclaimed_entries_ += other.number_of_reclaimed_entries_;
+
+        const auto first_later_entry = cache_.size();
+        if (other.window_detached_) {
+            auto attached = other.attached_cache();
+            cache_.insert(cache_.end(), std::make_move_iterator(attached.begin()), std::make_move_iterator(attached.end()));
+        } else
+            cache_.insert(cache_.end(), other.cache_.begin(), other.cache_.end());
+
+        if (!boundary.joint)
             return;
 
+        const summary_selector_base &joint = *boundary.joint, &tail = *boundary.tail, &head = *boundary.head;
+        const summary_selector_base &joint_detected = boundary.joint_detected ? *boundary.joint_detected : joint;
+        const summary_selector_base &head_detected = boundary.head_detected ? *boundary.head_detected : head;
+
+        total_counter_ += joint.total_counter_ - tail.total_counter_ - head.total_counter_;
+        total_detected_counter_ += joint_detected.total_detected_counter_ - tail.total_detected_counter_ - head_detected.total_detected_counter_;
+
+        const auto tail_size = tail.cache_.size();
+        for (std::size_t idx = 0; idx < tail_size; ++idx)
+            cache_[boundary.tail_start + idx].state_counter += joint.cache_[idx].state_counter - tail.cache_[idx].state_counter;
+        for (std::size_t idx = 0; idx < boundary.head_size; ++idx)
+            cache_[first_later_entry + idx].state_counter += joint.cache_[tail_size + idx].state_counter - head.cache_[idx].state_counter;
+    }
+
+    void merge_head_and_time(const summary_selector_base &later) {
+        if (head_events_.empty())
+            head_events_ = later.head_events_;
+        else {
+            for (const auto &e : later.head_events_) {
+                if (e.timestamp - head_events_.front().timestamp <= time_window_size())
+                    head_events_.push_back(e);
+            }
+        }
+
+        current_time_ = std::max(current_time_, later.current_time_);
+    }
+
+    // The active window only depends on the events in it, so it is rebuilt by replaying them. Returns the
+    // selector used, for selectors with additional window state.
+    template <typename selector_type>
+    std::unique_ptr<selector_type> rebuild_active_window() {
+        const auto window_start = first_index_in_window_of(current_time_);
+
+        std::vector<event> window_events;
+        for (std::size_t idx = window_start; idx < cache_.size(); ++idx)
+            window_events.push_back(cache_[idx].cached_event);
+
+        auto fresh = replay_in_fresh_selector<selector_type>(window_events);
+        active_window_ = static_cast<const summary_selector_base &>(*fresh).active_window_;
+        active_window_.start_idx = window_start;
+
+        return fresh;
+    }
+
+    // Drops the oldest entries that do not fit and restores the capacity, which is the summary size
+    void shrink_cache_to(std::size_t summary_size) {
+        while (cache_.size() > summary_size)
+            remove_event(0);
+
+        if (cache_.capacity() != summary_size) {
+            std::vector<cache_entry<counter_type>> resized;
+            resized.reserve(summary_size);
+            std::move(cache_.begin(), cache_.end(), std::back_inserter(resized));
+            cache_ = std::move(resized);
+        }
+    }
+
+    static void write_event(std::ostream &out, const event &e) {
+        out << static_cast<int>(e.type) << ' ' << e.value << ' ' << e.timestamp << ' ' << e.key << '\n';
+    }
+
+    static event read_event(std::istream &in) {
+        int type;
+        event e{};
+        if (!(in >> type >> e.value >> e.timestamp >> e.key))
+            throw std::invalid_argument("Malformed selector state");
+        e.type = static_cast<char>(type);
+        return e;
+    }
+
+    static void write_counter(std::ostream &out, const execution_state_counter<counter_type> &counter) {
+        for (const auto &count : counter)
+            out << count << ' ';
+        out << '\n';
+    }
+
+    static void read_counter(std::istream &in, execution_state_counter<counter_type> &counter) {
+        for (auto &count : counter) {
+            if (!(in >> count))
+                throw std::invalid_argument("Malformed selector state");
+        }
+    }
+
+    // Text format, so states can be passed between processes and inspected
+    void write_base_state(std::ostream &out) const {
+        if (compress_runs_)
+            throw std::invalid_argument("The state of selectors with run-length compression cannot be written");
+        if (!deferred_replays_.empty())
+            throw std::invalid_argument("The state of selectors can only be written after completing their deferred replays");
+
+        out << "suse_selector_state " << state_format_version << ' ' << query_->automaton().number_of_states() << ' ' << time_window_size() << '\n';
+        out << current_time_ << ' ' << number_of_reclaimed_entries_ << '\n';
+
+        out << head_events_.size() << '\n';
+        for (const auto &e : head_events_)
+            write_event(out, e);
+
+        write_counter(out, total_counter_);
+        write_counter(out, total_detected_counter_);
+
+        out << cache_.size() << '\n';
+        for (const auto &entry : attached_cache()) {
+            write_event(out, entry.cached_event);
+            write_counter(out, entry.state_counter);
+        }
+    }
+
+    // Throws std::invalid_argument if the state is malformed or belongs to a different query or time window
+    void read_base_state(std::istream &in) {
+        std::string magic;
+        std::size_t version, number_of_states, window_size;
+        if (!(in >> magic >> version >> number_of_states >> window_size) || magic != "suse_selector_state" || version != state_format_version)
+            throw std::invalid_argument("Malformed selector state");
+        if (number_of_states != query_->automaton().number_of_states() || window_size != time_window_size())
+            throw std::invalid_argument("Selector state belongs to a different query or time window");
+
+        std::size_t number_of_head_events, number_of_entries;
+        if (!(in >> current_time_ >> number_of_reclaimed_entries_ >> number_of_head_events))
+            throw std::invalid_argument("Malformed selector state");
+
+        head_events_.clear();
+        for (std::size_t idx = 0; idx < number_of_head_events; ++idx)
+            head_events_.push_back(read_event(in));
+
+        read_counter(in, total_counter_);
+        read_counter(in, total_detected_counter_);
+
+        if (!(in >> number_of_entries))
+            throw std::invalid_argument("Malformed selector state");
+
+        cache_.clear();
+        window_detached_ = false;
+        deferred_replays_.clear();
+        for (std::size_t idx = 0; idx < number_of_entries; ++idx) {
+            const auto cached_event = read_event(in);
+            cache_.push_back({cached_event, execution_state_counter<counter_type>{number_of_states}});
+            read_counter(in, cache_.back().state_counter);
+        }
+    }
+
+    static constexpr std::size_t state_format_version = 1;
+
+    // Hook for selectors keeping additional per-entry state in lockstep with cache_.
+    virtual void erase_additional_entries(const std::vector<bool> &) {}
+
+    template <typename entry_type>
+    static void erase_flagged(std::vector<entry_type> &entries, const std::vector<bool> &flagged) {
+        assert(entries.size() == flagged.size());
+
+        std::size_t kept = 0;
+        for (std::size_t idx = 0; idx < entries.size(); ++idx) {
+            if (flagged[idx])
+                continue;
+            if (kept != idx)
+                entries[kept] = std::move(entries[idx]);
+            ++kept;
+        }
+        entries.erase(entries.begin() + kept, entries.end());
+    }
+
+    // Events that left the active window cannot be part of any future run. If no run of the cached events
+    // passes through them by now, none ever will, and they can be dropped without replaying anything. An
+    // all-zero counter is only a cheap first check; the runs containing them are counted before dropping them.
+    void reclaim_dead_entries(std::size_t previous_window_start_idx) {
+        const auto is_zero = [](const execution_state_counter<counter_type> &counter) {
+            return std::all_of(counter.begin(), counter.end(), [](const auto &count) { return count == 0; });
+        };
+        const auto is_dead = [&](std::size_t idx) {
+            if (!is_zero(cache_[idx].state_counter))
+                return false;
+
+            std::vector<std::size_t> removed_per_entry(cache_.size(), 0);
+            removed_per_entry[idx] = cache_[idx].multiplicity;
+            return is_zero(runs_containing_any(removed_per_entry, idx, idx));
+        };
+
+        if (previous_window_start_idx < active_window_.start_idx)
+            refresh_state_counters(timestamp_at(previous_window_start_idx), timestamp_at(active_window_.start_idx - 1));
+
+        std::vector<bool> flagged(cache_.size(), false);
+        std::size_t number_of_dead = 0;
+        for (std::size_t idx = previous_window_start_idx; idx < active_window_.start_idx; ++idx) {
+            if (is_dead(idx)) {
+                flagged[idx] = true;
+                ++number_of_dead;
+                number_of_compressed_events_ -= cache_[idx].multiplicity - 1;
+                number_of_reclaimed_entries_ += cache_[idx].multiplicity;
+            }
+        }
+
+        if (number_of_dead == 0)
+            return;
+
+        erase_flagged(cache_, flagged);
+        erase_additional_entries(flagged);
+        active_window_.start_idx -= number_of_dead;
+    }
+
+    // Expired events form a prefix of the cache and are purged together: the runs containing any of them are
+    // subtracted at once and the counters of the remaining entries are recomputed by a single replay, which
+    // covers the affected ranges of all expired events. Returns whether any event expired.
+    bool purge_expired() {
+        const auto is_expired = [&](const cache_entry<counter_type> &entry) { return current_time() - entry.cached_event.timestamp > time_to_live_; };
+        const auto purge_until = static_cast<std::size_t>(std::partition_point(cache_.begin(), cache_.end(), is_expired) - cache_.begin());
+
+        if (purge_until == 0)
+            return false;
+
+        attach_window_counters();
+
+        // a single event is the first event of all runs containing it
+        if (purge_until == 1 && cache_.front().multiplicity == 1 && !has_deferred_replay_at(timestamp_at(0)))
+            total_counter_ -= cache_.front().state_counter;
+        else
+            total_counter_ -= runs_starting_in_prefix(purge_until);
+        for (std::size_t idx = 0; idx < purge_until; ++idx) {
+            number_of_compressed_events_ -= cache_[idx].multiplicity - 1;
+            update_stats([&](auto &stats) { stats.expiries += cache_[idx].multiplicity; });
+        }
+
+        // remaining events are younger than all expired ones, so those within one time window of the youngest
+        // expired event are exactly the ones affected by any of them
+        update_stats([](auto &stats) { ++stats.purge_replays; });
+        const auto [first_affected_timestamp, last_affected_timestamp] = affected_timestamps(timestamp_at(purge_until - 1), timestamp_at(purge_until - 1));
+        replay_timestamps(first_affected_timestamp, last_affected_timestamp, purge_until);
+
         cache_.erase(cache_.begin(), cache_.begin() + purge_until);
 
         if (cache_.empty()) {
             active_window_.start_idx = 0;
             reset_counters(active_window_);
-            return;
+            return true;
         }
 
         if (purge_until < active_window_.start_idx)
             active_window_.start_idx -= purge_until;
         else {
-            active_window_.start_idx = cache_.size() > time_window_size() ? cache_.size() - time_window_size() : 0;
+            active_window_.start_idx = first_index_in_window_of(current_time_);
             replay_time_window(active_window_, std::span{cache_.begin() + active_window_.start_idx, cache_.end()});
         }
+        return true;
+    }
+
+    // Runs whose first event is one of the first prefix_size entries. As these are the oldest entries, these
+    // are all runs containing any of them.
+    execution_state_counter<counter_type> runs_starting_in_prefix(std::size_t prefix_size) const {
+        const auto number_of_states = query_->automaton().number_of_states();
+        const scratch_scope scope{*this};
+        const auto scratch = scratch_allocator();
+
+        execution_state_counter<counter_type> initial{number_of_states, scratch}, runs{number_of_states};
+        initial[query_->automaton().initial_state_id()] = 1;
+
+        // per entry of the prefix, the runs starting at it that can still be extended
+        std::pmr::vector<execution_state_counter<counter_type>> open_runs{scratch};
+        std::size_t first_open = 0;
+
+        for (std::size_t idx = 0; idx < cache_.size(); ++idx) {
+            while (first_open < std::min(idx, prefix_size) && !in_shared_window(timestamp_at(idx), timestamp_at(first_open)))
+                ++first_open;
+            if (idx >= prefix_size && first_open == prefix_size)
+                break;
+
+            const auto run = cache_[idx].multiplicity > 1 ? std::optional{advance_for_run(cache_[idx])} : std::nullopt;
+            const auto change_of = [&](const execution_state_counter<counter_type> &counter) {
+                count_advances(1);
+                return run ? run->total_change(counter, scratch) : advance(counter, query_->transitions(), cache_[idx].cached_event.type, scratch);
+            };
+
+            for (std::size_t open = first_open; open < open_runs.size(); ++open) {
+                const auto change = change_of(open_runs[open]);
+                open_runs[open] += change;
+                runs += change;
+            }
+
+            if (idx < prefix_size) {
+                open_runs.push_back(change_of(initial));
+                runs += open_runs.back();
+            }
+        }
+
+        return runs;
     }
 
-    void update_window(window_info &window, std::size_t timestamp) {
-        const auto &initial_state = automaton_.states()[automaton_.initial_state_id()];
+    // Runs containing at least one of the events to remove, given as the number of removed events per entry.
+    // Such runs lie within one time window of the oldest and the youngest removed event. Among the entries
+    // there, all runs are counted once as is and once without the removed events; the difference is the result.
+    execution_state_counter<counter_type> runs_containing_any(const std::vector<std::size_t> &removed_per_entry, std::size_t oldest_removed_idx, std::size_t youngest_removed_idx) const {
+        const auto number_of_states = query_->automaton().number_of_states();
+        const auto youngest_removed_timestamp = timestamp_at(youngest_removed_idx);
+
+        const scratch_scope scope{*this};
+        const auto scratch = scratch_allocator();
+
+        execution_state_counter<counter_type> initial{number_of_states, scratch}, all_runs{number_of_states}, kept_runs{number_of_states, scratch};
+        initial[query_->automaton().initial_state_id()] = 1;
+
+        // per entry, the runs starting at it that can still be extended, with and without the removed events
+        std::pmr::vector<execution_state_counter<counter_type>> open_runs{scratch}, open_kept_runs{scratch};
+        const auto first_idx = first_index_in_window_of(timestamp_at(oldest_removed_idx), 0, oldest_removed_idx);
+        auto first_open = first_idx;
+
+        for (std::size_t idx = first_idx; idx < cache_.size(); ++idx) {
+            if (timestamp_at(idx) > youngest_removed_timestamp && !in_shared_window(youngest_removed_timestamp, timestamp_at(idx)))
+                break;
+            while (first_open < idx && !in_shared_window(timestamp_at(idx), timestamp_at(first_open)))
+                ++first_open;
+
+            const auto &entry = cache_[idx];
+            const auto kept_multiplicity = entry.multiplicity - removed_per_entry[idx];
+            const auto repeated = [&](std::size_t multiplicity) {
+                return repeated_advance<counter_type, transitions_type>{query_->transitions(), number_of_states, entry.cached_event.type, multiplicity};
+            };
+            const auto run = entry.multiplicity > 1 ? std::optional{repeated(entry.multiplicity)} : std::nullopt;
+            const auto kept_run = kept_multiplicity > 1 ? std::optional{repeated(kept_multiplicity)} : std::nullopt;
+
+            const auto change_of = [&](const execution_state_counter<counter_type> &counter) {
+                count_advances(1);
+                return run ? run->total_change(counter, scratch) : advance(counter, query_->transitions(), entry.cached_event.type, scratch);
+            };
+            const auto kept_change_of = [&](const execution_state_counter<counter_type> &counter) {
+                if (kept_multiplicity == 0)
+                    return execution_state_counter<counter_type>{number_of_states, scratch};
+                count_advances(1);
+                return kept_run ? kept_run->total_change(counter, scratch) : advance(counter, query_->transitions(), entry.cached_event.type, scratch);
+            };
+
+            for (std::size_t open = first_open - first_idx; open < open_runs.size(); ++open) {
+                const auto change = change_of(open_runs[open]);
+                open_runs[open] += change;
+                all_runs += change;
+
+                const auto kept_change = kept_change_of(open_kept_runs[open]);
+                open_kept_runs[open] += kept_change;
+                kept_runs += kept_change;
+            }
 
-        bool removed_initiator = false;
-        while (!window.per_event_counters.empty() && !in_shared_window(timestamp, timestamp_at(window.start_idx))) {
-            const auto type = cache_[window.start_idx++].cached_event.type;
-            removed_initiator |= initial_state.transitions.contains(type) || initial_state.transitions.contains(nfa::wildcard_symbol);
-            window.per_event_counters.pop_front();
+            open_runs.push_back(change_of(initial));
+            all_runs += open_runs.back();
+            open_kept_runs.push_back(kept_change_of(initial));
+            kept_runs += open_kept_runs.back();
         }
 
+        all_runs -= kept_runs;
+        return all_runs;
+    }
+
+    // returns whether any event left the window
+    bool update_window(window_info &window, std::size_t timestamp) {
+        const auto window_end = window.start_idx + window.per_event_counters.size();
+        const auto new_start_idx = first_index_in_window_of(timestamp, window.start_idx, window_end);
+        if (new_start_idx == window.start_idx)
+            return false;
+
+        const auto removed = std::span{cache_.begin() + window.start_idx, cache_.begin() + new_start_idx};
+        const auto removed_initiator = std::any_of(removed.begin(), removed.end(), [&](const auto &entry) { return query_->is_initiator(entry.cached_event.type); });
+
+        window.per_event_counters.pop_front(new_start_idx - window.start_idx);
+        window.start_idx = new_start_idx;
+
         if (removed_initiator)
             replay_time_window(window);
+        return true;
     }
 
     void replay_time_window(window_info &window) const {
@@ -194,69 +1089,148 @@ class summary_selector_base {
     }
 
     void replay_time_window(window_info &window, std::span<const cache_entry<counter_type>> events) const {
+        const auto start = trace_start();
+        const scratch_scope scope{*this};
+        const auto scratch = scratch_allocator();
         reset_counters(window);
+        update_stats([&](auto &stats) {
+            stats.window_replays += &window == &active_window_;
+            stats.replayed_entries += events.size();
+        });
 
         for (std::size_t i = 0; i < events.size(); ++i) {
+            count_advances(i + 1);
+            if (events[i].multiplicity > 1) {
+                const auto run = advance_for_run(events[i]);
+                auto counter_per_event = run.last_change(window.total_counter, scratch);
+                window.total_counter += run.total_change(window.total_counter, scratch);
+                for (std::size_t j = 0; j < i; ++j)
+                    window.per_event_counters[j] += run.total_change(window.per_event_counters[j], scratch);
+                window.per_event_counters.push_back(std::move(counter_per_event));
+                continue;
+            }
+
             const auto to_readd = events[i].cached_event.type;
-            auto global_counter_change = advance(window.total_counter, per_character_edges_, to_readd);
+            auto global_counter_change = advance(window.total_counter, query_->transitions(), to_readd, scratch);
             window.total_counter += global_counter_change;
             for (std::size_t j = 0; j < i; ++j) {
-                const auto local_change = advance(window.per_event_counters[j], per_character_edges_, to_readd);
+                const auto local_change = advance(window.per_event_counters[j], query_->transitions(), to_readd, scratch);
                 window.per_event_counters[j] += local_change;
             }
             window.per_event_counters.push_back(std::move(global_counter_change));
         }
+
+        if (&window == &active_window_)
+            trace_span("replay_window", start, {{"entries", events.size()}});
     }
 
-    void replay_affected_range(std::size_t removed_idx, std::size_t removed_timestamp) {
-        auto replay_start_idx = removed_idx < time_window_size() ? 0 : removed_idx - time_window_size();
-        while (replay_start_idx < cache_.size() && !in_shared_window(removed_timestamp, timestamp_at(replay_start_idx)))
-            ++replay_start_idx;
+    // Entries before first_idx are ignored, e.g. because they are about to be purged
+    void replay_affected_range(std::size_t removed_idx, std::size_t removed_timestamp, std::size_t first_idx = 0) {
+        replay_affected_range(removed_idx, removed_timestamp, removed_timestamp, first_idx);
+    }
 
-        const auto replay_start_timestamp = timestamp_at(replay_start_idx);
+    // For events removed at once between the given timestamps, removed_idx being the index of the oldest.
+    // Events within one time window of them are affected.
+    void replay_affected_range(std::size_t removed_idx, std::size_t oldest_removed_timestamp, std::size_t youngest_removed_timestamp, std::size_t first_idx) {
+        update_stats([](auto &stats) { ++stats.affected_range_replays; });
+        const auto [first_affected_timestamp, last_affected_timestamp] = affected_timestamps(oldest_removed_timestamp, youngest_removed_timestamp);
+        replay_timestamps(first_affected_timestamp, last_affected_timestamp, first_idx);
+    }
+
+    // Events within one time window of removed events are affected
+    std::pair<std::size_t, std::size_t> affected_timestamps(std::size_t oldest_removed_timestamp, std::size_t youngest_removed_timestamp) const {
+        return {oldest_removed_timestamp - std::min(oldest_removed_timestamp, time_window_size_), youngest_removed_timestamp + std::min(std::numeric_limits<std::size_t>::max() - youngest_removed_timestamp, time_window_size_)};
+    }
+
+    // Replays the events between the given timestamps right away, or defers it with a replay budget
+    void replay_timestamps(std::size_t first_affected_timestamp, std::size_t last_affected_timestamp, std::size_t first_idx) {
+        if (replay_budget_)
+            defer_replay(first_affected_timestamp, last_affected_timestamp);
+        else
+            recompute_state_counters(first_affected_timestamp, last_affected_timestamp, first_idx);
+    }
+
+    // Recomputes the state counters of the events between the given timestamps from the cached events
+    void recompute_state_counters(std::size_t first_affected_timestamp, std::size_t last_affected_timestamp, std::size_t first_idx = 0) {
+        const auto is_affected = [&](std::size_t timestamp) {
+            return timestamp >= first_affected_timestamp && timestamp <= last_affected_timestamp;
+        };
+
+        const auto replay_start_idx = first_index_not_older_than(first_affected_timestamp, first_idx);
+        if (replay_start_idx == cache_.size() || !is_affected(timestamp_at(replay_start_idx)))
+            return;
+        const auto start = trace_start();
 
-        auto time_window_replay_start_idx = replay_start_idx < time_window_size() ? 0 : replay_start_idx - time_window_size();
-        while (time_window_replay_start_idx < cache_.size() && !in_shared_window(replay_start_timestamp, timestamp_at(time_window_replay_start_idx)))
-            ++time_window_replay_start_idx;
+        const auto replay_start_timestamp = timestamp_at(replay_start_idx);
+        const auto time_window_replay_start_idx = first_index_in_window_of(replay_start_timestamp, first_idx, replay_start_idx);
 
-        auto replay_window = create_window_info(time_window_size());
+        // declared first, so that the scratch memory is reset only after the replay window is gone
+        const scratch_scope scope{*this};
+        const auto scratch = scratch_allocator();
+        auto replay_window = create_window_info(time_window_size(), scratch);
         replay_window.start_idx = time_window_replay_start_idx;
         const auto relevant_prefix = std::span{cache_.begin() + replay_window.start_idx, cache_.begin() + replay_start_idx};
         replay_time_window(replay_window, relevant_prefix);
 
+        // later events cannot be part of runs containing affected events
         const auto is_relevant = [&](std::size_t idx) {
-            const auto affected = in_shared_window(removed_timestamp, timestamp_at(idx));
-            const auto in_affecting_window = in_shared_window(removed_timestamp, timestamp_at(replay_window.start_idx));
-
-            return affected || in_affecting_window;
+            return timestamp_at(idx) <= last_affected_timestamp || in_shared_window(last_affected_timestamp, timestamp_at(idx));
         };
 
-        for (std::size_t idx = replay_start_idx; idx < cache_.size() && is_relevant(idx); ++idx) {
+        auto idx = replay_start_idx;
+        for (; idx < cache_.size() && is_relevant(idx); ++idx) {
             update_window(replay_window, timestamp_at(idx));
 
-            auto global_counter_change = advance(replay_window.total_counter, per_character_edges_, cache_[idx].cached_event.type);
-            replay_window.total_counter += global_counter_change;
+            const auto run = cache_[idx].multiplicity > 1 ? std::optional{advance_for_run(cache_[idx])} : std::nullopt;
+            const auto change_of = [&](const execution_state_counter<counter_type> &counter) {
+                return run ? run->total_change(counter, scratch) : advance(counter, query_->transitions(), cache_[idx].cached_event.type, scratch);
+            };
+
+            // for runs, the change of the window differs from the counter of each of their events
+            auto global_counter_change = run ? run->last_change(replay_window.total_counter, scratch) : change_of(replay_window.total_counter);
+            if (run)
+                replay_window.total_counter += run->total_change(replay_window.total_counter, scratch);
+            else
+                replay_window.total_counter += global_counter_change;
 
             const auto active_window_size = idx - replay_window.start_idx;
             for (std::size_t i = 0; i < active_window_size; ++i) {
                 const auto cache_idx = replay_window.start_idx + i;
 
-                const auto local_change = advance(replay_window.per_event_counters[i], per_character_edges_, cache_[idx].cached_event.type);
-                if (cache_idx >= replay_start_idx && in_shared_window(removed_timestamp, timestamp_at(cache_idx)))
+                const auto local_change = change_of(replay_window.per_event_counters[i]);
+                if (cache_idx >= replay_start_idx && is_affected(timestamp_at(cache_idx)))
                     cache_[cache_idx].state_counter += local_change;
                 replay_window.per_event_counters[i] += local_change;
             }
 
             replay_window.per_event_counters.push_back(global_counter_change);
-            if (in_shared_window(removed_timestamp, timestamp_at(idx)))
+            if (is_affected(timestamp_at(idx)))
                 cache_[idx].state_counter = std::move(global_counter_change);
+
+            count_advances(active_window_size + 1);
+            update_stats([](auto &stats) { ++stats.replayed_entries; });
         }
+
+        trace_span("replay_affected_range", start, {{"first_timestamp", first_affected_timestamp}, {"last_timestamp", last_affected_timestamp}, {"entries", idx - time_window_replay_start_idx}});
+    }
+
+    bool joins_last_run(const event &new_event) const {
+        if (!compress_runs_ || cache_.size() <= active_window_.start_idx)
+            return false;
+
+        const auto &last = cache_.back().cached_event;
+        return last.type == new_event.type && last.timestamp == new_event.timestamp;
+    }
+
+    auto advance_for_run(const cache_entry<counter_type> &entry) const {
+        return repeated_advance<counter_type, transitions_type>{query_->transitions(), query_->automaton().number_of_states(), entry.cached_event.type, entry.multiplicity};
     }
 
-    auto create_window_info(std::size_t window_size) const {
+    auto create_window_info(std::size_t window_size, const std::pmr::polymorphic_allocator<> &allocator = {}) const {
+        const auto number_of_states = query_->automaton().number_of_states();
         window_info wnd{
-            execution_state_counter<counter_type>{automaton_.number_of_states()},
-            ring_buffer<execution_state_counter<counter_type>>{window_size, execution_state_counter<counter_type>{automaton_.number_of_states()}},
+            execution_state_counter<counter_type>{number_of_states, allocator},
+            ring_buffer<execution_state_counter<counter_type>>{window_size, execution_state_counter<counter_type>{number_of_states, allocator}, allocator},
             0
         };
 
@@ -266,10 +1240,31 @@ class summary_selector_base {
 
     void reset_counters(window_info &window) const {
         window.total_counter *= 0; // performance!
-        window.total_counter[automaton_.initial_state_id()] = 1;
+        window.total_counter[query_->automaton().initial_state_id()] = 1;
         window.per_event_counters.clear();
     }
 
+    // The cache is ordered by timestamp, so window boundaries are found by binary search instead of walking
+    // the cache. Returns the first index in [from, to) within one time window of timestamp, which must not be
+    // older than any entry in the range.
+    std::size_t first_index_in_window_of(std::size_t timestamp, std::size_t from = 0, std::size_t to = std::numeric_limits<std::size_t>::max()) const {
+        const auto end = cache_.begin() + std::min(to, cache_.size());
+        const auto first = std::partition_point(cache_.begin() + from, end, [&](const auto &entry) { return !in_shared_window(timestamp, entry.cached_event.timestamp); });
+        return static_cast<std::size_t>(first - cache_.begin());
+    }
+
+    // Returns the first index past all entries within one time window of timestamp, which must not be younger
+    // than any entry in the cache.
+    std::size_t first_index_past_window_of(std::size_t timestamp) const {
+        const auto first = std::partition_point(cache_.begin(), cache_.end(), [&](const auto &entry) { return in_shared_window(timestamp, entry.cached_event.timestamp); });
+        return static_cast<std::size_t>(first - cache_.begin());
+    }
+
+    std::size_t first_index_not_older_than(std::size_t timestamp, std::size_t from = 0) const {
+        const auto first = std::partition_point(cache_.begin() + from, cache_.end(), [&](const auto &entry) { return entry.cached_event.timestamp < timestamp; });
+        return static_cast<std::size_t>(first - cache_.begin());
+    }
+
     std::size_t timestamp_at(std::size_t cache_idx) const {
         assert(cache_idx < cache_.size());
 
@@ -277,12 +1272,10 @@ class summary_selector_base {
     }
 
     bool in_shared_window(std::size_t timestamp0, std::size_t timestamp1) const {
-        const auto time_window_size = active_window_.per_event_counters.capacity();
-
         if (timestamp1 > timestamp0)
             std::swap(timestamp0, timestamp1);
 
-        return timestamp0 - timestamp1 <= time_window_size;
+        return timestamp0 - timestamp1 <= time_window_size_;
     }
 
     counter_type sum_over_complete_matches(const execution_state_counter<counter_type> &counter) const {
@@ -290,7 +1283,7 @@ class summary_selector_base {
 
         counter_type sum{0};
         for (std::size_t i = 0; i < counter.size(); ++i) {
-            if (this->automaton_.states()[i].is_final)
+            if (query_->is_final(i))
                 sum += counter[i];
         }
 
@@ -302,7 +1295,7 @@ class summary_selector_base {
 
         counter_type sum{0};
         for (std::size_t i = 0; i < counter.size(); ++i) {
-            if (!this->automaton_.states()[i].is_final)
+            if (!query_->is_final(i))
                 sum += counter[i];
         }
 
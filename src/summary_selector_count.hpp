@@ -1,6 +1,7 @@
 #ifndef SUSE_SUMMARY_SELECTOR_COUNT_HPP
 #define SUSE_SUMMARY_SELECTOR_COUNT_HPP
 
+#include "compiled_query.hpp"
 #include "edgelist.hpp"
 #include "event.hpp"
 #include "execution_state_counter.hpp"
@@ -8,10 +9,16 @@
 #include "ring_buffer.hpp"
 #include "summary_selector_base.hpp"
 
+#include <algorithm>
+#include <cassert>
 #include <concepts>
+#include <istream>
 #include <limits>
+#include <memory>
 #include <optional>
+#include <ostream>
 #include <span>
+#include <stdexcept>
 #include <string_view>
 #include <unordered_map>
 #include <vector>
@@ -20,17 +27,74 @@
 
 namespace suse {
 
-template <typename counter_type>
-class summary_selector_count : public summary_selector_base<counter_type> {
+template <typename counter_type, typename transitions_type = edgelist>
+class summary_selector_count : public summary_selector_base<counter_type, transitions_type> {
   public:
-    summary_selector_count(std::string_view query, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live = std::numeric_limits<std::size_t>::max())
-        : summary_selector_base<counter_type>(query, summary_size, time_window_size, time_to_live) {}
+    summary_selector_count(std::string_view query, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live = std::numeric_limits<std::size_t>::max(), const regex_options &options = {})
+        : summary_selector_count(parse_regex(query, options), summary_size, time_window_size, time_to_live) {}
+
+    summary_selector_count(const nfa &automaton, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live = std::numeric_limits<std::size_t>::max())
+        : summary_selector_count(std::make_shared<const compiled_query<transitions_type>>(automaton), summary_size, time_window_size, time_to_live) {}
+
+    // For automatons and transitions that were compiled ahead of time, e.g. loaded from a query_artifact
+    summary_selector_count(nfa automaton, transitions_type transitions, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live = std::numeric_limits<std::size_t>::max())
+        : summary_selector_count(std::make_shared<const compiled_query<transitions_type>>(std::move(automaton), std::move(transitions)), summary_size, time_window_size, time_to_live) {}
+
+    // Shares the compiled query, e.g. with the selectors of other partition keys
+    summary_selector_count(std::shared_ptr<const compiled_query<transitions_type>> query, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live = std::numeric_limits<std::size_t>::max())
+        : summary_selector_base<counter_type, transitions_type>(std::move(query), summary_size, time_window_size, time_to_live) {}
+
+    // Consecutive events of the same type and timestamp are cached as one entry with a multiplicity, as all
+    // of them have the same counters, which saves memory and work on bursty streams. Runs still take up one
+    // slot of the summary per event and remove_event removes one event of a run, so counts for the same cached
+    // events are unchanged. Eviction strategies see one entry per run, though: fifo evicts the same events,
+    // but suse scores a whole run once and can evict other events, which changes the counts.
+    // Must be enabled before the first event.
+    void enable_run_length_compression(bool enabled = true) {
+        this->compress_runs_ = enabled;
+    }
+
+    // add_event then only maintains what later events need, and the state counters of cached events are
+    // brought up to date when something reads them: an eviction strategy unless it declares otherwise (see
+    // strategy_reads_state_counters), removals, purges and merges. Counts are unchanged. Pays off if the
+    // active window is replayed less often than every other event. Must be enabled before the first event.
+    void enable_lazy_aggregates(bool enabled = true) {
+        this->lazy_aggregates_ = enabled;
+    }
+
+    // Caps the work of replaying the events affected by removals, which otherwise happens right away and may
+    // take far longer than processing an event. Replays are deferred and about budget of the affected events
+    // are replayed per processed event, plus up to one time window around them, oldest first. Match counts
+    // stay exact for the cached events, as the state counters of removed events are brought up to date first.
+    // The active window is still replayed right away. Until number_of_deferred_entries() drops to zero,
+    // eviction strategies may see outdated state counters; complete_deferred_replays() replays all of them,
+    // e.g. before merging. Strategies that read them, like suse, can thus evict other events than with
+    // immediate replays, and counts can differ from those even after all replays completed.
+    // Throws std::invalid_argument if budget is zero.
+    void enable_deferred_replays(std::size_t budget) {
+        if (budget == 0)
+            throw std::invalid_argument("The replay budget must be positive");
+
+        this->replay_budget_ = budget;
+    }
 
     void remove_event(std::size_t cache_index) override {
         assert(cache_index < this->cache_.size());
+        this->attach_window_counters();
+        this->refresh_state_counters(this->timestamp_at(cache_index), this->timestamp_at(cache_index));
 
         this->total_counter_ -= this->cache_[cache_index].state_counter;
         const auto removed_timestamp = this->timestamp_at(cache_index);
+
+        if (this->cache_[cache_index].multiplicity > 1) {
+            --this->cache_[cache_index].multiplicity;
+            --this->number_of_compressed_events_;
+            this->replay_affected_range(cache_index, removed_timestamp);
+            if (this->in_shared_window(this->current_time_, removed_timestamp))
+                this->replay_time_window(this->active_window_, std::span{this->cache_.begin() + this->active_window_.start_idx, this->cache_.end()});
+            return;
+        }
+
         if (cache_index < this->active_window_.start_idx)
             --this->active_window_.start_idx;
 
@@ -47,23 +111,124 @@ class summary_selector_count : public summary_selector_base<counter_type> {
             this->replay_time_window(this->active_window_, std::span{this->cache_.begin() + this->active_window_.start_idx, this->cache_.end()});
     }
 
+    // Subtracts the runs containing any of the events at once and replays the union of their affected ranges
+    // in a single pass, instead of one replay per event.
+    void remove_events(std::vector<std::size_t> cache_indices) override {
+        if (cache_indices.size() <= 1) {
+            if (!cache_indices.empty())
+                remove_event(cache_indices.front());
+            return;
+        }
+
+        this->attach_window_counters();
+        const auto [oldest, youngest] = std::minmax_element(cache_indices.begin(), cache_indices.end());
+        const auto oldest_removed_idx = *oldest, youngest_removed_idx = *youngest;
+        assert(youngest_removed_idx < this->cache_.size());
+
+        std::vector<std::size_t> removed_per_entry(this->cache_.size(), 0);
+        for (auto cache_index : cache_indices)
+            ++removed_per_entry[cache_index];
+
+        this->total_counter_ -= this->runs_containing_any(removed_per_entry, oldest_removed_idx, youngest_removed_idx);
+        const auto oldest_removed_timestamp = this->timestamp_at(oldest_removed_idx);
+        const auto youngest_removed_timestamp = this->timestamp_at(youngest_removed_idx);
+
+        std::vector<bool> flagged(this->cache_.size(), false);
+        std::size_t erased_before_window = 0;
+        for (std::size_t idx = oldest_removed_idx; idx <= youngest_removed_idx; ++idx) {
+            auto &entry = this->cache_[idx];
+            assert(removed_per_entry[idx] <= entry.multiplicity);
+
+            if (removed_per_entry[idx] < entry.multiplicity) {
+                entry.multiplicity -= removed_per_entry[idx];
+                this->number_of_compressed_events_ -= removed_per_entry[idx];
+                continue;
+            }
+
+            flagged[idx] = true;
+            this->number_of_compressed_events_ -= entry.multiplicity - 1;
+            if (idx < this->active_window_.start_idx)
+                ++erased_before_window;
+        }
+
+        this->erase_flagged(this->cache_, flagged);
+        this->active_window_.start_idx -= erased_before_window;
+
+        if (this->cache_.empty()) {
+            this->active_window_.start_idx = 0;
+            this->reset_counters(this->active_window_);
+            return;
+        }
+
+        this->replay_affected_range(oldest_removed_idx, oldest_removed_timestamp, youngest_removed_timestamp, 0);
+        if (this->in_shared_window(this->current_time_, youngest_removed_timestamp))
+            this->replay_time_window(this->active_window_, std::span{this->cache_.begin() + this->active_window_.start_idx, this->cache_.end()});
+    }
+
     void add_event(const event &new_event) override {
-        auto global_counter_change = advance(this->active_window_.total_counter, this->per_character_edges_, new_event.type);
+        auto global_counter_change = advance(this->active_window_.total_counter, this->query_->transitions(), new_event.type);
         this->active_window_.total_counter += global_counter_change;
         this->total_counter_ += global_counter_change;
         this->total_detected_counter_ += global_counter_change;
 
+        this->detach_window_counters();
         const auto active_window_size = this->cache_.size() - this->active_window_.start_idx;
+        this->count_advances(active_window_size + 1);
+        const typename summary_selector_base<counter_type, transitions_type>::scratch_scope scope{*this};
+        const auto scratch = this->scratch_allocator();
         for (std::size_t i = 0; i < active_window_size; ++i) {
             const auto cache_idx = this->active_window_.start_idx + i;
 
-            const auto local_change = advance(this->active_window_.per_event_counters[i], this->per_character_edges_, new_event.type);
-            this->cache_[cache_idx].state_counter += local_change;
+            const auto local_change = advance(this->active_window_.per_event_counters[i], this->query_->transitions(), new_event.type, scratch);
+            if (!this->window_detached_)
+                this->cache_[cache_idx].state_counter += local_change;
             this->active_window_.per_event_counters[i] += local_change;
         }
 
+        // the events of a run are exchangeable, so their counters already equal those of the new one
+        if (this->joins_last_run(new_event)) {
+            assert(this->window_detached_ || this->cache_.back().state_counter == global_counter_change);
+            assert(this->active_window_.per_event_counters[active_window_size - 1] == global_counter_change);
+
+            ++this->cache_.back().multiplicity;
+            ++this->number_of_compressed_events_;
+            return;
+        }
+
         this->active_window_.per_event_counters.push_back(global_counter_change);
-        this->cache_.emplace_back(new_event, std::move(global_counter_change));
+        if (this->window_detached_)
+            this->cache_.emplace_back(new_event, execution_state_counter<counter_type>{this->query_->automaton().number_of_states()});
+        else
+            this->cache_.emplace_back(new_event, std::move(global_counter_change));
+    }
+
+    // Combines selectors that processed consecutive parts of a stream, e.g. shards processed in parallel.
+    // Afterwards, earlier reports the matches of the whole stream and continues where later stopped. Merging
+    // must be enabled on later. Counts equal those of processing the stream with one selector as long as
+    // neither selector evicted events within one time window of the boundary.
+    friend void merge(summary_selector_count &earlier, const summary_selector_count &later) {
+        earlier.attach_window_counters();
+        earlier.complete_deferred_replays();
+        const auto summary_size = earlier.cache_.capacity();
+        const auto boundary = earlier.replay_boundary(later);
+
+        earlier.merge_counts(later, boundary);
+        earlier.merge_head_and_time(later);
+        earlier.template rebuild_active_window<summary_selector_count>();
+        earlier.shrink_cache_to(summary_size);
+    }
+
+    // State needed to merge this selector in another process
+    void write_state(std::ostream &out) const {
+        this->write_base_state(out);
+    }
+
+    // Throws std::invalid_argument if the state is malformed or belongs to a different query or time window
+    void read_state(std::istream &in) {
+        const auto summary_size = this->cache_.capacity();
+        this->read_base_state(in);
+        this->template rebuild_active_window<summary_selector_count>();
+        this->shrink_cache_to(summary_size);
     }
 
     counter_type number_of_contained_complete_matches() const {
@@ -1,9 +1,22 @@
+#include "eviction_strategies.hpp"
 #include "summary_selector_count.hpp"
+#include "trace_writer.hpp"
 
 #include <boost/multiprecision/cpp_int.hpp>
 
 #include <doctest/doctest.h>
 
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
 TEST_SUITE("suse::summary_selector_count") {
     TEST_CASE("simple, irrelevant time window") {
         suse::summary_selector_count<int> selector("a(b|c)d?e", 10, 10);
@@ -211,4 +224,719 @@ TEST_SUITE("suse::summary_selector_count") {
 
         REQUIRE(selector == correct_selector);
     }
+
+    TEST_CASE("reclaim dead entries") {
+        using int_type = boost::multiprecision::uint128_t;
+        const std::string_view input = "BBBABBCBCBBACABABCCCBBACBABBACXXXBBBCDCBCCBAABBABACBADBDCBCBAABBACDXXXXXXXXABAACBACBADCBCDBBDBBACBABAACBDCABBBABBBACCBCBBCDAACCBBBBAABADACBABCAACAABBBACBBDACBBBCBACACBACBCBBDAABBBABBCDCACABACBXXXXXXXABBBBBCCBBACACBBAAACCBBAAABBAAABCACCABCABABABCACBBABBCBABCBCCBCCCAACBAABCCDBDCCBAABCCABBCBBBBBCCBCBABCBBCABCCBABAAABABBBBBACBBBBBCABBCBBACCCAABBABCDCBADBAABAABBBBCDBBACCBCBBCBABCDBBBBBCCAAACCBBCBCBCCAABADBABAACBBDDACBBABCABABABADACCBBBBABBBBBBCBBCBACABDABACACDCBBABBCBDBBBBBBBBDCABAACBCBBBCABCBBACCCBBCCBCBABAAABADBBCBABABBCCBABBBABCACCBBACBBDBBCABCCADBCCBBCBBACCBCABAAACCABAACBBBBDCBDBCACBBBBAACCABBBBAABABCCBBCABABACBBDBACABBBBABCDABCAAAAACCBBBBCBABBDCABBDBCBBCBAAAABBBCBBBBBCBBBACCBBCCBBCDABCABDCABBBCCBCAADCBADAADBBBACBCCABBBCCCAACCBBBBCBBBBACBABABBABBCCAACCAAACBCCAACCBBBCDBDCBCACBBACBCBBCBBACAAABBBBDCBABBBCBDCACCBDBAAACBBACABABBBACCACCBBCBACDCCCBCDCBCDACBCBBCDBCBCACABBABCAABABDABBBBBBBCCCAAACBBACBCBCCABCAAABCBCBACABBBBCBDDBBBAACC";
+
+        suse::summary_selector_count<int_type> correct_selector("A(B*C)*D", input.size(), 20);
+        suse::summary_selector_count<int_type> selector("A(B*C)*D", input.size(), 20);
+        selector.enable_dead_entry_reclamation();
+
+        for (std::size_t idx = 0; auto c : input) {
+            correct_selector.process_event({c, 0, idx});
+            selector.process_event({c, 0, idx++});
+
+            REQUIRE(selector.number_of_contained_complete_matches() == correct_selector.number_of_contained_complete_matches());
+            REQUIRE(selector.number_of_contained_partial_matches() == correct_selector.number_of_contained_partial_matches());
+            REQUIRE(selector.cached_events().size() + selector.number_of_reclaimed_entries() == correct_selector.cached_events().size());
+        }
+
+        CHECK(selector.number_of_reclaimed_entries() > 0);
+        CHECK(selector.active_counts() == correct_selector.active_counts());
+
+        // the remaining entries have to be an unchanged subsequence of the unreclaimed cache
+        std::size_t live_idx = 0;
+        for (const auto &entry : correct_selector.cached_events()) {
+            if (live_idx < selector.cached_events().size() && selector.cached_events()[live_idx] == entry)
+                ++live_idx;
+        }
+        CHECK(live_idx == selector.cached_events().size());
+    }
+
+    TEST_CASE("reclaim dead entries while evicting") {
+        using int_type = boost::multiprecision::uint128_t;
+        const std::unordered_map<char, double> probabilities{{'A', 0.25}, {'B', 0.3}, {'C', 0.25}, {'D', 0.1}, {'X', 0.1}};
+
+        struct configuration {
+            std::string_view input;
+            std::size_t time_window_size, summary_size, time_to_live;
+            bool use_suse;
+        };
+
+        constexpr auto no_ttl = std::numeric_limits<std::size_t>::max();
+        for (const auto [input, time_window_size, summary_size, time_to_live, use_suse] : {configuration{"BDBCAAXBCDCABCBCCABAAABACBDXBCBCACAAABCB", 7, 11, 14, false}, configuration{"ACBBACCABABBABBCABCBBBDCBCADBBCABXDBBBCC", 3, 10, no_ttl, false}, configuration{"ACBBACCABABBABBCABCBBBDCBCADBBCABXDBBBCC", 3, 10, no_ttl, true}, configuration{"BDBCAAXBCDCABCBCCABAAABACBDXBCBCACAAABCB", 7, 11, 14, true}}) {
+            CAPTURE(input);
+            CAPTURE(use_suse);
+
+            // holds the same events as the reclaiming selector plus the reclaimed ones, which must not change any count
+            suse::summary_selector_count<int_type> correct_selector("A(B*C)*D", input.size(), time_window_size, time_to_live);
+            suse::summary_selector_count<int_type> selector("A(B*C)*D", summary_size, time_window_size, time_to_live);
+            selector.enable_dead_entry_reclamation();
+
+            const suse::eviction_strategies::suse<int_type, double> strategy{selector, probabilities};
+            std::optional<std::size_t> evicted_timestamp;
+            const auto recording_strategy = [&](const auto &evicting, const suse::event &new_event) -> std::optional<std::size_t> {
+                const auto idx = use_suse ? strategy.select(selector, new_event) : std::optional{suse::eviction_strategies::fifo(evicting, new_event)};
+                // without an index, the new event is dropped instead
+                evicted_timestamp = idx ? evicting.cached_events()[*idx].cached_event.timestamp : new_event.timestamp;
+                return idx;
+            };
+
+            for (std::size_t idx = 0; idx < input.size(); ++idx) {
+                CAPTURE(idx);
+                evicted_timestamp.reset();
+                selector.process_event({input[idx], 0, idx}, recording_strategy);
+                correct_selector.process_event({input[idx], 0, idx});
+
+                if (evicted_timestamp) {
+                    const auto cached = correct_selector.cached_events();
+                    const auto evicted = std::find_if(cached.begin(), cached.end(), [&](const auto &entry) { return entry.cached_event.timestamp == *evicted_timestamp; });
+                    REQUIRE(evicted != cached.end());
+                    correct_selector.remove_event(static_cast<std::size_t>(evicted - cached.begin()));
+                }
+
+                REQUIRE(selector.number_of_contained_complete_matches() == correct_selector.number_of_contained_complete_matches());
+                REQUIRE(selector.number_of_contained_partial_matches() == correct_selector.number_of_contained_partial_matches());
+            }
+        }
+    }
+
+    TEST_CASE("merge consecutive parts of a stream") {
+        using int_type = boost::multiprecision::uint128_t;
+        const std::string_view input = "BBBABBCBCBBACABABCCCBBACBABBACXXXBBBCDCBCCBAABBABACBADBDCBCBAABBACDXXXXXXXXABAACBACBADCBCDBBDBBACBABAACBDCABBBABBBACCBCBBCDAACCBBBBAABADACBABCAACAABBBACBBDACBBBCBACACBACBCBBDAABBBABBCDCACABACB";
+        const std::array<std::size_t, 3> boundaries{40, 47, 120};
+
+        for (const std::size_t summary_size : {input.size(), std::size_t{25}}) {
+            CAPTURE(summary_size);
+
+            suse::summary_selector_count<int_type> sequential("A(B*C)*D", summary_size, 20);
+            for (std::size_t idx = 0; idx < input.size(); ++idx)
+                sequential.process_event({input[idx], 0, idx}, suse::eviction_strategies::fifo);
+
+            suse::summary_selector_count<int_type> merged("A(B*C)*D", summary_size, 20);
+            for (std::size_t part = 0; part <= boundaries.size(); ++part) {
+                suse::summary_selector_count<int_type> selector("A(B*C)*D", summary_size, 20);
+                selector.enable_merging();
+
+                const auto begin = part == 0 ? 0 : boundaries[part - 1];
+                const auto end = part == boundaries.size() ? input.size() : boundaries[part];
+                for (std::size_t idx = begin; idx < end; ++idx)
+                    selector.process_event({input[idx], 0, idx}, suse::eviction_strategies::fifo);
+
+                merge(merged, selector);
+            }
+
+            CHECK(merged.number_of_detected_complete_matches() == sequential.number_of_detected_complete_matches());
+            CHECK(merged.number_of_detected_partial_matches() == sequential.number_of_detected_partial_matches());
+            CHECK(merged.number_of_contained_complete_matches() == sequential.number_of_contained_complete_matches());
+            CHECK(merged == sequential);
+
+            // the merged selector continues like the sequential one
+            for (std::size_t idx = input.size(); idx < input.size() + 30; ++idx) {
+                const suse::event next{input[idx - input.size()], 0, idx};
+                sequential.process_event(next, suse::eviction_strategies::fifo);
+                merged.process_event(next, suse::eviction_strategies::fifo);
+            }
+            CHECK(merged == sequential);
+        }
+    }
+
+    TEST_CASE("merge requires merging on the later selector") {
+        suse::summary_selector_count<int> earlier("a(b|c)d", 10, 10), later("a(b|c)d", 10, 10);
+        later.process_event({'a', 0, 0});
+
+        CHECK_THROWS_AS(merge(earlier, later), std::invalid_argument);
+    }
+
+    TEST_CASE("merge serialized state") {
+        const std::string_view input = "aabcdacbadcbacdbcacbdaedabaaebdedaaddccdeaceabdebdeadaaabeadabdadbcadcdabeadeadcbedeaabbcbcbcacbccbabcdeacbdeabdad";
+
+        suse::summary_selector_count<long> sequential("a(b|c)*d", input.size(), 8), earlier("a(b|c)*d", input.size(), 8), later("a(b|c)*d", input.size(), 8);
+        later.enable_merging();
+        for (std::size_t idx = 0; idx < input.size(); ++idx) {
+            sequential.process_event({input[idx], 0, idx});
+            (idx < 50 ? earlier : later).process_event({input[idx], 0, idx});
+        }
+
+        std::stringstream state;
+        later.write_state(state);
+
+        suse::summary_selector_count<long> restored("a(b|c)*d", input.size(), 8);
+        restored.read_state(state);
+        CHECK(restored == later);
+
+        merge(earlier, restored);
+        CHECK(earlier == sequential);
+        CHECK(earlier.number_of_detected_complete_matches() == sequential.number_of_detected_complete_matches());
+
+        std::stringstream malformed{"suse_selector_state 1 2 8\n"};
+        CHECK_THROWS_AS(restored.read_state(malformed), std::invalid_argument);
+    }
+
+    TEST_CASE("run-length compression") {
+        using int_type = boost::multiprecision::uint128_t;
+        const std::string_view input = "ABBBBBCBCBBACABABCCCBBACBABBACXXXBBBCDCBCCBAABBABACBADBDCBCBAABBACDXXXXXXXXABAACBACBADCBCDBBDBBACBABAACBDCABBBABBBACCBCBBCDAACCBBBBAABADACBABCAACAABBBACBBDACBBBCBACACBACBCBBDAABBBABBCDCACABACB";
+
+        // bursts of the same type and timestamp, spaced so that no time window holds more events than its size
+        std::vector<suse::event> events;
+        for (std::size_t idx = 0; idx < input.size(); ++idx) {
+            for (std::size_t repetition = 0; repetition <= idx % 4; ++repetition)
+                events.push_back({input[idx], 0, idx * 8});
+        }
+
+        suse::summary_selector_count<int_type> correct_selector("A(B*C)*D", events.size(), 40);
+        suse::summary_selector_count<int_type> selector("A(B*C)*D", events.size(), 40);
+        selector.enable_run_length_compression();
+
+        for (const auto &e : events) {
+            correct_selector.process_event(e);
+            selector.process_event(e);
+
+            REQUIRE(selector.number_of_contained_complete_matches() == correct_selector.number_of_contained_complete_matches());
+            REQUIRE(selector.number_of_contained_partial_matches() == correct_selector.number_of_contained_partial_matches());
+            REQUIRE(selector.number_of_detected_complete_matches() == correct_selector.number_of_detected_complete_matches());
+            REQUIRE(selector.active_counts() == correct_selector.active_counts());
+        }
+
+        CHECK(selector.cached_events().size() < correct_selector.cached_events().size());
+
+        CHECK(selector.number_of_cached_events() == correct_selector.cached_events().size());
+    }
+
+    TEST_CASE("remove run-length compressed entries") {
+        using int_type = boost::multiprecision::uint128_t;
+        const std::string_view input = "aabcdacbadcbacdbcacbdaedabaaebdedaaddccdeaceabdebdeadaaabeadabdadbcadcdabeadeadcbede";
+
+        std::vector<suse::event> events;
+        for (std::size_t idx = 0; idx < input.size(); ++idx) {
+            for (std::size_t repetition = 0; repetition <= idx % 3; ++repetition)
+                events.push_back({input[idx], 0, idx * 6});
+        }
+
+        suse::summary_selector_count<int_type> compressed_template("a*b(c|d)+e", events.size(), 12);
+        compressed_template.enable_run_length_compression();
+        for (const auto &e : events)
+            compressed_template.process_event(e);
+
+        for (std::size_t to_delete = 0, first_event = 0; to_delete < compressed_template.cached_events().size(); ++to_delete) {
+            CAPTURE(to_delete);
+            const auto multiplicity = compressed_template.cached_events()[to_delete].multiplicity;
+
+            suse::summary_selector_count<int_type> correct_selector("a*b(c|d)+e", events.size(), 12);
+            for (const auto &e : events)
+                correct_selector.process_event(e);
+
+            // removes one event of the run at a time
+            auto selector = compressed_template;
+            for (std::size_t i = 0; i < multiplicity; ++i) {
+                correct_selector.remove_event(first_event);
+                selector.remove_event(to_delete);
+
+                CHECK(selector.number_of_cached_events() == correct_selector.number_of_cached_events());
+                CHECK(selector.number_of_contained_complete_matches() == correct_selector.number_of_contained_complete_matches());
+                CHECK(selector.number_of_contained_partial_matches() == correct_selector.number_of_contained_partial_matches());
+                CHECK(selector.active_counts() == correct_selector.active_counts());
+            }
+
+            first_event += multiplicity;
+        }
+    }
+
+    TEST_CASE("ttl with run-length compression") {
+        using int_type = boost::multiprecision::uint128_t;
+        const std::string_view input = "BBBABBCBCBBACABABCCCBBACBABBACABBBCDCBCCBAABBABACBADBDCBCBAABBACDABAACBACBADCBCDBBDBBACBABAACBDCABBBABBBACCBCBBCDAACCBBBBAABADACBABCAACAABBBACBBDACBBBCBAC";
+
+        suse::summary_selector_count<int_type> correct_selector("A(B*C)*D", input.size() * 4, 30, 60);
+        suse::summary_selector_count<int_type> selector("A(B*C)*D", input.size() * 4, 30, 60);
+        selector.enable_run_length_compression();
+
+        for (std::size_t idx = 0; idx < input.size(); ++idx) {
+            for (std::size_t repetition = 0; repetition <= idx % 4; ++repetition) {
+                correct_selector.process_event({input[idx], 0, idx * 8});
+                selector.process_event({input[idx], 0, idx * 8});
+            }
+
+            REQUIRE(selector.number_of_contained_complete_matches() == correct_selector.number_of_contained_complete_matches());
+            REQUIRE(selector.number_of_contained_partial_matches() == correct_selector.number_of_contained_partial_matches());
+        }
+    }
+
+    TEST_CASE("evict from run-length compressed entries") {
+        using int_type = boost::multiprecision::uint128_t;
+        const std::string_view input = "BBBABBCBCBBACABABCCCBBACBABBACABBBCDCBCCBAABBABACBADBDCBCBAABBACDABAACBACBADCBCDBBDBBACBABAACBDCABBBABBBACCBCBBCDAACCBBBBAABADACBABCAACAABBBACBBDACBBBCBAC";
+
+        suse::summary_selector_count<int_type> correct_selector("A(B*C)*D", 25, 30);
+        suse::summary_selector_count<int_type> selector("A(B*C)*D", 25, 30);
+        selector.enable_run_length_compression();
+
+        for (std::size_t idx = 0; idx < input.size(); ++idx) {
+            for (std::size_t repetition = 0; repetition <= idx % 4; ++repetition) {
+                correct_selector.process_event({input[idx], 0, idx * 8}, suse::eviction_strategies::fifo);
+                selector.process_event({input[idx], 0, idx * 8}, suse::eviction_strategies::fifo);
+            }
+
+            REQUIRE(selector.number_of_cached_events() == correct_selector.number_of_cached_events());
+            REQUIRE(selector.number_of_contained_complete_matches() == correct_selector.number_of_contained_complete_matches());
+            REQUIRE(selector.number_of_detected_partial_matches() == correct_selector.number_of_detected_partial_matches());
+        }
+    }
+
+    TEST_CASE("evict from run-length compressed entries with suse") {
+        using int_type = boost::multiprecision::uint128_t;
+        const std::string_view input = "CCBAABCACCABBCDABBABAAABBBBACADAAAADACCBBBBCCCBDCBBBABBCBCBBACABABCCCBBACBABBACABBBCDCBCCBAABB";
+        const std::unordered_map<char, double> probabilities{{'A', 0.3}, {'B', 0.3}, {'C', 0.3}, {'D', 0.1}};
+
+        // suse scores a run by the counters of a single event of it, so it evicts other events than for the
+        // uncompressed stream. For the events it keeps, counts are unchanged: the reference holds the same events
+        suse::summary_selector_count<int_type> correct_selector("A(B*C)*D", input.size(), 7);
+        suse::summary_selector_count<int_type> selector("A(B*C)*D", 13, 7);
+        selector.enable_run_length_compression();
+
+        const suse::eviction_strategies::suse<int_type, double> strategy{selector, probabilities};
+        std::optional<suse::event> evicted;
+        bool dropped = false;
+        std::size_t evictions_from_runs = 0;
+        const auto recording_strategy = [&](const auto &evicting, const suse::event &new_event) {
+            const auto idx = strategy.select(evicting, new_event);
+            dropped = !idx;
+            evicted = idx ? evicting.cached_events()[*idx].cached_event : new_event;
+            evictions_from_runs += idx && evicting.cached_events()[*idx].multiplicity > 1;
+            return idx;
+        };
+
+        for (std::size_t idx = 0; idx < input.size(); ++idx) {
+            CAPTURE(idx);
+            const suse::event next{input[idx], 0, idx / 3};
+            evicted.reset();
+            selector.process_event(next, recording_strategy);
+            correct_selector.process_event(next);
+
+            if (evicted) {
+                // a dropped new event is the last one, otherwise the first event of the run is removed
+                const auto cached = correct_selector.cached_events();
+                const auto first = std::find_if(cached.begin(), cached.end(), [&](const auto &entry) { return entry.cached_event.type == evicted->type && entry.cached_event.timestamp == evicted->timestamp; });
+                REQUIRE(first != cached.end());
+                correct_selector.remove_event(dropped ? cached.size() - 1 : static_cast<std::size_t>(first - cached.begin()));
+            }
+
+            REQUIRE(selector.number_of_cached_events() == correct_selector.number_of_cached_events());
+            REQUIRE(selector.number_of_contained_complete_matches() == correct_selector.number_of_contained_complete_matches());
+            REQUIRE(selector.number_of_contained_partial_matches() == correct_selector.number_of_contained_partial_matches());
+        }
+
+        CHECK(evictions_from_runs > 0);
+    }
+
+    TEST_CASE("many events share a timestamp") {
+        using int_type = boost::multiprecision::uint128_t;
+        const std::string_view input = "BBBABBCBCBBACABABCCCBBACBABBACABBBCDCBCCBAABBABACBADBDCBCBAABBACDABAACBACBADCBCDBBDBBACBABAACBDCABBBABBBACCB";
+        constexpr std::size_t events_per_timestamp = 5, time_window_size = 2;
+
+        std::vector<suse::event> events;
+        for (std::size_t idx = 0; idx < input.size(); ++idx)
+            events.push_back({input[idx], 0, idx / events_per_timestamp});
+
+        const auto automaton = suse::parse_regex("A(B*C)*D");
+        const auto edges = suse::compute_edges_per_character(automaton);
+
+        // runs starting at each event, restricted to the time window of that event
+        suse::execution_state_counter<int_type> expected{automaton.number_of_states()};
+        for (std::size_t start = 0; start < events.size(); ++start) {
+            suse::execution_state_counter<int_type> initial{automaton.number_of_states()};
+            initial[automaton.initial_state_id()] = 1;
+
+            auto runs = advance(initial, edges, events[start].type);
+            for (std::size_t idx = start + 1; idx < events.size() && events[idx].timestamp - events[start].timestamp <= time_window_size; ++idx)
+                runs += advance(runs, edges, events[idx].type);
+            expected += runs;
+        }
+
+        for (const bool compress : {false, true}) {
+            CAPTURE(compress);
+            suse::summary_selector_count<int_type> selector(automaton, events.size(), time_window_size);
+            selector.enable_run_length_compression(compress);
+            for (const auto &e : events)
+                selector.process_event(e);
+
+            CHECK(selector.total_counts() == expected);
+        }
+    }
+
+    TEST_CASE("ttl purges a block after a quiet period") {
+        using int_type = boost::multiprecision::uint128_t;
+        const std::string_view input = "BBBABBCBCBBACABABCCCBBACBABBACABBBCDCBCCBAABBABACBADBDCBCBAABBACDABAACBACBADCBCDBBDBBACBABAACBDCABBBABBBACCB";
+
+        for (const bool compress : {false, true}) {
+            CAPTURE(compress);
+            suse::summary_selector_count<int_type> correct_selector("A(B*C)*D", input.size(), 30);
+            suse::summary_selector_count<int_type> selector("A(B*C)*D", input.size(), 30, 40);
+            correct_selector.enable_run_length_compression(compress);
+            selector.enable_run_length_compression(compress);
+
+            for (std::size_t idx = 0; idx < input.size(); ++idx) {
+                correct_selector.process_event({input[idx], 0, idx / 3});
+                selector.process_event({input[idx], 0, idx / 3});
+            }
+
+            // expires everything older than timestamp 20 at once
+            const suse::event after_quiet_period{'A', 0, 60};
+            while (correct_selector.cached_events().front().cached_event.timestamp < 20)
+                correct_selector.remove_event(0);
+            correct_selector.process_event(after_quiet_period);
+            selector.process_event(after_quiet_period);
+
+            CHECK(selector.number_of_cached_events() == correct_selector.number_of_cached_events());
+            CHECK(selector.number_of_contained_complete_matches() == correct_selector.number_of_contained_complete_matches());
+            CHECK(selector.number_of_contained_partial_matches() == correct_selector.number_of_contained_partial_matches());
+            CHECK(selector.number_of_cached_events() < input.size());
+            CHECK(selector == correct_selector);
+        }
+    }
+
+    TEST_CASE("remove several events at once") {
+        using int_type = boost::multiprecision::uint128_t;
+        using base_type = suse::summary_selector_base<int_type>;
+        const std::string_view input = "BBBABBCBCBBACABABCCCBBACBABBACABBBCDCBCCBAABBABACBADBDCBCBAABBACDABAACBACBADCBCDBBDBBACBABAACBDCABBBABBBACCB";
+
+        for (const bool compress : {false, true}) {
+            CAPTURE(compress);
+            suse::summary_selector_count<int_type> template_selector("A(B*C)*D", input.size(), 6);
+            template_selector.enable_run_length_compression(compress);
+            for (std::size_t idx = 0; idx < input.size(); ++idx)
+                template_selector.process_event({input[idx], 0, idx / 3});
+
+            const auto number_of_entries = template_selector.cached_events().size();
+            std::vector<std::vector<std::size_t>> removals{{0, 1}, {3, 40}, {number_of_entries - 2, 5, number_of_entries - 1}, {}};
+            for (std::size_t idx = 7; idx < number_of_entries; idx += 4)
+                removals.back().push_back(idx);
+            // every event of the first run and one of the second
+            removals.push_back({});
+            for (std::size_t idx = 0, runs = 0; idx < number_of_entries && runs < 2; ++idx) {
+                const auto multiplicity = template_selector.cached_events()[idx].multiplicity;
+                if (multiplicity > 1)
+                    removals.back().insert(removals.back().end(), runs++ == 0 ? multiplicity : 1, idx);
+            }
+
+            for (std::size_t removal = 0; removal < removals.size(); ++removal) {
+                CAPTURE(removal);
+                const auto &cache_indices = removals[removal];
+                auto correct_selector = template_selector;
+                auto selector = template_selector;
+
+                correct_selector.base_type::remove_events(cache_indices); // one at a time
+                selector.remove_events(cache_indices);
+
+                CHECK(selector.number_of_cached_events() == correct_selector.number_of_cached_events());
+                CHECK(selector.number_of_contained_complete_matches() == correct_selector.number_of_contained_complete_matches());
+                CHECK(selector.number_of_contained_partial_matches() == correct_selector.number_of_contained_partial_matches());
+                CHECK(selector == correct_selector);
+
+                const suse::event next{'D', 0, input.size() / 3};
+                correct_selector.process_event(next);
+                selector.process_event(next);
+                CHECK(selector == correct_selector);
+            }
+        }
+    }
+
+    TEST_CASE("batch eviction") {
+        using int_type = boost::multiprecision::uint128_t;
+        const std::string_view input = "BBBABBCBCBBACABABCCCBBACBABBACABBBCDCBCCBAABBABACBADBDCBCBAABBACDABAACBACBADCBCDBBDBBACBABAACBDCABBBABBBACCB";
+        constexpr std::size_t summary_size = 20, low_water_mark = 12;
+
+        suse::summary_selector_count<int_type> selector("A(B*C)*D", summary_size, 10);
+        CHECK_THROWS_AS(selector.enable_batch_eviction(summary_size), std::invalid_argument);
+        selector.enable_batch_eviction(low_water_mark);
+
+        std::vector<suse::event> expected_cache;
+        for (std::size_t idx = 0; idx < input.size(); ++idx) {
+            const suse::event next{input[idx], 0, idx};
+            if (expected_cache.size() == summary_size)
+                expected_cache.erase(expected_cache.begin(), expected_cache.begin() + (summary_size - low_water_mark));
+            expected_cache.push_back(next);
+
+            selector.process_event(next, suse::eviction_strategies::fifo);
+            REQUIRE(selector.number_of_cached_events() == expected_cache.size());
+        }
+
+        suse::summary_selector_count<int_type> correct_selector("A(B*C)*D", summary_size, 10);
+        for (const auto &e : expected_cache)
+            correct_selector.process_event(e);
+
+        CHECK(selector.number_of_contained_complete_matches() == correct_selector.number_of_contained_complete_matches());
+        CHECK(selector.number_of_contained_partial_matches() == correct_selector.number_of_contained_partial_matches());
+        CHECK(selector == correct_selector);
+    }
+
+    TEST_CASE("lazy aggregates") {
+        using int_type = boost::multiprecision::uint128_t;
+        const std::string_view input = "BBBABBCBCBBACABABCCCBBACBABBACABBBCDCBCCBAABBABACBADBDCBCBAABBACDABAACBACBADCBCDBBDBBACBABAACBDCABBBABBBACCB";
+        const std::unordered_map<char, double> probabilities{{'A', 0.2}, {'B', 0.4}, {'C', 0.3}, {'D', 0.1}};
+
+        struct configuration {
+            std::size_t summary_size, time_to_live;
+            bool compress, use_suse;
+        };
+
+        for (const auto [summary_size, time_to_live, compress, use_suse] : {configuration{input.size(), 1000, false, false}, configuration{30, 1000, false, false}, configuration{30, 1000, false, true}, configuration{input.size(), 12, false, false}, configuration{30, 12, true, false}}) {
+            CAPTURE(summary_size);
+            CAPTURE(time_to_live);
+            CAPTURE(compress);
+            CAPTURE(use_suse);
+
+            suse::summary_selector_count<int_type> correct_selector("A(B*C)*D", summary_size, 10, time_to_live);
+            suse::summary_selector_count<int_type> selector("A(B*C)*D", summary_size, 10, time_to_live);
+            correct_selector.enable_run_length_compression(compress);
+            selector.enable_run_length_compression(compress);
+            selector.enable_lazy_aggregates();
+
+            const suse::eviction_strategies::suse<int_type, double> correct_strategy{correct_selector, probabilities}, strategy{selector, probabilities};
+            for (std::size_t idx = 0; idx < input.size(); ++idx) {
+                const suse::event next{input[idx], 0, idx / 2};
+                if (use_suse) {
+                    correct_selector.process_event(next, correct_strategy);
+                    selector.process_event(next, strategy);
+                } else {
+                    correct_selector.process_event(next, suse::eviction_strategies::fifo);
+                    selector.process_event(next, suse::eviction_strategies::fifo);
+                }
+
+                REQUIRE(selector.number_of_contained_complete_matches() == correct_selector.number_of_contained_complete_matches());
+                REQUIRE(selector.number_of_contained_partial_matches() == correct_selector.number_of_contained_partial_matches());
+                REQUIRE(selector.number_of_detected_complete_matches() == correct_selector.number_of_detected_complete_matches());
+            }
+
+            CHECK(selector == correct_selector);
+
+            selector.materialize_state_counters();
+            CHECK(std::equal(selector.cached_events().begin(), selector.cached_events().end(), correct_selector.cached_events().begin(), correct_selector.cached_events().end()));
+
+            const suse::event next{'D', 0, input.size() / 2};
+            correct_selector.process_event(next);
+            selector.process_event(next);
+            correct_selector.remove_event(correct_selector.cached_events().size() - 3);
+            selector.remove_event(selector.cached_events().size() - 3);
+            CHECK(selector == correct_selector);
+        }
+    }
+
+    TEST_CASE("deferred replays") {
+        using int_type = boost::multiprecision::uint128_t;
+        const std::string_view input = "BBBABBCBCBBACABABCCCBBACBABBACABBBCDCBCCBAABBABACBADBDCBCBAABBACDABAACBACBADCBCDBBDBBACBABAACBDCABBBABBBACCB";
+
+        struct configuration {
+            std::size_t summary_size, time_to_live, budget;
+        };
+
+        for (const auto [summary_size, time_to_live, budget] : {configuration{30, 1000, 1}, configuration{30, 1000, 8}, configuration{input.size(), 12, 1}, configuration{40, 15, 3}}) {
+            CAPTURE(summary_size);
+            CAPTURE(time_to_live);
+            CAPTURE(budget);
+
+            suse::summary_selector_count<int_type> correct_selector("A(B*C)*D", summary_size, 10, time_to_live);
+            suse::summary_selector_count<int_type> selector("A(B*C)*D", summary_size, 10, time_to_live);
+            CHECK_THROWS_AS(selector.enable_deferred_replays(0), std::invalid_argument);
+            selector.enable_deferred_replays(budget);
+
+            // deferred replays of older events keep the window counters detached
+            suse::summary_selector_count<int_type> lazy_selector("A(B*C)*D", summary_size, 10, time_to_live);
+            lazy_selector.enable_deferred_replays(budget);
+            lazy_selector.enable_lazy_aggregates();
+
+            std::size_t max_deferred_entries = 0;
+            for (std::size_t idx = 0; idx < input.size(); ++idx) {
+                const suse::event next{input[idx], 0, idx / 2};
+                correct_selector.process_event(next, suse::eviction_strategies::fifo);
+                selector.process_event(next, suse::eviction_strategies::fifo);
+                lazy_selector.process_event(next, suse::eviction_strategies::fifo);
+                max_deferred_entries = std::max(max_deferred_entries, selector.number_of_deferred_entries());
+
+                REQUIRE(selector.number_of_contained_complete_matches() == correct_selector.number_of_contained_complete_matches());
+                REQUIRE(selector.number_of_contained_partial_matches() == correct_selector.number_of_contained_partial_matches());
+                REQUIRE(selector.number_of_detected_complete_matches() == correct_selector.number_of_detected_complete_matches());
+                REQUIRE(lazy_selector.number_of_contained_complete_matches() == correct_selector.number_of_contained_complete_matches());
+                REQUIRE(lazy_selector.number_of_detected_complete_matches() == correct_selector.number_of_detected_complete_matches());
+            }
+            CHECK(max_deferred_entries > 0);
+
+            selector.complete_deferred_replays();
+            CHECK(selector.number_of_deferred_entries() == 0);
+            CHECK(selector == correct_selector);
+
+            lazy_selector.complete_deferred_replays();
+            lazy_selector.materialize_state_counters();
+            CHECK(lazy_selector == correct_selector);
+            CHECK(std::equal(lazy_selector.cached_events().begin(), lazy_selector.cached_events().end(), correct_selector.cached_events().begin(), correct_selector.cached_events().end()));
+        }
+    }
+
+    TEST_CASE("deferred replays with scattered evictions") {
+        using int_type = boost::multiprecision::uint128_t;
+        const std::string_view input = "BBBABBCBCBBACABABCCCBBACBABBACABBBCDCBCCBAABBABACBADBDCBCBAABBACDABAACBACBADCBCDBBDBBACBABAACBDCABBBABBBACCB";
+        const std::unordered_map<char, double> probabilities{{'A', 0.2}, {'B', 0.4}, {'C', 0.3}, {'D', 0.1}};
+
+        suse::summary_selector_count<int_type> selector("A(B*C)*D", 30, 10);
+        selector.enable_deferred_replays(2);
+        const suse::eviction_strategies::suse<int_type, double> strategy{selector, probabilities};
+        for (std::size_t idx = 0; idx < input.size(); ++idx)
+            selector.process_event({input[idx], 0, idx / 2}, strategy);
+
+        selector.complete_deferred_replays();
+
+        // the counts are those of the events that were kept
+        suse::summary_selector_count<int_type> correct_selector("A(B*C)*D", 30, 10);
+        for (const auto &entry : selector.cached_events())
+            correct_selector.process_event(entry.cached_event);
+
+        CHECK(selector.total_counts() == correct_selector.total_counts());
+        CHECK(std::equal(selector.cached_events().begin(), selector.cached_events().end(), correct_selector.cached_events().begin(), correct_selector.cached_events().end()));
+    }
+
+    TEST_CASE("phase timing") {
+        using int_type = boost::multiprecision::uint128_t;
+        suse::summary_selector_count<int_type> selector("A(B*C)*D", 5, 10);
+        REQUIRE(selector.phase_latencies(suse::processing_phase::update_window).count() == 0);
+
+        selector.enable_phase_timing();
+        for (std::size_t idx = 0; idx < 20; ++idx)
+            selector.process_event({"ABCD"[idx % 4], 0, idx}, suse::eviction_strategies::fifo);
+
+        // evictions keep all events within the time window and the time to live
+        CHECK(selector.phase_latencies(suse::processing_phase::update_window).count() == 0);
+        CHECK(selector.phase_latencies(suse::processing_phase::purge_expired).count() == 0);
+        CHECK(selector.phase_latencies(suse::processing_phase::select_eviction).count() == 15);
+        CHECK(selector.phase_latencies(suse::processing_phase::remove_events).count() == 15);
+        CHECK(selector.phase_latencies(suse::processing_phase::add_event).count() == 20);
+        CHECK(selector.phase_latencies(suse::processing_phase::deferred_replay).count() == 0);
+
+        selector.enable_phase_timing(false);
+        CHECK(selector.phase_latencies(suse::processing_phase::add_event).count() == 0);
+
+        suse::summary_selector_count<int_type> expiring("A(B*C)*D", 5, 2, 3);
+        expiring.enable_phase_timing();
+        for (std::size_t idx = 0; idx < 20; ++idx)
+            expiring.process_event({"ABCD"[idx % 4], 0, idx}, suse::eviction_strategies::fifo);
+
+        // from timestamp 3 on, one event leaves the window, and from timestamp 4 on, one event expires
+        CHECK(expiring.phase_latencies(suse::processing_phase::update_window).count() == 17);
+        CHECK(expiring.phase_latencies(suse::processing_phase::purge_expired).count() == 16);
+        CHECK(expiring.phase_latencies(suse::processing_phase::select_eviction).count() == 0);
+        CHECK(expiring.phase_latencies(suse::processing_phase::add_event).count() == 20);
+    }
+
+    TEST_CASE("operation counts") {
+        using int_type = boost::multiprecision::uint128_t;
+        suse::summary_selector_count<int_type> evicting("A(B*C)*D", 5, 10), expiring("A(B*C)*D", 100, 10, 3);
+        for (std::size_t idx = 0; idx < 20; ++idx) {
+            evicting.process_event({"ABCD"[idx % 4], 0, idx}, suse::eviction_strategies::fifo);
+            expiring.process_event({"ABCD"[idx % 4], 0, idx}, suse::eviction_strategies::fifo);
+        }
+
+        if constexpr (!suse::collect_stats) {
+            CHECK(evicting.stats().advance_calls == 0);
+            return;
+        }
+
+        const auto evicting_stats = evicting.stats(), expiring_stats = expiring.stats();
+        CHECK(evicting_stats.advance_calls > 0);
+        CHECK(evicting_stats.evictions == 15);
+        CHECK(evicting_stats.affected_range_replays == 15);
+        CHECK(evicting_stats.window_replays > 0);
+        CHECK(evicting_stats.replayed_entries > 0);
+        CHECK(evicting_stats.expiries == 0);
+        CHECK(evicting_stats.purge_replays == 0);
+        CHECK(evicting_stats.peak_cached_events == 5);
+        CHECK(evicting_stats.peak_window_entries == 5);
+
+        CHECK(expiring_stats.evictions == 0);
+        CHECK(expiring_stats.affected_range_replays == 0);
+        CHECK(expiring_stats.expiries == 16);
+        CHECK(expiring_stats.purge_replays == 16);
+        CHECK(expiring_stats.peak_cached_events == 4);
+        CHECK(expiring_stats.peak_window_entries == 4);
+    }
+
+    TEST_CASE("tracing") {
+        using int_type = boost::multiprecision::uint128_t;
+        suse::summary_selector_count<int_type> selector("A(B*C)*D", 5, 10);
+        suse::trace_writer writer;
+        selector.enable_tracing(writer, 3);
+        CHECK_THROWS_AS(selector.enable_tracing(writer, 0), std::invalid_argument);
+
+        for (std::size_t idx = 0; idx < 10; ++idx)
+            selector.process_event({"ABCD"[idx % 4], 0, idx}, suse::eviction_strategies::fifo);
+
+        const auto spans_named = [&](std::string_view name) {
+            return std::count_if(writer.spans().begin(), writer.spans().end(), [&](const auto &span) { return span.name == name; });
+        };
+
+        // events 0, 3, 6 and 9 are traced, and the last two evict an event, but none leaves the window
+        CHECK(spans_named("process_event") == 4);
+        CHECK(spans_named("update_window") == 0);
+        CHECK(spans_named("select_eviction") == 2);
+        CHECK(spans_named("remove_events") == 2);
+        CHECK(spans_named("replay_affected_range") == 2);
+        for (const auto &span : writer.spans())
+            CHECK(span.start <= span.end);
+
+        selector.disable_tracing();
+        selector.process_event({'A', 0, 10}, suse::eviction_strategies::fifo);
+        CHECK(spans_named("process_event") == 4);
+    }
+
+    TEST_CASE("memory footprint") {
+        using int_type = boost::multiprecision::uint128_t;
+        suse::summary_selector_count<int_type> selector("A(B*C)*D", 8, 3);
+        const auto states = selector.automaton().number_of_states();
+        CHECK(selector.cache_footprint() == suse::memory_footprint{1, 8 * sizeof(suse::cache_entry<int_type>)});
+
+        for (std::size_t idx = 0; idx < 20; ++idx)
+            selector.process_event({"ABCD"[idx % 4], 0, idx}, suse::eviction_strategies::fifo);
+
+        // one allocation for the cache and one per state counter
+        CHECK(selector.cache_footprint() == suse::memory_footprint{9, 8 * sizeof(suse::cache_entry<int_type>) + 8 * states * sizeof(int_type)});
+        CHECK(selector.window_footprint().allocations >= selector.active_window().per_event_counters.size() + 2);
+        CHECK(selector.window_footprint().bytes >= (selector.active_window().per_event_counters.size() + 1) * states * sizeof(int_type));
+    }
+
+    TEST_CASE("scratch memory") {
+        using int_type = boost::multiprecision::uint128_t;
+
+        class counting_resource : public std::pmr::memory_resource {
+          public:
+            std::size_t allocations = 0;
+
+          private:
+            void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+                ++allocations;
+                return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+            }
+
+            void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+                std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+            }
+
+            bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+        } scratch;
+
+        suse::summary_selector_count<int_type> own("A(B*C)*D", 5, 10), given("A(B*C)*D", 5, 10);
+        given.use_scratch_resource(scratch);
+        for (std::size_t idx = 0; idx < 40; ++idx) {
+            own.process_event({"ABCD"[idx % 4], 0, idx}, suse::eviction_strategies::fifo);
+            given.process_event({"ABCD"[idx % 4], 0, idx}, suse::eviction_strategies::fifo);
+        }
+
+        CHECK(scratch.allocations > 0);
+        CHECK(own.scratch_capacity() > given.scratch_capacity());
+        CHECK(own.number_of_contained_complete_matches() == given.number_of_contained_complete_matches());
+        CHECK(own.number_of_detected_complete_matches() == given.number_of_detected_complete_matches());
+        CHECK(own.active_window() == given.active_window());
+
+        // cached counters never live in scratch memory
+        const auto own_cache = own.cached_events(), given_cache = given.cached_events();
+        CHECK(std::equal(own_cache.begin(), own_cache.end(), given_cache.begin(), given_cache.end()));
+        for (const auto &entry : given_cache)
+            CHECK(entry.state_counter.get_allocator().resource() == std::pmr::get_default_resource());
+    }
 }
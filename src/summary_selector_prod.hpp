@@ -1,6 +1,7 @@
 #ifndef SUSE_SUMMARY_SELECTOR_GEO_MEAN_HPP
 #define SUSE_SUMMARY_SELECTOR_GEO_MEAN_HPP
 
+#include "compiled_query.hpp"
 #include "edgelist.hpp"
 #include "event.hpp"
 #include "execution_state_counter.hpp"
@@ -10,6 +11,7 @@
 
 #include <concepts>
 #include <limits>
+#include <memory>
 #include <optional>
 #include <span>
 #include <string_view>
@@ -20,13 +22,24 @@
 
 namespace suse {
 
-template <typename counter_type>
-class summary_selector_prod : public summary_selector_base<counter_type> {
+template <typename counter_type, typename transitions_type = edgelist>
+class summary_selector_prod : public summary_selector_base<counter_type, transitions_type> {
   public:
-    summary_selector_prod(std::string_view query, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live = std::numeric_limits<std::size_t>::max())
-        : summary_selector_base<counter_type>(query, summary_size, time_window_size, time_to_live),
-          total_prod_counter_{this->automaton_.number_of_states()},
-          total_detected_prod_counter_{this->automaton_.number_of_states()},
+    summary_selector_prod(std::string_view query, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live = std::numeric_limits<std::size_t>::max(), const regex_options &options = {})
+        : summary_selector_prod(parse_regex(query, options), summary_size, time_window_size, time_to_live) {}
+
+    summary_selector_prod(const nfa &automaton, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live = std::numeric_limits<std::size_t>::max())
+        : summary_selector_prod(std::make_shared<const compiled_query<transitions_type>>(automaton), summary_size, time_window_size, time_to_live) {}
+
+    // For automatons and transitions that were compiled ahead of time, e.g. loaded from a query_artifact
+    summary_selector_prod(nfa automaton, transitions_type transitions, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live = std::numeric_limits<std::size_t>::max())
+        : summary_selector_prod(std::make_shared<const compiled_query<transitions_type>>(std::move(automaton), std::move(transitions)), summary_size, time_window_size, time_to_live) {}
+
+    // Shares the compiled query, e.g. with the selectors of other partition keys
+    summary_selector_prod(std::shared_ptr<const compiled_query<transitions_type>> query, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live = std::numeric_limits<std::size_t>::max())
+        : summary_selector_base<counter_type, transitions_type>(std::move(query), summary_size, time_window_size, time_to_live),
+          total_prod_counter_{this->query_->automaton().number_of_states()},
+          total_detected_prod_counter_{this->query_->automaton().number_of_states()},
           active_window_prod_extension_{create_additional_window_info(time_window_size)} {
     
         //prod counters must be initialzed with 1
@@ -59,8 +72,8 @@ class summary_selector_prod : public summary_selector_base<counter_type> {
     }
 
     void add_event(const event &new_event) override {
-        auto global_change_count = advance(this->active_window_.total_counter, this->per_character_edges_, new_event.type);
-        auto global_change_prod = advance_prod(this->active_window_.total_counter, this->active_window_prod_extension_.total_prod_counter, this->per_character_edges_, new_event);
+        auto global_change_count = advance(this->active_window_.total_counter, this->query_->transitions(), new_event.type);
+        auto global_change_prod = advance_prod(this->active_window_.total_counter, this->active_window_prod_extension_.total_prod_counter, this->query_->transitions(), new_event);
 
         this->active_window_.total_counter += global_change_count;
         this->total_counter_ += global_change_count;
@@ -71,14 +84,17 @@ class summary_selector_prod : public summary_selector_base<counter_type> {
         this->total_detected_prod_counter_ *= global_change_prod;
 
         const auto active_window_size = this->cache_.size() - this->active_window_.start_idx;
+        this->count_advances(active_window_size + 1);
+        const typename summary_selector_base<counter_type, transitions_type>::scratch_scope scope{*this};
+        const auto scratch = this->scratch_allocator();
         for (std::size_t i = 0; i < active_window_size; ++i) {
             const auto cache_idx = this->active_window_.start_idx + i;
 
-            const auto local_change_count = advance(this->active_window_.per_event_counters[i], this->per_character_edges_, new_event.type);
+            const auto local_change_count = advance(this->active_window_.per_event_counters[i], this->query_->transitions(), new_event.type, scratch);
             this->cache_[cache_idx].state_counter += local_change_count;
             this->active_window_.per_event_counters[i] += local_change_count;
 
-            const auto local_change_prod = advance_prod(this->active_window_.per_event_counters[i], this->active_window_prod_extension_.per_event_prod_counters[i], this->per_character_edges_, new_event);
+            const auto local_change_prod = advance_prod(this->active_window_.per_event_counters[i], this->active_window_prod_extension_.per_event_prod_counters[i], this->query_->transitions(), new_event, scratch);
             this->prod_cache_[cache_idx].state_counter *= local_change_prod;
             this->active_window_prod_extension_.per_event_prod_counters[i] *= local_change_prod;
         }
@@ -138,6 +154,11 @@ class summary_selector_prod : public summary_selector_base<counter_type> {
         return calculate_geometric_mean_over_partial_matches(total_detected_prod_counter_, this->total_detected_counter_);
     }
 
+  protected:
+    void erase_additional_entries(const std::vector<bool> &flagged) override {
+        this->erase_flagged(prod_cache_, flagged);
+    }
+
   private:
     std::vector<cache_entry<counter_type>> prod_cache_;
 
@@ -152,8 +173,8 @@ class summary_selector_prod : public summary_selector_base<counter_type> {
 
     auto create_additional_window_info(std::size_t window_size) const {
         window_info_prod_extension wnd{
-            execution_state_counter<counter_type>{this->automaton_.number_of_states()},
-            ring_buffer<execution_state_counter<counter_type>>{window_size, execution_state_counter<counter_type>{this->automaton_.number_of_states()}}};
+            execution_state_counter<counter_type>{this->query_->automaton().number_of_states()},
+            ring_buffer<execution_state_counter<counter_type>>{window_size, execution_state_counter<counter_type>{this->query_->automaton().number_of_states()}}};
 
         reset_additional_window_counters(wnd);
         return wnd;
@@ -169,7 +190,7 @@ class summary_selector_prod : public summary_selector_base<counter_type> {
 
         counter_type product{1};
         for (std::size_t i = 0; i < counter.size(); ++i) {
-            if (this->automaton_.states()[i].is_final)
+            if (this->query_->is_final(i))
                 product *= counter[i];
         }
 
@@ -181,7 +202,7 @@ class summary_selector_prod : public summary_selector_base<counter_type> {
 
         counter_type product{1};
         for (std::size_t i = 0; i < counter.size(); ++i) {
-            if (!this->automaton_.states()[i].is_final)
+            if (!this->query_->is_final(i))
                 product *= counter[i];
         }
 
@@ -194,7 +215,7 @@ class summary_selector_prod : public summary_selector_base<counter_type> {
         counter_type product{1};
         counter_type count{0};
         for (std::size_t i = 0; i < prod_counter.size(); ++i) {
-            if (this->automaton_.states()[i].is_final) {
+            if (this->query_->is_final(i)) {
                 product *= prod_counter[i];
                 count += count_counter[i];
             }
@@ -209,7 +230,7 @@ class summary_selector_prod : public summary_selector_base<counter_type> {
         counter_type product{1};
         counter_type count{0};
         for (std::size_t i = 0; i < prod_counter.size(); ++i) {
-            if (!this->automaton_.states()[i].is_final) {
+            if (!this->query_->is_final(i)) {
                 product *= prod_counter[i];
                 count += count_counter[i];
             }
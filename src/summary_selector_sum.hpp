@@ -1,6 +1,7 @@
 #ifndef SUSE_SUMMARY_SELECTOR_SUM_HPP
 #define SUSE_SUMMARY_SELECTOR_SUM_HPP
 
+#include "compiled_query.hpp"
 #include "edgelist.hpp"
 #include "event.hpp"
 #include "execution_state_counter.hpp"
@@ -9,8 +10,11 @@
 #include "summary_selector_base.hpp"
 
 #include <concepts>
+#include <istream>
 #include <limits>
+#include <memory>
 #include <optional>
+#include <ostream>
 #include <span>
 #include <string_view>
 #include <unordered_map>
@@ -20,13 +24,24 @@
 
 namespace suse {
 
-template <typename counter_type>
-class summary_selector_sum : public summary_selector_base<counter_type> {
+template <typename counter_type, typename transitions_type = edgelist>
+class summary_selector_sum : public summary_selector_base<counter_type, transitions_type> {
   public:
-    summary_selector_sum(std::string_view query, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live = std::numeric_limits<std::size_t>::max())
-        : summary_selector_base<counter_type>(query, summary_size, time_window_size, time_to_live),
-          total_sum_counter_{this->automaton_.number_of_states()},
-          total_detected_sum_counter_{this->automaton_.number_of_states()},
+    summary_selector_sum(std::string_view query, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live = std::numeric_limits<std::size_t>::max(), const regex_options &options = {})
+        : summary_selector_sum(parse_regex(query, options), summary_size, time_window_size, time_to_live) {}
+
+    summary_selector_sum(const nfa &automaton, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live = std::numeric_limits<std::size_t>::max())
+        : summary_selector_sum(std::make_shared<const compiled_query<transitions_type>>(automaton), summary_size, time_window_size, time_to_live) {}
+
+    // For automatons and transitions that were compiled ahead of time, e.g. loaded from a query_artifact
+    summary_selector_sum(nfa automaton, transitions_type transitions, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live = std::numeric_limits<std::size_t>::max())
+        : summary_selector_sum(std::make_shared<const compiled_query<transitions_type>>(std::move(automaton), std::move(transitions)), summary_size, time_window_size, time_to_live) {}
+
+    // Shares the compiled query, e.g. with the selectors of other partition keys
+    summary_selector_sum(std::shared_ptr<const compiled_query<transitions_type>> query, std::size_t summary_size, std::size_t time_window_size, std::size_t time_to_live = std::numeric_limits<std::size_t>::max())
+        : summary_selector_base<counter_type, transitions_type>(std::move(query), summary_size, time_window_size, time_to_live),
+          total_sum_counter_{this->query_->automaton().number_of_states()},
+          total_detected_sum_counter_{this->query_->automaton().number_of_states()},
           active_window_sum_extension_{create_additional_window_info(time_window_size)} {}
 
     void remove_event(std::size_t cache_index) override {
@@ -54,8 +69,8 @@ class summary_selector_sum : public summary_selector_base<counter_type> {
     }
 
     void add_event(const event &new_event) override {
-        auto global_change_count = advance(this->active_window_.total_counter, this->per_character_edges_, new_event.type);
-        auto global_change_sum = advance_sum(this->active_window_.total_counter, this->active_window_sum_extension_.total_sum_counter, this->per_character_edges_, new_event);
+        auto global_change_count = advance(this->active_window_.total_counter, this->query_->transitions(), new_event.type);
+        auto global_change_sum = advance_sum(this->active_window_.total_counter, this->active_window_sum_extension_.total_sum_counter, this->query_->transitions(), new_event);
 
         this->active_window_.total_counter += global_change_count;
         this->total_counter_ += global_change_count;
@@ -66,14 +81,17 @@ class summary_selector_sum : public summary_selector_base<counter_type> {
         this->total_detected_sum_counter_ += global_change_sum;
 
         const auto active_window_size = this->cache_.size() - this->active_window_.start_idx;
+        this->count_advances(active_window_size + 1);
+        const typename summary_selector_base<counter_type, transitions_type>::scratch_scope scope{*this};
+        const auto scratch = this->scratch_allocator();
         for (std::size_t i = 0; i < active_window_size; ++i) {
             const auto cache_idx = this->active_window_.start_idx + i;
 
-            const auto local_change_count = advance(this->active_window_.per_event_counters[i], this->per_character_edges_, new_event.type);
+            const auto local_change_count = advance(this->active_window_.per_event_counters[i], this->query_->transitions(), new_event.type, scratch);
             this->cache_[cache_idx].state_counter += local_change_count;
             this->active_window_.per_event_counters[i] += local_change_count;
 
-            const auto local_change_sum = advance_sum(this->active_window_.per_event_counters[i], this->active_window_sum_extension_.per_event_sum_counters[i], this->per_character_edges_, new_event);
+            const auto local_change_sum = advance_sum(this->active_window_.per_event_counters[i], this->active_window_sum_extension_.per_event_sum_counters[i], this->query_->transitions(), new_event, scratch);
             this->sum_cache_[cache_idx].state_counter += local_change_sum;
             this->active_window_sum_extension_.per_event_sum_counters[i] += local_change_sum;
         }
@@ -85,6 +103,44 @@ class summary_selector_sum : public summary_selector_base<counter_type> {
         this->sum_cache_.emplace_back(new_event, std::move(global_change_sum));
     }
 
+    // Same as merge() of summary_selector_count, additionally combining the sums
+    friend void merge(summary_selector_sum &earlier, const summary_selector_sum &later) {
+        const auto summary_size = earlier.cache_.capacity();
+        const auto boundary = earlier.replay_boundary(later);
+
+        earlier.merge_counts(later, boundary);
+        earlier.merge_sums(later, boundary);
+        earlier.merge_head_and_time(later);
+        earlier.active_window_sum_extension_ = earlier.template rebuild_active_window<summary_selector_sum>()->active_window_sum_extension_;
+        earlier.shrink_cache_to(summary_size);
+    }
+
+    // State needed to merge this selector in another process
+    void write_state(std::ostream &out) const {
+        this->write_base_state(out);
+        this->write_counter(out, total_sum_counter_);
+        this->write_counter(out, total_detected_sum_counter_);
+        for (const auto &entry : sum_cache_)
+            this->write_counter(out, entry.state_counter);
+    }
+
+    // Throws std::invalid_argument if the state is malformed or belongs to a different query or time window
+    void read_state(std::istream &in) {
+        const auto summary_size = this->cache_.capacity();
+        this->read_base_state(in);
+        this->read_counter(in, total_sum_counter_);
+        this->read_counter(in, total_detected_sum_counter_);
+
+        sum_cache_.clear();
+        for (const auto &entry : this->cache_) {
+            sum_cache_.push_back({entry.cached_event, execution_state_counter<counter_type>{this->query_->automaton().number_of_states()}});
+            this->read_counter(in, sum_cache_.back().state_counter);
+        }
+
+        active_window_sum_extension_ = this->template rebuild_active_window<summary_selector_sum>()->active_window_sum_extension_;
+        this->shrink_cache_to(summary_size);
+    }
+
     counter_type number_of_contained_complete_matches() const {
         return this->sum_over_complete_matches(this->total_counter_);
     }
@@ -134,6 +190,11 @@ class summary_selector_sum : public summary_selector_base<counter_type> {
     }
 
 
+  protected:
+    void erase_additional_entries(const std::vector<bool> &flagged) override {
+        this->erase_flagged(sum_cache_, flagged);
+    }
+
   private:
     std::vector<cache_entry<counter_type>> sum_cache_;
 
@@ -146,10 +207,36 @@ class summary_selector_sum : public summary_selector_base<counter_type> {
 
     execution_state_counter<counter_type> total_sum_counter_, total_detected_sum_counter_;
 
+    using boundary_type = typename summary_selector_base<counter_type, transitions_type>::template merge_boundary<summary_selector_sum>;
+
+    void merge_sums(const summary_selector_sum &later, const boundary_type &boundary) {
+        total_sum_counter_ += later.total_sum_counter_;
+        total_detected_sum_counter_ += later.total_detected_sum_counter_;
+
+        const auto first_later_entry = sum_cache_.size();
+        sum_cache_.insert(sum_cache_.end(), later.sum_cache_.begin(), later.sum_cache_.end());
+
+        if (!boundary.joint)
+            return;
+
+        const auto &joint = *boundary.joint, &tail = *boundary.tail, &head = *boundary.head;
+        const auto &joint_detected = boundary.joint_detected ? *boundary.joint_detected : joint;
+        const auto &head_detected = boundary.head_detected ? *boundary.head_detected : head;
+
+        total_sum_counter_ += joint.total_sum_counter_ - tail.total_sum_counter_ - head.total_sum_counter_;
+        total_detected_sum_counter_ += joint_detected.total_detected_sum_counter_ - tail.total_detected_sum_counter_ - head_detected.total_detected_sum_counter_;
+
+        const auto tail_size = tail.sum_cache_.size();
+        for (std::size_t idx = 0; idx < tail_size; ++idx)
+            sum_cache_[boundary.tail_start + idx].state_counter += joint.sum_cache_[idx].state_counter - tail.sum_cache_[idx].state_counter;
+        for (std::size_t idx = 0; idx < boundary.head_size; ++idx)
+            sum_cache_[first_later_entry + idx].state_counter += joint.sum_cache_[tail_size + idx].state_counter - head.sum_cache_[idx].state_counter;
+    }
+
     auto create_additional_window_info(std::size_t window_size) const {
         window_info_sum_extension wnd{
-            execution_state_counter<counter_type>{this->automaton_.number_of_states()},
-            ring_buffer<execution_state_counter<counter_type>>{window_size, execution_state_counter<counter_type>{this->automaton_.number_of_states()}}
+            execution_state_counter<counter_type>{this->query_->automaton().number_of_states()},
+            ring_buffer<execution_state_counter<counter_type>>{window_size, execution_state_counter<counter_type>{this->query_->automaton().number_of_states()}}
         };
 
         reset_additional_window_counters(wnd);
@@ -167,7 +254,7 @@ class summary_selector_sum : public summary_selector_base<counter_type> {
         counter_type sum{0};
         counter_type count{0};
         for (std::size_t i = 0; i < sum_counter.size(); ++i) {
-            if (!this->automaton_.states()[i].is_final) {
+            if (!this->query_->is_final(i)) {
                 sum += sum_counter[i];
                 count += count_counter[i];
             }
@@ -182,7 +269,7 @@ class summary_selector_sum : public summary_selector_base<counter_type> {
         counter_type sum{0};
         counter_type count{0};
         for (std::size_t i = 0; i < sum_counter.size(); ++i) {
-            if (this->automaton_.states()[i].is_final) {
+            if (this->query_->is_final(i)) {
                 sum += sum_counter[i];
                 count += count_counter[i];
             }
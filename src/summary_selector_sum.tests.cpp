@@ -4,6 +4,9 @@
 
 #include <doctest/doctest.h>
 
+#include <sstream>
+#include <string_view>
+
 TEST_SUITE("suse::summary_selector_sum function") {
     TEST_CASE("One addition") {
         suse::summary_selector_sum<int> selector("a(b*c)*d", 10, 10);
@@ -46,4 +49,34 @@ TEST_SUITE("suse::summary_selector_sum function") {
         }
         CHECK(selector.mean_of_contained_complete_matches() == 13.75);
     }
-}
\ No newline at end of file
+
+    TEST_CASE("merge consecutive parts of a stream") {
+        const std::string_view input = "a3b4a1b2c5d6b1c2d7a2a5c1b1c9d2b2c3d3a4b1c1c2d5a7d2b3c3a1d1b5c2b2d4a3a2b1c6d1";
+        constexpr std::size_t time_window_size = 60; // covers the whole stream, as the sum window does not slide yet
+
+        const auto event_at = [&](std::size_t idx) {
+            return suse::event{input[2 * idx], input[2 * idx + 1] - '0', idx};
+        };
+
+        suse::summary_selector_sum<long> sequential("a(b*c)*d", input.size(), time_window_size);
+        suse::summary_selector_sum<long> earlier("a(b*c)*d", input.size(), time_window_size), later("a(b*c)*d", input.size(), time_window_size);
+        later.enable_merging();
+
+        for (std::size_t idx = 0; idx < input.size() / 2; ++idx) {
+            sequential.process_event(event_at(idx));
+            (idx < 17 ? earlier : later).process_event(event_at(idx));
+        }
+
+        std::stringstream state;
+        later.write_state(state);
+        suse::summary_selector_sum<long> restored("a(b*c)*d", input.size(), time_window_size);
+        restored.read_state(state);
+
+        merge(earlier, restored);
+        CHECK(earlier.number_of_detected_complete_matches() == sequential.number_of_detected_complete_matches());
+        CHECK(earlier.sum_of_detected_complete_matches() == sequential.sum_of_detected_complete_matches());
+        CHECK(earlier.sum_of_detected_partial_matches() == sequential.sum_of_detected_partial_matches());
+        CHECK(earlier.sum_of_contained_complete_matches() == sequential.sum_of_contained_complete_matches());
+        CHECK(earlier == sequential);
+    }
+}
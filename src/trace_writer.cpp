@@ -0,0 +1,42 @@
+#include "trace_writer.hpp"
+
+#include "cycle_clock.hpp"
+
+#include <fmt/format.h>
+#include <fmt/ostream.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace suse {
+trace_writer::trace_writer() : origin_{cycle_clock::now()} {}
+
+void trace_writer::add_span(std::string_view name, std::uint64_t start, std::uint64_t end, std::initializer_list<argument> arguments) {
+    if (arguments.size() > max_arguments)
+        throw std::invalid_argument("Too many arguments for a trace span");
+
+    span new_span{name, start, end, {}, arguments.size()};
+    std::copy(arguments.begin(), arguments.end(), new_span.arguments.begin());
+    spans_.push_back(new_span);
+}
+
+void trace_writer::write(std::ostream &out, double nanoseconds_per_tick) const {
+    const auto to_microseconds = [&](std::uint64_t ticks) { return ticks * nanoseconds_per_tick / 1000; };
+
+    fmt::print(out, "{{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+    for (std::size_t idx = 0; idx < spans_.size(); ++idx) {
+        const auto &s = spans_[idx];
+        const auto start = std::max(s.start, origin_) - origin_;
+
+        fmt::print(out, "{}\n{{\"name\": \"{}\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": {:.3f}, \"dur\": {:.3f}", idx == 0 ? "" : ",", s.name, to_microseconds(start), to_microseconds(s.end - s.start));
+        if (s.number_of_arguments > 0) {
+            fmt::print(out, ", \"args\": {{");
+            for (std::size_t arg = 0; arg < s.number_of_arguments; ++arg)
+                fmt::print(out, "{}\"{}\": {}", arg == 0 ? "" : ", ", s.arguments[arg].first, s.arguments[arg].second);
+            fmt::print(out, "}}");
+        }
+        fmt::print(out, "}}");
+    }
+    fmt::print(out, "\n]}}\n");
+}
+} // namespace suse
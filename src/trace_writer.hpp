@@ -0,0 +1,46 @@
+#ifndef SUSE_TRACE_WRITER_HPP
+#define SUSE_TRACE_WRITER_HPP
+
+#include <array>
+#include <initializer_list>
+#include <ostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace suse {
+// Collects spans measured in cycle_clock ticks and writes them in the Chrome trace event format, which
+// chrome://tracing and Perfetto display as a timeline. Spans nest by time, so a span recorded within another
+// one shows up below it. Names and argument names are not copied and must outlive the writer, e.g. literals.
+class trace_writer {
+  public:
+    using argument = std::pair<std::string_view, std::uint64_t>;
+    static constexpr std::size_t max_arguments = 3;
+
+    struct span {
+        std::string_view name;
+        std::uint64_t start, end;
+        std::array<argument, max_arguments> arguments;
+        std::size_t number_of_arguments;
+    };
+
+    trace_writer();
+
+    // Throws std::invalid_argument if there are more than max_arguments arguments
+    void add_span(std::string_view name, std::uint64_t start, std::uint64_t end, std::initializer_list<argument> arguments = {});
+
+    const std::vector<span> &spans() const { return spans_; }
+
+    // Timestamps are relative to the construction of the writer
+    void write(std::ostream &out, double nanoseconds_per_tick) const;
+
+  private:
+    std::uint64_t origin_;
+    std::vector<span> spans_;
+};
+} // namespace suse
+
+#endif
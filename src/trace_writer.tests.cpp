@@ -0,0 +1,33 @@
+#include "trace_writer.hpp"
+
+#include <doctest/doctest.h>
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+TEST_SUITE("suse::trace_writer") {
+    TEST_CASE("writes complete events") {
+        suse::trace_writer writer;
+        REQUIRE(writer.spans().empty());
+
+        // spans starting before the writer was constructed are clamped to its construction
+        writer.add_span("outer", 0, 4000);
+        writer.add_span("inner", 0, 2000, {{"first", 1}, {"last", 2}});
+        REQUIRE(writer.spans().size() == 2);
+        REQUIRE(writer.spans()[1].number_of_arguments == 2);
+
+        std::ostringstream out;
+        writer.write(out, 0.5);
+        const auto trace = out.str();
+
+        REQUIRE(trace.find("\"traceEvents\"") != std::string::npos);
+        REQUIRE(trace.find("{\"name\": \"outer\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": 0.000, \"dur\": 2.000}") != std::string::npos);
+        REQUIRE(trace.find("\"dur\": 1.000, \"args\": {\"first\": 1, \"last\": 2}}") != std::string::npos);
+    }
+
+    TEST_CASE("too many arguments") {
+        suse::trace_writer writer;
+        CHECK_THROWS_AS(writer.add_span("span", 0, 1, {{"a", 1}, {"b", 2}, {"c", 3}, {"d", 4}}), std::invalid_argument);
+    }
+}
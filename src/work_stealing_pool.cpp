@@ -0,0 +1,112 @@
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace suse {
+namespace {
+thread_local const work_stealing_pool *current_pool = nullptr;
+thread_local std::size_t current_worker_idx = 0;
+} // namespace
+
+work_stealing_pool::work_stealing_pool(std::size_t number_of_threads) {
+    number_of_threads = std::max<std::size_t>(number_of_threads, 1);
+
+    for (std::size_t idx = 0; idx < number_of_threads; ++idx)
+        queues_.push_back(std::make_unique<task_queue>());
+
+    for (std::size_t idx = 0; idx < number_of_threads; ++idx)
+        threads_.emplace_back([this, idx] { run_worker(idx); });
+}
+
+work_stealing_pool::~work_stealing_pool() {
+    {
+        std::lock_guard lock{sleep_mutex_};
+        stopping_ = true;
+    }
+    wake_up_.notify_all();
+
+    for (auto &thread : threads_)
+        thread.join();
+}
+
+void work_stealing_pool::submit(task new_task) {
+    const auto queue_idx = current_pool == this ? current_worker_idx : next_queue_++ % queues_.size();
+
+    // counted before the task is published, as a worker may take it right away and decrement the count.
+    // Until it is pushed, woken workers find nothing to take and check again.
+    ++pending_tasks_;
+    {
+        std::lock_guard lock{sleep_mutex_}; // pairs with the wait in run_worker, so no wake up gets lost
+        ++queued_tasks_;
+    }
+    {
+        std::lock_guard lock{queues_[queue_idx]->mutex};
+        queues_[queue_idx]->tasks.push_back(std::move(new_task));
+    }
+    wake_up_.notify_one();
+}
+
+void work_stealing_pool::wait_idle() {
+    std::unique_lock lock{sleep_mutex_};
+    idle_.wait(lock, [&] { return pending_tasks_ == 0; });
+
+    if (first_exception_)
+        std::rethrow_exception(std::exchange(first_exception_, nullptr));
+}
+
+std::optional<work_stealing_pool::task> work_stealing_pool::take_task(std::size_t worker_idx) {
+    {
+        auto &own = *queues_[worker_idx];
+        std::lock_guard lock{own.mutex};
+        if (!own.tasks.empty()) {
+            auto result = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            --queued_tasks_;
+            return result;
+        }
+    }
+
+    for (std::size_t offset = 1; offset < queues_.size(); ++offset) {
+        auto &victim = *queues_[(worker_idx + offset) % queues_.size()];
+        std::lock_guard lock{victim.mutex};
+        if (!victim.tasks.empty()) {
+            auto result = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --queued_tasks_;
+            ++number_of_steals_;
+            return result;
+        }
+    }
+
+    return std::nullopt;
+}
+
+void work_stealing_pool::run_worker(std::size_t worker_idx) {
+    current_pool = this;
+    current_worker_idx = worker_idx;
+
+    while (true) {
+        if (auto next_task = take_task(worker_idx); next_task) {
+            try {
+                (*next_task)();
+            } catch (...) {
+                std::lock_guard lock{sleep_mutex_};
+                if (!first_exception_)
+                    first_exception_ = std::current_exception();
+            }
+
+            if (--pending_tasks_ == 0) {
+                std::lock_guard lock{sleep_mutex_};
+                idle_.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock lock{sleep_mutex_};
+        wake_up_.wait(lock, [&] { return stopping_ || queued_tasks_ > 0; });
+        if (stopping_ && queued_tasks_ == 0)
+            return;
+    }
+}
+} // namespace suse
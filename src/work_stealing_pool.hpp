@@ -0,0 +1,64 @@
+#ifndef SUSE_WORK_STEALING_POOL_HPP
+#define SUSE_WORK_STEALING_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <cstddef>
+
+namespace suse {
+// Fixed set of threads with one task queue each. Workers take their newest task first and steal the oldest
+// task of another worker when they run dry. Tasks submitted from a worker go to that worker's queue, so
+// follow-up work stays on the thread whose caches are warm.
+class work_stealing_pool {
+  public:
+    using task = std::function<void()>;
+
+    explicit work_stealing_pool(std::size_t number_of_threads = std::thread::hardware_concurrency());
+    ~work_stealing_pool();
+
+    work_stealing_pool(const work_stealing_pool &) = delete;
+    work_stealing_pool &operator=(const work_stealing_pool &) = delete;
+
+    void submit(task new_task);
+
+    // Blocks until all submitted tasks, including those they submitted, have finished. Rethrows the first
+    // exception thrown by a task since the last call.
+    void wait_idle();
+
+    std::size_t number_of_threads() const { return threads_.size(); }
+    std::size_t number_of_steals() const { return number_of_steals_; }
+
+  private:
+    struct task_queue {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    std::vector<std::unique_ptr<task_queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_up_, idle_;
+    bool stopping_ = false;
+    std::exception_ptr first_exception_;
+
+    std::atomic<std::size_t> queued_tasks_{0};  // submitted, not yet taken by a worker
+    std::atomic<std::size_t> pending_tasks_{0}; // submitted, not yet finished
+    std::atomic<std::size_t> next_queue_{0};
+    std::atomic<std::size_t> number_of_steals_{0};
+
+    void run_worker(std::size_t worker_idx);
+    std::optional<task> take_task(std::size_t worker_idx);
+};
+} // namespace suse
+
+#endif
@@ -0,0 +1,49 @@
+#include "work_stealing_pool.hpp"
+
+#include <doctest/doctest.h>
+
+#include <atomic>
+#include <stdexcept>
+
+TEST_SUITE("suse::work_stealing_pool") {
+    TEST_CASE("runs all tasks") {
+        suse::work_stealing_pool pool{4};
+        CHECK(pool.number_of_threads() == 4);
+
+        std::atomic<std::size_t> sum{0};
+        for (std::size_t i = 1; i <= 1000; ++i)
+            pool.submit([&, i] { sum += i; });
+
+        pool.wait_idle();
+        CHECK(sum == 500500);
+    }
+
+    TEST_CASE("waits for tasks submitted by tasks") {
+        suse::work_stealing_pool pool{3};
+
+        std::atomic<std::size_t> executed{0};
+        for (std::size_t i = 0; i < 10; ++i) {
+            pool.submit([&] {
+                for (std::size_t j = 0; j < 100; ++j)
+                    pool.submit([&] { ++executed; });
+                ++executed;
+            });
+        }
+
+        pool.wait_idle();
+        CHECK(executed == 1010);
+    }
+
+    TEST_CASE("rethrows exceptions of tasks") {
+        suse::work_stealing_pool pool{2};
+
+        std::atomic<std::size_t> executed{0};
+        pool.submit([] { throw std::runtime_error{"failed"}; });
+        for (std::size_t i = 0; i < 10; ++i)
+            pool.submit([&] { ++executed; });
+
+        CHECK_THROWS_AS(pool.wait_idle(), std::runtime_error);
+        CHECK(executed == 10);
+        CHECK_NOTHROW(pool.wait_idle());
+    }
+}